@@ -0,0 +1,564 @@
+#ifndef MYHIPE_INCLUDE_ALGORITHM_H__
+#define MYHIPE_INCLUDE_ALGORITHM_H__
+
+//===-- algorithm.h - 基于线程池的并行算法 -------*- C++ -*-----------===//
+//
+//     orderedMap(pond, source, func, sink, max_in_flight)：
+//     从 source 中不断读取数据，在线程池中并行地执行 func，再按照读取的顺序把结果
+// 交给 sink。读取的数据在一个大小为 max_in_flight 的环形重排缓冲区 ReorderBuffer
+// 中占一个槽位，槽位中保存输入和结果；正在处理和等待输出的数据最多 max_in_flight
+// 个，缓冲区满了时调用线程停止读取，直到最早的数据处理完并被输出，所以内存的占用
+// 和输入流的长度无关。
+//
+//     每个数据对应的任务只有三个指针大小，可以放入 SafeTask 的内部缓冲区，结果直接
+// 写入槽位，不需要为每个数据创建 std::future 或者分配内存。source 和 sink 只在调用
+// 线程中执行，不需要加锁。
+//
+//     parallelSort / inclusiveScan / exclusiveScan / transformReduce：
+//     把区间按 grain 切成若干块，只向线程池提交 min(线程数, 块数) 个任务，任务通过
+// 原子游标领取块，调用线程也参与执行，最后通过 TaskGroup 等待（在工作线程中调用时
+// 不会阻塞，而是帮助执行任务）。grain 为 0 时自动选择，使每个线程大约领取 4 块。
+//     - parallelSort：每块分别 std::sort，再两两归并，每次归并按照较长的一段切成
+//       多份，用二分查找找到另一段中对应的位置，各份并行归并。
+//     - 扫描：两遍扫描，第一遍并行地求出每块的和，顺序地求出每块的偏移量，第二遍
+//       并行地扫描每块。op 需要满足结合律。
+//     - transformReduce：每块求出部分和，再按块的顺序合并，op 需要满足结合律，
+//       不需要满足交换律，结果和顺序执行相同。
+//     Pond 可以是 SteadyThreadPond / BalancedThreadPond，任务中的函数不能抛出异常。
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "./task_group.h"
+
+namespace myHipe
+{
+
+// ======================================
+//  从 source 的参数推导输入的类型
+//  source 的形式是 bool (In & item)，返回 false 表示输入结束
+// ======================================
+template <typename Source>
+struct SourceItem : SourceItem<decltype(&Source::operator())> {};
+
+template <typename C, typename In>
+struct SourceItem<bool (C::*)(In &)> { using type = In; };
+
+template <typename C, typename In>
+struct SourceItem<bool (C::*)(In &) const> { using type = In; };
+
+template <typename In>
+struct SourceItem<bool (*)(In &)> { using type = In; };
+
+template <typename In>
+struct SourceItem<bool (In &)> { using type = In; };
+
+// ======================================
+//  orderedMap 的重排缓冲区
+//  第 seq 个数据使用第 seq % window 个槽位
+// ======================================
+template <typename In, typename Out>
+class ReorderBuffer
+{
+    static const int slot_empty = 0;        // 空闲，或者数据还在处理中
+    static const int slot_done = 1;         // 结果已经写入
+    static const int slot_failed = 2;       // func 抛出了异常
+
+    struct Slot {
+        std::atomic<int> state{slot_empty};
+        typename std::aligned_storage<sizeof(In), alignof(In)>::type input;
+        typename std::aligned_storage<sizeof(Out), alignof(Out)>::type output;
+        std::exception_ptr error;
+    };
+
+public:
+    explicit ReorderBuffer(size_t window) : window(window), slots(new Slot[window]) {}
+
+    // 任务在写入结果之后还会访问缓冲区，析构前等待所有任务真正结束
+    ~ReorderBuffer() {
+        while (this->pending.load() != 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    ReorderBuffer(const ReorderBuffer &) = delete;
+    ReorderBuffer & operator = (const ReorderBuffer &) = delete;
+
+public:
+    // 调用线程放入输入，之后提交任务
+    void setInput(uint64_t seq, In && item) {
+        new (&this->at(seq).input) In(std::move(item));
+        this->pending.fetch_add(1);
+    }
+
+    // 任务没有提交成功时，撤销 setInput
+    void abandon(uint64_t seq) {
+        reinterpret_cast<In *>(&this->at(seq).input)->~In();
+        this->pending.fetch_sub(1);
+    }
+
+    // 在线程池中执行：取出输入，写入结果
+    template <typename Func>
+    void process(uint64_t seq, Func & func) {
+        Slot & slot = this->at(seq);
+        In * input = reinterpret_cast<In *>(&slot.input);
+        int state = slot_done;
+        try {
+            new (&slot.output) Out(func(std::move(*input)));
+        }
+        catch (...) {
+            slot.error = std::current_exception();
+            state = slot_failed;
+        }
+        input->~In();
+        slot.state.store(state);
+
+        // 和 wait() 中先写 waiting 再检查 state 配合，不会漏掉通知
+        if (this->waiting.load() == seq) {
+            std::lock_guard<std::mutex> lock(this->locker);
+            this->done_cond_var.notify_one();
+        }
+        this->pending.fetch_sub(1);         // 之后不能再访问缓冲区
+    }
+
+    bool isReady(uint64_t seq) const {
+        return this->at(seq).state.load() != slot_empty;
+    }
+
+    /**
+     * @brief 等待第 seq 个数据处理完
+     * 在线程池的工作线程中调用时，会帮助线程池执行任务而不是阻塞
+    */
+    template <typename Pond>
+    void wait(uint64_t seq, Pond & pond) {
+        if (this->isReady(seq)) {
+            return;
+        }
+        if (pond.isWorkerThread()) {
+            while (!this->isReady(seq)) {
+                if (!pond.runPendingTask()) {
+                    std::this_thread::yield();
+                }
+            }
+            return;
+        }
+        this->waiting.store(seq);
+        {
+            std::unique_lock<std::mutex> lock(this->locker);
+            this->done_cond_var.wait(lock, [this, seq] () -> bool {
+                return this->isReady(seq);
+            });
+        }
+        this->waiting.store(no_waiting);
+    }
+
+    /**
+     * @brief 取出第 seq 个数据的结果并释放槽位，func 抛出的异常在这里重新抛出
+    */
+    Out take(uint64_t seq) {
+        Slot & slot = this->at(seq);
+        if (slot.state.load() == slot_failed) {
+            std::exception_ptr error = std::move(slot.error);
+            slot.error = nullptr;
+            slot.state.store(slot_empty);
+            std::rethrow_exception(error);
+        }
+        Out * output = reinterpret_cast<Out *>(&slot.output);
+        Out result(std::move(*output));
+        output->~Out();
+        slot.state.store(slot_empty);
+        return result;
+    }
+
+    // 丢弃第 seq 个数据的结果
+    void discard(uint64_t seq) {
+        Slot & slot = this->at(seq);
+        if (slot.state.load() == slot_failed) {
+            slot.error = nullptr;
+        }
+        else {
+            reinterpret_cast<Out *>(&slot.output)->~Out();
+        }
+        slot.state.store(slot_empty);
+    }
+
+    size_t getWindow() const {
+        return this->window;
+    }
+
+private:
+    Slot & at(uint64_t seq) const {
+        return this->slots[seq % this->window];
+    }
+
+private:
+    static constexpr uint64_t no_waiting = std::numeric_limits<uint64_t>::max();
+
+    const size_t window;
+    std::unique_ptr<Slot[]> slots;
+    std::atomic<int> pending{0};                        // 已经提交还没有结束的任务数量
+    std::atomic<uint64_t> waiting{no_waiting};          // 调用线程正在等待的数据
+    std::mutex locker;
+    std::condition_variable done_cond_var;
+};
+
+template <typename In, typename Out>
+constexpr uint64_t ReorderBuffer<In, Out>::no_waiting;
+
+// orderedMap 提交到线程池中的任务
+template <typename In, typename Out, typename Func>
+struct OrderedMapTask {
+    ReorderBuffer<In, Out> * buffer;
+    Func * func;
+    uint64_t seq;
+
+    void operator()() {
+        this->buffer->process(this->seq, *this->func);
+    }
+};
+
+/**
+ * @brief 按顺序的并行 map
+ * @param pond 执行 func 的线程池，应当是无界的
+ * @param source 形式是 bool (In & item)，读取下一个数据，返回 false 表示输入结束
+ * @param func 处理一个数据，参数是 In，返回值不能是 void，可能被多个线程同时调用
+ * @param sink 按照读取的顺序接收 func 的结果，只在调用线程中执行
+ * @param max_in_flight 最多同时有多少个数据已经读取但是还没有交给 sink
+ * @return 交给 sink 的结果数量
+ * func 或 sink 抛出异常时停止读取，等待已经提交的任务结束后把异常抛给调用者
+*/
+template <typename Pond, typename Source, typename Func, typename Sink>
+uint64_t orderedMap(Pond & pond, Source && source, Func && func, Sink && sink, size_t max_in_flight = 64)
+{
+    using In = typename SourceItem<typename std::remove_pointer<typename std::decay<Source>::type>::type>::type;
+    using F = typename std::remove_reference<Func>::type;
+    using Out = typename std::decay<typename std::result_of<F & (In)>::type>::type;
+    static_assert(!std::is_void<Out>::value, "[HipeError]: The function of orderedMap must return a value.");
+
+    if (max_in_flight == 0) {
+        throw std::invalid_argument("[myHipeError]: The max_in_flight of orderedMap must be positive.");
+    }
+
+    ReorderBuffer<In, Out> buffer(max_in_flight);
+    uint64_t next_read = 0;         // 下一个读取的数据
+    uint64_t next_emit = 0;         // 下一个交给 sink 的数据
+
+    auto emit = [&] () {
+        uint64_t seq = next_emit++;
+        sink(buffer.take(seq));
+    };
+
+    try {
+        while (true) {
+            // 缓冲区满了，等待最早的数据
+            if (next_read - next_emit == max_in_flight) {
+                buffer.wait(next_emit, pond);
+                emit();
+            }
+
+            In item;
+            if (!source(item)) {
+                break;
+            }
+            buffer.setInput(next_read, std::move(item));
+            try {
+                pond.submit(OrderedMapTask<In, Out, F>{&buffer, &func, next_read});
+            }
+            catch (...) {
+                buffer.abandon(next_read);
+                throw;
+            }
+            next_read++;
+
+            while (next_emit < next_read && buffer.isReady(next_emit)) {
+                emit();
+            }
+        }
+
+        while (next_emit < next_read) {
+            buffer.wait(next_emit, pond);
+            emit();
+        }
+    }
+    catch (...) {
+        // 任务中引用了缓冲区，等待已经提交的任务结束
+        for (; next_emit < next_read; next_emit++) {
+            buffer.wait(next_emit, pond);
+            buffer.discard(next_emit);
+        }
+        throw;
+    }
+    return next_emit;
+}
+
+// ====================================================
+//                  分块的并行算法
+// ====================================================
+
+/**
+ * @brief 计算并行算法每块的大小，每个线程大约领取 4 块，并且不小于 min_grain
+*/
+inline size_t chunkGrain(size_t n, int thread_numb, size_t min_grain)
+{
+    size_t grain = n / (static_cast<size_t>(std::max(thread_numb, 1)) * 4);
+    return std::max(grain, std::max(min_grain, static_cast<size_t>(1)));
+}
+
+/**
+ * @brief 把 [0, n) 切成大小为 grain 的块，对每块调用 func(chunk, begin, end)，返回时所有块都已经执行完
+ * 只提交 min(线程数, 块数 - 1) 个任务，调用线程也领取块
+*/
+template <typename Pond, typename Func>
+void forEachChunk(Pond & pond, size_t n, size_t grain, Func && func)
+{
+    size_t chunks = (n + grain - 1) / grain;
+    if (chunks <= 1) {
+        if (n > 0) {
+            func(static_cast<size_t>(0), static_cast<size_t>(0), n);
+        }
+        return;
+    }
+    std::atomic<size_t> cursor{0};
+    auto runner = [&] () {
+        size_t chunk;
+        while ((chunk = cursor.fetch_add(1, std::memory_order_relaxed)) < chunks) {
+            func(chunk, chunk * grain, std::min(n, (chunk + 1) * grain));
+        }
+    };
+
+    TaskGroup<Pond> group(pond);
+    size_t helpers = std::min(static_cast<size_t>(pond.getThreadNumb()), chunks - 1);
+    for (size_t i = 0; i < helpers; i++) {
+        group.submit([&runner] { runner(); });
+    }
+    runner();
+    group.wait();
+}
+
+/**
+ * @brief 并行的 transform_reduce，结果为 init op transform(x0) op transform(x1) ...
+ * @param grain 每块的元素数量，0 表示自动选择
+*/
+template <typename Pond, typename RandomIt, typename T, typename Reduce, typename Transform>
+T transformReduce(Pond & pond, RandomIt first, RandomIt last, T init, Reduce reduce, Transform transform, size_t grain = 0)
+{
+    size_t n = static_cast<size_t>(last - first);
+    if (n == 0) {
+        return init;
+    }
+    grain = (grain == 0) ? chunkGrain(n, pond.getThreadNumb(), 1024) : grain;
+    size_t chunks = (n + grain - 1) / grain;
+
+    std::vector<T> partials(chunks, init);
+    forEachChunk(pond, n, grain, [&] (size_t chunk, size_t begin, size_t end) {
+        T local = transform(first[begin]);
+        for (size_t i = begin + 1; i < end; i++) {
+            local = reduce(std::move(local), transform(first[i]));
+        }
+        partials[chunk] = std::move(local);
+    });
+    for (size_t i = 0; i < chunks; i++) {
+        init = reduce(std::move(init), std::move(partials[i]));
+    }
+    return init;
+}
+
+/**
+ * @brief 并行求和（或者用 reduce 合并）
+*/
+template <typename Pond, typename RandomIt, typename T, typename Reduce = std::plus<T>>
+T parallelReduce(Pond & pond, RandomIt first, RandomIt last, T init, Reduce reduce = Reduce(), size_t grain = 0)
+{
+    using Ref = typename std::iterator_traits<RandomIt>::reference;
+    return transformReduce(pond, first, last, std::move(init), reduce, [] (Ref x) -> T { return x; }, grain);
+}
+
+/**
+ * @brief 两遍的并行扫描，out[i] = init op in[0] op ... op in[i - 1 + inclusive]
+ * out 可以和 in 相同
+*/
+template <typename Pond, typename InIt, typename OutIt, typename T, typename Op>
+void scanImpl(Pond & pond, InIt first, InIt last, OutIt out, T init, Op op, bool inclusive, size_t grain)
+{
+    size_t n = static_cast<size_t>(last - first);
+    if (n == 0) {
+        return;
+    }
+    grain = (grain == 0) ? chunkGrain(n, pond.getThreadNumb(), 4096) : grain;
+    size_t chunks = (n + grain - 1) / grain;
+
+    // 第一遍：每块的和，最后一块的和用不到
+    std::vector<T> offsets(chunks, init);
+    forEachChunk(pond, (chunks - 1) * grain, grain, [&] (size_t chunk, size_t begin, size_t end) {
+        T local = first[begin];
+        for (size_t i = begin + 1; i < end; i++) {
+            local = op(std::move(local), first[i]);
+        }
+        offsets[chunk] = std::move(local);
+    });
+
+    // 顺序地求出每块的偏移量
+    T running = init;
+    for (size_t i = 0; i < chunks; i++) {
+        T sum = std::move(offsets[i]);
+        offsets[i] = running;
+        if (i + 1 < chunks) {
+            running = op(std::move(running), std::move(sum));
+        }
+    }
+
+    // 第二遍：每块从自己的偏移量开始扫描
+    forEachChunk(pond, n, grain, [&] (size_t chunk, size_t begin, size_t end) {
+        T acc = offsets[chunk];
+        for (size_t i = begin; i < end; i++) {
+            if (inclusive) {
+                acc = op(std::move(acc), first[i]);
+                out[i] = acc;
+            }
+            else {
+                T next = op(acc, first[i]);
+                out[i] = std::move(acc);
+                acc = std::move(next);
+            }
+        }
+    });
+}
+
+/**
+ * @brief 并行的前缀和（包含当前元素），out[i] = in[0] op ... op in[i]
+ * @param grain 每块的元素数量，0 表示自动选择
+*/
+template <typename Pond, typename InIt, typename OutIt, typename Op = std::plus<typename std::iterator_traits<InIt>::value_type>>
+void inclusiveScan(Pond & pond, InIt first, InIt last, OutIt out, Op op = Op(), size_t grain = 0)
+{
+    using T = typename std::iterator_traits<InIt>::value_type;
+    size_t n = static_cast<size_t>(last - first);
+    if (n == 0) {
+        return;
+    }
+    // 没有单位元，第一个元素作为初值
+    T head = first[0];
+    out[0] = head;
+    scanImpl(pond, first + 1, last, out + 1, std::move(head), op, true, grain);
+}
+
+/**
+ * @brief 并行的前缀和（不包含当前元素），out[i] = init op in[0] op ... op in[i - 1]
+ * @param grain 每块的元素数量，0 表示自动选择
+*/
+template <typename Pond, typename InIt, typename OutIt, typename T, typename Op = std::plus<T>>
+void exclusiveScan(Pond & pond, InIt first, InIt last, OutIt out, T init, Op op = Op(), size_t grain = 0)
+{
+    scanImpl(pond, first, last, out, std::move(init), op, false, grain);
+}
+
+/**
+ * @brief 并行地把有序的 [a, a + na) 和 [b, b + nb) 归并到 out
+ * 把较长的一段切成多份，用二分查找在另一段中找到对应的位置，相等的元素 a 中的在前
+*/
+template <typename Pond, typename It, typename OutIt, typename Compare>
+void parallelMerge(Pond & pond, It a, size_t na, It b, size_t nb, OutIt out, Compare comp, size_t grain)
+{
+    size_t total = na + nb;
+    size_t pieces = std::max(static_cast<size_t>(1), total / std::max(grain, static_cast<size_t>(1)));
+    if (pieces <= 1) {
+        std::merge(std::make_move_iterator(a), std::make_move_iterator(a + na),
+                   std::make_move_iterator(b), std::make_move_iterator(b + nb), out, comp);
+        return;
+    }
+    bool a_longer = na >= nb;
+    size_t longer = a_longer ? na : nb;
+    size_t step = (longer + pieces - 1) / pieces;
+    pieces = (longer + step - 1) / step;
+
+    // 第 i 份从 a 的 split_a[i]、b 的 split_b[i] 开始
+    std::vector<size_t> split_a(pieces + 1);
+    std::vector<size_t> split_b(pieces + 1);
+    for (size_t i = 0; i < pieces; i++) {
+        size_t pos = i * step;
+        if (a_longer) {
+            split_a[i] = pos;
+            split_b[i] = (pos == 0) ? 0 : static_cast<size_t>(std::lower_bound(b, b + nb, a[pos], comp) - b);
+        }
+        else {
+            split_b[i] = pos;
+            split_a[i] = (pos == 0) ? 0 : static_cast<size_t>(std::upper_bound(a, a + na, b[pos], comp) - a);
+        }
+    }
+    split_a[pieces] = na;
+    split_b[pieces] = nb;
+
+    forEachChunk(pond, pieces, 1, [&] (size_t piece, size_t, size_t) {
+        It a_begin = a + split_a[piece];
+        It a_end = a + split_a[piece + 1];
+        It b_begin = b + split_b[piece];
+        It b_end = b + split_b[piece + 1];
+        std::merge(std::make_move_iterator(a_begin), std::make_move_iterator(a_end),
+                   std::make_move_iterator(b_begin), std::make_move_iterator(b_end),
+                   out + (split_a[piece] + split_b[piece]), comp);
+    });
+}
+
+/**
+ * @brief 并行排序（不稳定），先分块排序再两两归并
+ * @param grain 每块的元素数量，0 表示自动选择，元素数量不超过 grain 时直接 std::sort
+*/
+template <typename Pond, typename RandomIt, typename Compare = std::less<typename std::iterator_traits<RandomIt>::value_type>>
+void parallelSort(Pond & pond, RandomIt first, RandomIt last, Compare comp = Compare(), size_t grain = 0)
+{
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    size_t n = static_cast<size_t>(last - first);
+    grain = (grain == 0) ? chunkGrain(n, pond.getThreadNumb(), 8192) : grain;
+    if (n <= grain || pond.getThreadNumb() <= 1) {
+        std::sort(first, last, comp);
+        return;
+    }
+
+    // 每块分别排序
+    forEachChunk(pond, n, grain, [&] (size_t, size_t begin, size_t end) {
+        std::sort(first + begin, first + end, comp);
+    });
+
+    // 两两归并，在原区间和缓冲区之间来回
+    std::vector<T> buffer(n);
+    typename std::vector<T>::iterator temp = buffer.begin();
+    bool in_buffer = false;
+    for (size_t width = grain; width < n; width *= 2) {
+        size_t pairs = (n + 2 * width - 1) / (2 * width);
+        for (size_t p = 0; p < pairs; p++) {
+            size_t begin = p * 2 * width;
+            size_t mid = std::min(begin + width, n);
+            size_t end = std::min(begin + 2 * width, n);
+            if (in_buffer) {
+                parallelMerge(pond, temp + begin, mid - begin, temp + mid, end - mid, first + begin, comp, grain);
+            }
+            else {
+                parallelMerge(pond, first + begin, mid - begin, first + mid, end - mid, temp + begin, comp, grain);
+            }
+        }
+        in_buffer = !in_buffer;
+    }
+    if (in_buffer) {
+        forEachChunk(pond, n, grain, [&] (size_t, size_t begin, size_t end) {
+            std::move(temp + begin, temp + end, first + begin);
+        });
+    }
+}
+
+}   // !! myHipe
+
+#endif  // !! MYHIPE_INCLUDE_ALGORITHM_H__
@@ -0,0 +1,587 @@
+#ifndef MYHIPE_INCLUDE_ASYNC_IO_H__
+#define MYHIPE_INCLUDE_ASYNC_IO_H__
+
+//===-- async_io.h - 在线程池中完成的异步文件读写 -------*- C++ -*-----------===//
+//
+//     在线程池的任务中直接 pread / pwrite / fsync 会让工作线程阻塞几毫秒，其他任务
+// 只能等待。AsyncIo 把文件操作交给后端执行，操作完成后向线程池提交一个后续任务，
+// 在后续任务中调用用户的回调，工作线程不会阻塞在磁盘上：
+//
+//     io_uring：Linux 5.1 之后可用，通过系统调用直接使用（不依赖 liburing）。提交
+// 操作时写入 SQ 并调用一次 io_uring_enter，一个完成线程阻塞在 io_uring_enter 中等待
+// CQ，每次把取出的所有完成事件作为一批后续任务提交给线程池。
+//
+//     线程：没有 io_uring（头文件不存在、内核不支持、被 seccomp 禁止）时，在一个独立
+// 的 DynamicThreadPond 中执行阻塞的系统调用，再向线程池提交后续任务。
+//
+//     同时交给后端的操作数量不超过 entries，超过时操作进入排队队列，由完成路径（io_uring
+// 的完成线程或者线程后端的 I/O 线程）在有空位时提交，提交操作的线程从不等待，在线程池
+// 的工作线程中调用也不会阻塞。排队的操作没有上限，由调用者控制提交速度。回调的参数和
+// 系统调用的返回值相同：成功时是读写的字节数（fsync 是 0），失败时是 -errno。
+//
+//===----------------------------------------------------------------------===//
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "./util.h"
+#include "./thread_pond/dynamic_pond.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define MYHIPE_HAS_IO_URING 1
+#endif
+#endif
+#endif
+
+namespace myHipe
+{
+
+enum class IoBackend
+{
+    Auto,           // 优先使用 io_uring，不可用时使用线程
+    Uring,          // 只使用 io_uring，不可用时抛出异常
+    Threads         // 只使用线程
+};
+
+namespace util
+{
+
+#ifdef MYHIPE_HAS_IO_URING
+
+// ======================================
+//  io_uring 的提交队列和完成队列
+//  submit 需要由调用者加锁，waitCompletion / reap 只能在一个线程中调用
+// ======================================
+class IoUring
+{
+public:
+    IoUring() = default;
+
+    ~IoUring() {
+        this->close();
+    }
+
+    IoUring(const IoUring &) = delete;
+    IoUring & operator = (const IoUring &) = delete;
+
+public:
+    /**
+     * @brief 创建 io_uring
+     * @return 内核不支持或者没有权限时返回 false
+    */
+    bool setup(unsigned entries) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) {
+            return false;
+        }
+        this->ring_fd = fd;
+        this->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        this->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) {
+            this->sq_ring_size = this->cq_ring_size = std::max(this->sq_ring_size, this->cq_ring_size);
+        }
+
+        this->sq_ring = mmap(nullptr, this->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (this->sq_ring == MAP_FAILED) {
+            this->sq_ring = nullptr;
+            this->close();
+            return false;
+        }
+        if (single) {
+            this->cq_ring = this->sq_ring;
+        }
+        else {
+            this->cq_ring = mmap(nullptr, this->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (this->cq_ring == MAP_FAILED) {
+                this->cq_ring = nullptr;
+                this->close();
+                return false;
+            }
+        }
+        this->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        void * sqes_ptr = mmap(nullptr, this->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqes_ptr == MAP_FAILED) {
+            this->close();
+            return false;
+        }
+        this->sqes = static_cast<io_uring_sqe *>(sqes_ptr);
+
+        char * sq = static_cast<char *>(this->sq_ring);
+        this->sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        this->sq_mask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        this->sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+
+        char * cq = static_cast<char *>(this->cq_ring);
+        this->cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        this->cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        this->cq_mask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        this->cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    void close() {
+        if (this->sqes != nullptr) {
+            munmap(this->sqes, this->sqes_size);
+            this->sqes = nullptr;
+        }
+        if (this->cq_ring != nullptr && this->cq_ring != this->sq_ring) {
+            munmap(this->cq_ring, this->cq_ring_size);
+        }
+        this->cq_ring = nullptr;
+        if (this->sq_ring != nullptr) {
+            munmap(this->sq_ring, this->sq_ring_size);
+            this->sq_ring = nullptr;
+        }
+        if (this->ring_fd >= 0) {
+            ::close(this->ring_fd);
+            this->ring_fd = -1;
+        }
+    }
+
+    /**
+     * @brief 放入一个操作并提交给内核
+     * @return 成功时返回 0，失败时返回 -errno
+    */
+    int submit(const io_uring_sqe & sqe) {
+        unsigned tail = *this->sq_tail;
+        unsigned index = tail & this->sq_mask;
+        this->sqes[index] = sqe;
+        this->sq_array[index] = index;
+        __atomic_store_n(this->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+        while (true) {
+            int ret = static_cast<int>(syscall(__NR_io_uring_enter, this->ring_fd, 1, 0, 0, nullptr, 0));
+            if (ret >= 0) {
+                return 0;
+            }
+            if (errno != EINTR) {
+                // 没有使用 SQPOLL，内核只在 io_uring_enter 中读取 SQ，失败时可以把操作撤回
+                int error = errno;
+                __atomic_store_n(this->sq_tail, tail, __ATOMIC_RELEASE);
+                return -error;
+            }
+        }
+    }
+
+    /**
+     * @brief 阻塞直到至少有一个完成事件
+    */
+    void waitCompletion() {
+        if (__atomic_load_n(this->cq_tail, __ATOMIC_ACQUIRE) != *this->cq_head) {
+            return;
+        }
+        syscall(__NR_io_uring_enter, this->ring_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+    }
+
+    /**
+     * @brief 取出所有的完成事件，每个事件调用一次 func(user_data, res)
+     * @return 取出的事件数量
+    */
+    template <typename Func>
+    unsigned reap(Func && func) {
+        unsigned head = *this->cq_head;
+        unsigned tail = __atomic_load_n(this->cq_tail, __ATOMIC_ACQUIRE);
+        unsigned numb = 0;
+        for (; head != tail; head++, numb++) {
+            const io_uring_cqe & cqe = this->cqes[head & this->cq_mask];
+            func(cqe.user_data, cqe.res);
+        }
+        __atomic_store_n(this->cq_head, head, __ATOMIC_RELEASE);
+        return numb;
+    }
+
+private:
+    int ring_fd{-1};
+    void * sq_ring{nullptr};
+    void * cq_ring{nullptr};
+    size_t sq_ring_size{0};
+    size_t cq_ring_size{0};
+    size_t sqes_size{0};
+    io_uring_sqe * sqes{nullptr};
+    unsigned * sq_tail{nullptr};
+    unsigned * sq_array{nullptr};
+    unsigned sq_mask{0};
+    unsigned * cq_head{nullptr};
+    unsigned * cq_tail{nullptr};
+    unsigned cq_mask{0};
+    io_uring_cqe * cqes{nullptr};
+};
+
+#endif  // !! MYHIPE_HAS_IO_URING
+
+}   // !! namespace util
+
+// ======================================
+//  异步文件读写，回调在 Pond 中执行
+// ======================================
+template <typename Pond>
+class AsyncIo
+{
+public:
+    // 参数是系统调用的返回值，失败时是 -errno
+    using Callback = std::function<void(ssize_t)>;
+
+    /**
+     * @param pond 执行回调的线程池，需要比 AsyncIo 活得更久，应当是无界的
+     * @param entries 同时交给后端的操作数量的上限，超过的操作排队
+     * @param backend 使用的后端
+     * @param io_threads 线程后端中执行阻塞系统调用的线程数量
+    */
+    explicit AsyncIo(Pond & pond, unsigned entries = 256, IoBackend backend = IoBackend::Auto, int io_threads = 4)
+        : pond(pond), entries(entries > 0 ? entries : 1) {
+#ifdef MYHIPE_HAS_IO_URING
+        if (backend != IoBackend::Threads && this->ring.setup(this->entries)) {
+            if (this->armWakeup()) {
+                this->uring = true;
+                this->completion_thread = std::thread(&AsyncIo::completionLoop, this);
+                return;
+            }
+            this->ring.close();
+        }
+#endif
+        if (backend == IoBackend::Uring) {
+            throw std::runtime_error("[myHipeError]: io_uring is not available.");
+        }
+        this->io_pond.reset(new DynamicThreadPond(io_threads > 0 ? io_threads : 1));
+    }
+
+    // 后续任务中引用了 AsyncIo，析构前等待所有操作和回调结束
+    ~AsyncIo() {
+        this->wait();
+#ifdef MYHIPE_HAS_IO_URING
+        if (this->uring) {
+            // user_data 为 stop_tag 的 NOP 通知完成线程退出
+            io_uring_sqe sqe;
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = IORING_OP_NOP;
+            sqe.user_data = stop_tag;
+            int ret;
+            {
+                std::lock_guard<std::mutex> lock(this->sq_locker);
+                ret = this->ring.submit(sqe);
+            }
+            if (ret < 0) {
+                // 提交失败（例如内存不足）时写 eventfd，触发构造时挂在 io_uring 上的 POLL_ADD
+                uint64_t one = 1;
+                while (::write(this->wake_fd, &one, sizeof(one)) < 0 && errno == EINTR) {}
+            }
+            this->completion_thread.join();
+            ::close(this->wake_fd);
+        }
+#endif
+        this->io_pond.reset();
+    }
+
+    AsyncIo(const AsyncIo &) = delete;
+    AsyncIo & operator = (const AsyncIo &) = delete;
+
+public:
+    /**
+     * @brief 从 fd 的 offset 处读取最多 size 个字节到 buffer，buffer 在回调之前必须有效
+    */
+    void read(int fd, void * buffer, size_t size, off_t offset, Callback callback) {
+        this->start(Op::Read, fd, buffer, size, offset, std::move(callback));
+    }
+
+    /**
+     * @brief 把 buffer 中的 size 个字节写入 fd 的 offset 处，buffer 在回调之前必须有效
+    */
+    void write(int fd, const void * buffer, size_t size, off_t offset, Callback callback) {
+        this->start(Op::Write, fd, const_cast<void *>(buffer), size, offset, std::move(callback));
+    }
+
+    /**
+     * @brief 把 fd 的数据刷到磁盘上
+    */
+    void fsync(int fd, Callback callback) {
+        this->start(Op::Fsync, fd, nullptr, 0, 0, std::move(callback));
+    }
+
+    /**
+     * @brief 等待所有已经提交的操作完成并且它们的回调执行结束
+     * 不能在回调中调用
+    */
+    void wait() {
+        std::unique_lock<std::mutex> lock(this->locker);
+        this->done_cond_var.wait(lock, [this] () -> bool {
+            return this->outstanding == 0;
+        });
+    }
+
+    /**
+     * @return 还没有结束的操作数量（算上还没有执行完的回调）
+    */
+    int getInFlight() {
+        std::lock_guard<std::mutex> lock(this->locker);
+        return this->outstanding;
+    }
+
+    /**
+     * @return 是否使用 io_uring
+    */
+    bool usingUring() const {
+        return this->uring;
+    }
+
+private:
+    enum class Op : uint8_t { Read, Write, Fsync };
+
+    struct Request {
+        Op op;
+        int fd;
+        off_t offset;
+        struct iovec iov;
+        Callback callback;
+    };
+
+    // 在线程池中执行用户的回调
+    struct Continuation {
+        AsyncIo * io;
+        Request * request;
+        ssize_t result;
+
+        void operator()() {
+            try {
+                this->request->callback(this->result);
+            }
+            catch (...) {
+                // 回调的异常不能传播到线程池中，忽略
+            }
+            delete this->request;
+            this->io->finishOne();      // 之后不能再访问 AsyncIo
+        }
+    };
+
+    void start(Op op, int fd, void * buffer, size_t size, off_t offset, Callback && callback) {
+        Request * request = new Request{op, fd, offset, {buffer, size}, std::move(callback)};
+        {
+            // 达到上限时排队，由完成路径提交
+            std::lock_guard<std::mutex> lock(this->locker);
+            this->outstanding += 1;
+            if (this->in_io >= this->entries) {
+                this->pending.push_back(request);
+                return;
+            }
+            this->in_io += 1;
+        }
+#ifdef MYHIPE_HAS_IO_URING
+        if (this->uring) {
+            this->dispatchUring(request);
+            return;
+        }
+#endif
+        this->io_pond->submit([this, request] {
+            this->runThreads(request);
+        });
+    }
+
+    // 线程后端：执行操作，之后继续执行排队的操作，直到队列为空
+    void runThreads(Request * request) {
+        while (request != nullptr) {
+            ssize_t result = this->runBlocking(*request);
+            Request * next = this->nextPending();
+            this->pond.submit(Continuation{this, request, result});
+            request = next;
+        }
+    }
+
+    static ssize_t runBlocking(const Request & request) {
+        ssize_t ret = 0;
+        do {
+            switch (request.op) {
+            case Op::Read:
+                ret = ::pread(request.fd, request.iov.iov_base, request.iov.iov_len, request.offset);
+                break;
+            case Op::Write:
+                ret = ::pwrite(request.fd, request.iov.iov_base, request.iov.iov_len, request.offset);
+                break;
+            case Op::Fsync:
+                ret = ::fsync(request.fd);
+                break;
+            }
+        } while (ret < 0 && errno == EINTR);
+        return (ret < 0) ? -errno : ret;
+    }
+
+    /**
+     * @brief 一个操作离开后端：把它的位置交给排队的第一个操作
+     * @return 排队的操作，没有时释放位置并返回 nullptr
+    */
+    Request * nextPending() {
+        std::lock_guard<std::mutex> lock(this->locker);
+        if (this->pending.empty()) {
+            this->in_io -= 1;
+            return nullptr;
+        }
+        Request * request = this->pending.front();
+        this->pending.pop_front();
+        return request;
+    }
+
+    void finishOne() {
+        std::lock_guard<std::mutex> lock(this->locker);
+        this->outstanding -= 1;
+        if (this->outstanding == 0) {
+            this->done_cond_var.notify_all();
+        }
+    }
+
+#ifdef MYHIPE_HAS_IO_URING
+    // user_data 中 Request 的地址不会是 0 或者 1
+    static constexpr uint64_t stop_tag = 0;
+    static constexpr uint64_t wake_tag = 1;
+
+    /**
+     * @brief 创建 eventfd 并在 io_uring 上挂一个 POLL_ADD，析构时提交 NOP 失败用它唤醒完成线程
+    */
+    bool armWakeup() {
+        this->wake_fd = eventfd(0, EFD_CLOEXEC);
+        if (this->wake_fd < 0) {
+            return false;
+        }
+        io_uring_sqe sqe;
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_POLL_ADD;
+        sqe.fd = this->wake_fd;
+        sqe.poll_events = POLLIN;
+        sqe.user_data = wake_tag;
+        if (this->ring.submit(sqe) < 0) {
+            ::close(this->wake_fd);
+            this->wake_fd = -1;
+            return false;
+        }
+        return true;
+    }
+
+    // 提交操作，提交失败时直接向线程池提交后续任务，并继续提交排队的操作
+    void dispatchUring(Request * request) {
+        while (request != nullptr) {
+            int ret = this->submitUring(request);
+            if (ret == 0) {
+                return;
+            }
+            Request * next = this->nextPending();
+            this->pond.submit(Continuation{this, request, ret});
+            request = next;
+        }
+    }
+
+    /**
+     * @return 成功时返回 0，失败时返回 -errno
+    */
+    int submitUring(Request * request) {
+        io_uring_sqe sqe;
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.fd = request->fd;
+        sqe.user_data = reinterpret_cast<uint64_t>(request);
+        switch (request->op) {
+        case Op::Read:
+            sqe.opcode = IORING_OP_READV;
+            sqe.addr = reinterpret_cast<uint64_t>(&request->iov);
+            sqe.len = 1;
+            sqe.off = static_cast<uint64_t>(request->offset);
+            break;
+        case Op::Write:
+            sqe.opcode = IORING_OP_WRITEV;
+            sqe.addr = reinterpret_cast<uint64_t>(&request->iov);
+            sqe.len = 1;
+            sqe.off = static_cast<uint64_t>(request->offset);
+            break;
+        case Op::Fsync:
+            sqe.opcode = IORING_OP_FSYNC;
+            break;
+        }
+
+        std::lock_guard<std::mutex> lock(this->sq_locker);
+        return this->ring.submit(sqe);
+    }
+
+    // 完成线程：每次把所有的完成事件作为一批后续任务提交给线程池，再用空出的位置提交排队的操作
+    void completionLoop() {
+        std::vector<util::SafeTask> batch;
+        std::vector<Request *> ready;
+        batch.reserve(this->entries);
+        bool stop = false;
+        while (!stop) {
+            this->ring.waitCompletion();
+            size_t released = 0;
+            this->ring.reap([&] (uint64_t user_data, int res) {
+                if (user_data == stop_tag || user_data == wake_tag) {
+                    stop = true;
+                    return;
+                }
+                batch.emplace_back(Continuation{this, reinterpret_cast<Request *>(user_data), static_cast<ssize_t>(res)});
+                released += 1;
+            });
+            if (released == 0) {
+                continue;
+            }
+            {
+                // 后续任务提交之前先处理位置，排队的操作还计在 outstanding 中，AsyncIo 不会被析构
+                std::lock_guard<std::mutex> lock(this->locker);
+                while (released > 0 && !this->pending.empty()) {
+                    ready.push_back(this->pending.front());
+                    this->pending.pop_front();
+                    released -= 1;
+                }
+                this->in_io -= static_cast<unsigned>(released);
+            }
+            this->pond.submitInBatch(batch, batch.size());
+            batch.clear();
+            for (Request * request : ready) {
+                this->dispatchUring(request);
+            }
+            ready.clear();
+        }
+    }
+#endif
+
+private:
+    Pond & pond;
+    const unsigned entries;
+    bool uring{false};
+#ifdef MYHIPE_HAS_IO_URING
+    util::IoUring ring;
+    std::mutex sq_locker;                   // 保护提交队列
+    std::thread completion_thread;
+    int wake_fd{-1};                        // 提交退出 NOP 失败时唤醒完成线程
+#endif
+    std::unique_ptr<DynamicThreadPond> io_pond;     // 线程后端
+    std::mutex locker;
+    std::condition_variable done_cond_var;
+    std::deque<Request *> pending;          // 等待位置的操作
+    unsigned in_io{0};                      // 正在由后端执行的操作数量
+    int outstanding{0};                     // 还没有结束的操作数量（算上回调）
+};
+
+}   // !! myHipe
+
+#endif  // !! defined(__unix__) || defined(__APPLE__)
+
+#endif  // !! MYHIPE_INCLUDE_ASYNC_IO_H__
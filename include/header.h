@@ -2,6 +2,10 @@
 #define MYHIPE_INCLUDE_HEADER_H__
 
 #include "./util.h"
+#include "./tracer.h"
+#include "./stats.h"
+#include "./policy.h"
+#include "./topology.h"
 
 #include <iostream>
 #include <stdexcept>
@@ -16,6 +20,7 @@
 #include <atomic>
 #include <queue>
 #include <map>
+#include <memory>
 
 namespace myHipe
 {
@@ -46,6 +51,62 @@ private:
 // ======================
 class TaskOverFlowError : public ThreadPoolError {};
 
+// =====================================================
+//  当前线程是哪个线程池的第几个工作线程
+//  工作线程启动时设置，用于在任务内部识别自己是不是工作线程
+// =====================================================
+struct WorkerIdentity
+{
+    const void * pond{nullptr};     // 所属的线程池，nullptr 表示不是工作线程
+    int index{-1};                  // 在线程池中的编号
+    void (*on_blocking)(const void * pond, int index, bool enter){nullptr};    // 见 BlockingScope
+};
+
+inline WorkerIdentity & currentWorker()
+{
+    static thread_local WorkerIdentity identity;
+    return identity;
+}
+
+// =====================================================
+//  标记一段会阻塞的代码（等待 I/O、锁、条件变量 ...）
+//  在固定线程池的工作线程中使用时，线程会先把自己还没有执行的任务放回公开队列，
+//  若还有其他任务在等待，线程池会临时创建补偿线程执行它们，阻塞结束后补偿线程退出。
+//  不在固定线程池的工作线程中时什么也不做。可以嵌套
+// =====================================================
+class BlockingScope
+{
+public:
+    BlockingScope() : identity(currentWorker()) {
+        if (this->identity.on_blocking != nullptr) {
+            this->identity.on_blocking(this->identity.pond, this->identity.index, true);
+        }
+    }
+
+    ~BlockingScope() {
+        if (this->identity.on_blocking != nullptr) {
+            this->identity.on_blocking(this->identity.pond, this->identity.index, false);
+        }
+    }
+
+    BlockingScope(const BlockingScope &) = delete;
+    BlockingScope & operator = (const BlockingScope &) = delete;
+
+private:
+    WorkerIdentity identity;
+};
+
+/**
+ * @brief 在 BlockingScope 中执行 func
+ * @return func 的返回值
+*/
+template <typename Func>
+auto blocking(Func && func) -> decltype(func())
+{
+    BlockingScope scope;
+    return func();
+}
+
 // ======================
 //      基础线程类
 // ======================
@@ -100,22 +161,277 @@ public:
         this->task_done.notify_one();
     }
 
+    // 绑定 / 解绑当前线程的追踪缓冲区，nullptr 表示不追踪
+    void bindTrace(util::TraceRing * ring) {
+        this->trace.store(ring, std::memory_order_release);
+    }
+
+    // 记录一个追踪事件，没有开启追踪时什么也不做
+    void traceEvent(util::TraceEvent type, int arg0 = 0, int arg1 = 0) {
+        util::TraceRing * ring = this->trace.load(std::memory_order_acquire);
+        if (ring != nullptr) {
+            ring->record(type, arg0, arg1);
+        }
+    }
+
+    // 工作线程找不到任务，开始空闲（只由工作线程自己调用）
+    void markIdle() {
+        if (!this->counters.isIdle()) {
+            this->counters.toIdle();
+            this->traceEvent(util::TraceEvent::Park);
+        }
+    }
+
+    // 工作线程拿到任务，结束空闲（只由工作线程自己调用）
+    void markBusy() {
+        if (this->counters.isIdle()) {
+            this->counters.toBusy();
+            this->traceEvent(util::TraceEvent::Unpark);
+        }
+    }
+
+    // 由其他线程代为执行了当前线程的 numb 个任务
+    void finishTasks(int numb = 1) {
+        this->task_numb -= numb;
+    }
+
+    // 工作线程的计数器，只由工作线程自己写入
+    util::WorkerCounters & getCounters() {
+        return this->counters;
+    }
+
+    const util::WorkerCounters & getCounters() const {
+        return this->counters;
+    }
+
+    // 更新当前线程所在的 cpu（只由工作线程自己调用）
+    void updateCpu() {
+        this->cpu.store(util::currentCpu(), std::memory_order_relaxed);
+    }
+
+    // 线程最近一次记录的 cpu，未知时返回 -1
+    int getCpu() const {
+        return this->cpu.load(std::memory_order_relaxed);
+    }
+
+    // 打乱窃取顺序的随机数（只由工作线程自己使用）
+    util::FastRand & getStealRand() {
+        return this->steal_rand;
+    }
+
+    // ===== 阻塞的任务，见 BlockingScope =====
+
+    // 执行完了一个任务（只由工作线程自己调用）
+    void markProgress() {
+        util::relaxedAdd(this->progress, static_cast<uint64_t>(1));
+    }
+
+    // 执行完的任务序号，看门狗通过它判断线程是否卡在一个任务上
+    uint64_t getProgress() const {
+        return this->progress.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 进入 BlockingScope（只由工作线程自己调用）
+     * @return 是否是最外层的 BlockingScope
+    */
+    bool enterBlocking() {
+        if (this->blocking_depth.fetch_add(1) == 0) {
+            this->blocked_since = util::steadyNowNs();
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief 离开 BlockingScope（只由工作线程自己调用）
+     * @return 离开最外层的 BlockingScope 时返回阻塞的时间（纳秒），否则返回 0
+    */
+    int64_t leaveBlocking() {
+        if (this->blocking_depth.fetch_sub(1) == 1) {
+            return util::steadyNowNs() - this->blocked_since;
+        }
+        return 0;
+    }
+
+    bool isBlocking() const {
+        return this->blocking_depth.load() > 0;
+    }
+
+    // 为这个线程创建补偿线程之前调用，同一时间一个线程最多有一个补偿线程
+    bool claimCompensation() {
+        bool expect = false;
+        return this->compensated.compare_exchange_strong(expect, true);
+    }
+
+    void releaseCompensation() {
+        this->compensated.store(false);
+    }
+
+    // 把只有自己访问的队列中还没有执行的任务放回公开队列（只由工作线程自己调用），
+    // 默认实现，线程类中同名的方法会隐藏它
+    void publishBuffer() {}
+
+    // ===== 空闲时回收任务队列的内存，见 FixedThreadPond::shrinkToFit =====
+    // 下面三个是默认实现，线程类中同名的方法会隐藏它们
+
+    // 释放其他线程也会访问的任务队列多余的内存，至少保留 keep 个任务的容量（会加锁）
+    void shrinkShared(size_t) {}
+
+    // 释放只有线程自己访问的任务队列多余的内存（只由工作线程自己调用）
+    void shrinkOwned(size_t) {}
+
+    // 任务队列占用的堆内存
+    size_t memoryBytes() {
+        return 0;
+    }
+
+    // 最近一次记录的任务队列占用的堆内存，不加锁，用于 stats()
+    size_t recordedBytes() const {
+        return this->shared_bytes.load(std::memory_order_relaxed) + this->owned_bytes.load(std::memory_order_relaxed);
+    }
+
+    // 工作线程拿到任务（只由工作线程自己调用）
+    void markWorking() {
+        this->idle_since = 0;
+        this->reclaimed = false;
+    }
+
+    /**
+     * @brief 工作线程空闲时调用，判断是否要回收自己任务队列的内存（只由工作线程自己调用）
+     * @param epoch 线程池的 shrinkToFit 请求的序号，和上次处理的不同时立刻回收
+     * @param after_ns 空闲多久之后回收，0 表示不回收
+    */
+    bool shouldReclaim(uint64_t epoch, int64_t after_ns) {
+        if (epoch != this->shrink_seen) {
+            this->shrink_seen = epoch;
+            this->reclaimed = true;
+            return true;
+        }
+        if (after_ns <= 0 || this->reclaimed) {
+            return false;
+        }
+        int64_t now = util::steadyNowNs();
+        if (this->idle_since == 0) {
+            this->idle_since = now;
+            return false;
+        }
+        if (now - this->idle_since < after_ns) {
+            return false;
+        }
+        this->reclaimed = true;
+        return true;
+    }
+
 protected:
     bool is_wait{false};      // 是否执行完当前任务后，在等待下一个任务 / 是否停止该线程
     std::thread handle;         // 处理任务的线程
     std::atomic<int> task_numb{0};   // 任务的数量
     std::condition_variable task_done;   // 信号量，当前结束狗发送通知
     std::mutex task_queue_locker;          // 互斥锁
+    std::atomic<util::TraceRing *> trace{nullptr};     // 追踪缓冲区
+    util::WorkerCounters counters;          // 工作线程的计数器
+    std::atomic<int> cpu{-1};               // 线程最近一次记录的 cpu
+    util::FastRand steal_rand;
+    std::atomic<size_t> owned_bytes{0};     // 只有线程自己访问的任务队列占用的内存，由线程自己更新
+    std::atomic<size_t> shared_bytes{0};    // 其他线程也会访问的任务队列占用的内存，修改队列后在锁内更新
+    int64_t idle_since{0};                  // 开始空闲的时间，0 表示正在忙碌（只由工作线程自己访问）
+    uint64_t shrink_seen{0};                // 处理过的 shrinkToFit 请求的序号
+    bool reclaimed{false};                  // 这一次空闲已经回收过内存
+    std::atomic<uint64_t> progress{0};      // 执行完的任务序号
+    std::atomic<int> blocking_depth{0};     // BlockingScope 的嵌套层数
+    int64_t blocked_since{0};               // 进入最外层 BlockingScope 的时间
+    std::atomic<bool> compensated{false};   // 是否有补偿线程在替这个线程执行任务
+};
+
+// =====================================================
+//  submitRange 使用的区间任务：多个 RangeRunner 共享同一个 RangeJob，
+//  每次通过 fetch_add 从游标上领取 grain 个下标执行，直到区间被领完。
+//  哪个线程（包括窃取了 RangeRunner 的线程）空闲，哪个线程就多领取一些，
+//  区间是在执行时才被切分的
+// =====================================================
+template <typename Func>
+struct RangeJob
+{
+    Func func;
+    std::atomic<size_t> cursor{0};
+    size_t end{0};
+    size_t grain{1};
+
+    RangeJob(Func && func, size_t end, size_t grain) : func(std::move(func)), end(end), grain(grain) {}
+};
+
+template <typename Func>
+struct RangeRunner
+{
+    std::shared_ptr<RangeJob<Func>> job;
+
+    void operator()() {
+        RangeJob<Func> & r = *this->job;
+        while (true) {
+            size_t begin = r.cursor.fetch_add(r.grain, std::memory_order_relaxed);
+            if (begin >= r.end) {
+                break;
+            }
+            size_t end = std::min(begin + r.grain, r.end);
+            for (size_t i = begin; i < end; i++) {
+                r.func(i);
+            }
+        }
+    }
+};
+
+/**
+ * @brief 计算 submitRange 每次领取的下标数量，每个线程大约领取 8 次，
+ * 既能让窃取者分到任务，又不会让游标的竞争太激烈
+*/
+inline size_t rangeGrain(size_t n, int thread_numb)
+{
+    size_t grain = n / (static_cast<size_t>(std::max(thread_numb, 1)) * 8);
+    return (grain < 1) ? 1 : grain;
+}
+
+// =====================================================
+//  submitKeyed 使用的串行队列（strand）
+//  同一个 key 的任务总是进入同一个 Strand，同一时刻最多只有一个排空任务在执行它，
+//  所以同一个 key 的任务按提交顺序串行执行
+// =====================================================
+struct Strand
+{
+    util::SpinLock locker;
+    util::RingBuffer<util::SafeTask> tasks;
+    bool scheduled{false};          // 是否已经有排空任务在线程池中
+};
+
+static const int strands_per_thread = 16;       // 每个线程对应的 Strand 数量
+static const int strand_batch = 64;             // 排空任务一次最多执行的任务数量
+
+// =====================================================
+//  任务窃取时选择被窃取线程的顺序
+//  Linear   -- 从自己的下一个线程开始依次尝试
+//  Random   -- 每次从一个随机的线程开始，不同的窃取者不会总是挤在同几个线程上
+//  Topology -- 在 Random 的基础上，先尝试共享 L3 缓存的线程，再尝试同一个 NUMA
+//              节点上的线程，最后才跨节点（见 topology.h），读取不到拓扑时和 Random 相同
+// =====================================================
+enum class StealOrder
+{
+    Linear,
+    Random,
+    Topology
 };
 
 // ==========================================================================================================
 //  基本线程池，定义了除了异步线程循环之外的所有基本线程池机制
 //  继承了 TheadBase 的 线程包装器类型(并不是这个类是 ThreadBase 的基类，而是模板参数 Type 是 ThreadBase 的基类)
 //  is_base_of<A, B> 表示 A 是 B 的基类
+//  Policy 是编译期的策略包 PondPolicy（见 policy.h），线程类和工作线程的循环从这里读取策略
 // ===========================================================================================================
-template <class Type, typename = typename std::enable_if<std::is_base_of<ThreadBase, Type>::value>::type>
+template <class Type, class Policy = PondPolicy<>, typename = typename std::enable_if<std::is_base_of<ThreadBase, Type>::value>::type>
 class FixedThreadPond
 {
+public:
+    using policy_type = Policy;
+
 protected:
     /**
      * @brief 构造函数，计算出线程池的线程容量 和 每个线程的任务容量
@@ -150,6 +466,12 @@ protected:
         // 设置负载均衡
         this->cousor_move_limit = this->getBastMoveLimit(threadNumb);
 
+        // 有界的线程池一次溢出的任务通常不会超过总容量，提前分配，避免溢出时再分配内存
+        if (this->taskNum_of_thread_capacity != 0) {
+            this->overflow_tasks.reserve(static_cast<size_t>(this->taskNum_of_thread_capacity) * this->thread_numb);
+        }
+        this->recordOverflow();
+
         // ===== test =====
         // std::cout << "FixedThreadPond constructor success." << std::endl;
         // std::cout << "thread number = " << this->thread_numb << std::endl;
@@ -192,10 +514,17 @@ public:
      * 若是想要确保所有任务都被执行，要先调用 waitForTasks()
     */
     void close() {
+        this->disableBlockingWatchdog();
         this->is_stop = true;
         for (size_t i = 0; i < this->thread_numb; i++) {
             this->threads[i].join();
         }
+        // 工作线程都已经退出，不会再创建补偿线程
+        std::lock_guard<std::mutex> lock(this->compensate_locker);
+        for (size_t i = 0; i < this->compensators.size(); i++) {
+            this->compensators[i]->handle.join();
+        }
+        this->compensators.clear();
     }
 
     /**
@@ -216,6 +545,179 @@ public:
         return this->thread_numb;
     }
 
+    /**
+     * @brief 获取每个线程的任务容量
+     * @return 0 表示无界
+    */
+    int getTaskCapacity() const {
+        return this->taskNum_of_thread_capacity;
+    }
+
+    /**
+     * @brief 获取线程池运行指标的快照，读取每个线程的计数器，不加锁；
+     * 任务队列的内存是修改队列时记录的值，需要精确的值时使用 memoryFootprint()
+    */
+    util::PondStats stats() const {
+        util::PondStats result;
+        result.pond_type = this->pondType();
+        result.thread_numb = this->thread_numb;
+        result.overflow_tasks = this->overflow_count.load(std::memory_order_relaxed);
+        result.memory_bytes = sizeof(Type) * static_cast<size_t>(this->thread_numb);
+        for (int i = 0; i < this->thread_numb; i++) {
+            int depth = this->threads[i].getTasksNumb();
+            result.tasks_remain += depth;
+            result.workers.push_back(this->threads[i].getCounters().snapshot(i, depth));
+            result.workers.back().queue_bytes = this->threads[i].recordedBytes();
+            result.memory_bytes += result.workers.back().queue_bytes;
+        }
+        result.memory_bytes += this->strand_bytes.load(std::memory_order_relaxed) + this->overflow_bytes.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    // ====================================================
+    //                    阻塞的任务
+    // ====================================================
+
+    /**
+     * @brief 启动看门狗：工作线程卡在一个任务上超过 threshold 时（没有使用 BlockingScope
+     * 标记的阻塞，或者运行时间很长的任务），临时创建补偿线程执行这个线程公开队列中的任务
+     * 和其他线程公开队列中的任务，这个线程执行完卡住的任务后补偿线程退出。
+     * 卡住的线程私有队列中的任务要等它自己执行，使用 BlockingScope 标记阻塞可以避免这种情况
+     * @param threshold 卡住多久之后补偿
+    */
+    template <typename Rep, typename Period>
+    void enableBlockingWatchdog(const std::chrono::duration<Rep, Period> & threshold) {
+        int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(threshold).count();
+        if (ns <= 0) {
+            throw std::invalid_argument("[myHipeError]: The blocking threshold must be positive.");
+        }
+        this->disableBlockingWatchdog();
+        this->watchdog_stop.store(false);
+        this->watchdog = std::thread(&FixedThreadPond::watch, this, ns);
+    }
+
+    /**
+     * @brief 停止看门狗，已经创建的补偿线程在对应的线程恢复后退出
+    */
+    void disableBlockingWatchdog() {
+        if (this->watchdog.joinable()) {
+            this->watchdog_stop.store(true);
+            this->watchdog.join();
+        }
+    }
+
+    /**
+     * @brief 设置同时存在的补偿线程的上限
+     * @param numb 0 表示和工作线程的数量相同（默认）
+    */
+    void setMaxCompensators(int numb) {
+        if (numb < 0) {
+            throw std::invalid_argument("[myHipeError]: The max number of compensating threads can not be negative.");
+        }
+        this->max_compensators.store(numb);
+    }
+
+    /**
+     * @return 阻塞和补偿的统计
+    */
+    util::BlockingStats blockingStats() const {
+        util::BlockingStats result;
+        result.scopes = this->blocking_scopes.load(std::memory_order_relaxed);
+        result.stalls = this->stalls_detected.load(std::memory_order_relaxed);
+        result.compensations = this->compensations.load(std::memory_order_relaxed);
+        result.active_compensators = this->active_compensators.load(std::memory_order_relaxed);
+        result.blocked_seconds = static_cast<double>(this->blocked_ns.load(std::memory_order_relaxed)) / 1e9;
+        return result;
+    }
+
+    // ====================================================
+    //                  任务队列的内存
+    // ====================================================
+
+    /**
+     * @brief 工作线程连续空闲 period 之后，释放自己任务队列多余的内存
+     * 一次突发的大量任务会让任务队列一直保留峰值时的容量，开启之后线程空闲下来会把它们还给系统，
+     * 有界的线程池保留每个线程的任务容量，提交任务时仍然不会分配内存
+     * @param period 空闲多久之后回收，0 表示不回收（默认）
+    */
+    template <typename Rep, typename Period>
+    void setIdleReclaim(const std::chrono::duration<Rep, Period> & period) {
+        int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(period).count();
+        if (ns < 0) {
+            throw std::invalid_argument("[myHipeError]: The idle reclaim period can not be negative.");
+        }
+        this->reclaim_after_ns.store(ns, std::memory_order_relaxed);
+    }
+
+    /**
+     * @return 空闲多久之后回收任务队列的内存，0 表示不回收
+    */
+    std::chrono::nanoseconds getIdleReclaim() const {
+        return std::chrono::nanoseconds(this->reclaim_after_ns.load(std::memory_order_relaxed));
+    }
+
+    /**
+     * @brief 释放任务队列多余的内存
+     * 公开任务队列、串行队列和溢出任务容器立刻释放，只有工作线程自己访问的队列
+     * 在这个线程下一次空闲时释放。和 pullOverFlowTasks 一样，不能和提交任务的线程同时调用
+    */
+    void shrinkToFit() {
+        size_t keep = static_cast<size_t>(this->taskNum_of_thread_capacity);
+        for (int i = 0; i < this->thread_numb; i++) {
+            this->threads[i].shrinkShared(keep);
+        }
+        this->shrink_epoch.fetch_add(1, std::memory_order_relaxed);
+
+        if (this->strands) {
+            for (size_t i = 0; i <= this->strand_mask; i++) {
+                std::lock_guard<util::SpinLock> lock(this->strands[i].locker);
+                size_t before = this->strands[i].tasks.memoryBytes();
+                this->strands[i].tasks.shrinkToFit();
+                this->strand_bytes.fetch_sub(before - this->strands[i].tasks.memoryBytes(), std::memory_order_relaxed);
+            }
+        }
+        util::shrinkQueue(this->overflow_tasks, keep * static_cast<size_t>(this->thread_numb));
+        this->recordOverflow();
+    }
+
+    /**
+     * @return 线程池占用的内存（字节）：线程对象、任务队列、串行队列和溢出任务容器，
+     * std::queue 和 std::list 的任务队列按照元素的数量估计。
+     * 会短暂地对每条公开任务队列和每个串行队列加锁
+    */
+    size_t memoryFootprint() const {
+        size_t bytes = sizeof(Type) * static_cast<size_t>(this->thread_numb);
+        for (int i = 0; i < this->thread_numb; i++) {
+            bytes += this->threads[i].memoryBytes();
+        }
+        return bytes + this->sharedBytes();
+    }
+
+    /**
+     * @return 线程池的类型名，用于 stats()
+    */
+    virtual std::string pondType() const {
+        return "fixed";
+    }
+
+    /**
+     * @return 当前线程是否是这个线程池的工作线程
+    */
+    bool isWorkerThread() const {
+        return currentWorker().pond == static_cast<const void *>(this);
+    }
+
+    /**
+     * @brief 在当前线程中执行一个线程池中还没有开始执行的任务
+     * 工作线程在任务内部等待其他任务时调用（例如 TaskGroup::wait），先执行自己队列中的任务，
+     * 再从其他线程的公开队列中取任务，避免等待的任务排在自己后面而造成死锁
+     * @return 若执行了一个任务 -- true，反之
+    */
+    bool runPendingTask() {
+        int self = this->isWorkerThread() ? currentWorker().index : -1;
+        return this->runPendingFrom((self >= 0) ? self : 0, self);
+    }
+
     /**
      * @brief 提交任务, 没有返回值
      * @param func: 可执行对象
@@ -229,6 +731,34 @@ public:
         // 将任务交个最不忙的线程
         Type * t = getLeastBusyThread();
         t->enqueue(std::forward<Func>(func));       // ??? 
+        this->traceSubmit(t, 1);
+    }
+
+    /**
+     * @brief 提交一个带截止时间的任务
+     * 策略包的任务队列是 util::DeadlineQueue 时，线程按照最早截止优先的顺序执行任务，
+     * 否则截止时间会被忽略，和 submit 相同
+     * @param deadline 截止时间
+     * @param func 可执行对象
+    */
+    template <typename Func>
+    void submitBefore(std::chrono::steady_clock::time_point deadline, Func && func) {
+        if (!this->admit()) {
+            this->taskOverFlow(std::forward<Func>(func));
+            return;
+        }
+        using Ordered = util::isDeadlineQueue<typename Policy::template queue_type<util::SafeTask>>;
+        Type * t = this->getLeastBusyThread();
+        this->enqueueBefore(t, deadline, std::forward<Func>(func), Ordered());
+        this->traceSubmit(t, 1);
+    }
+
+    /**
+     * @brief 提交一个需要在 timeout 之内完成的任务，见 submitBefore
+    */
+    template <typename Rep, typename Period, typename Func>
+    void submitWithin(const std::chrono::duration<Rep, Period> & timeout, Func && func) {
+        this->submitBefore(std::chrono::steady_clock::now() + timeout, std::forward<Func>(func));
     }
 
     /**
@@ -249,6 +779,7 @@ public:
 
         Type * t = this->getLeastBusyThread();
         t->enqueue(std::move(pack));        // enqueue() 在 balanced_pond.h 和 steady_pond.h 中，加入任务队列
+        this->traceSubmit(t, 1);
         return future;
     }
     /**
@@ -263,7 +794,9 @@ public:
             for (size_t i = 0; i < size; i ++) {
                 // 提交一个任务
                 if (admit()) {
-                    this->getThreadNow()->enqueue(std::move(container[i]));
+                    Type * t = this->getThreadNow();
+                    t->enqueue(std::move(container[i]));
+                    this->traceSubmit(t, 1);
                 }
                 else {
                     // 若是当前提交失败，则后面的任务也不会成功
@@ -273,11 +806,131 @@ public:
             }
         }
         else {
-            this->getLeastBusyThread()->enqueue(std::forward<Container>(container), size);
+            Type * t = this->getLeastBusyThread();
+            t->enqueue(std::forward<Container>(container), size);
+            this->traceSubmit(t, static_cast<int>(size));
+        }
+    }
+
+    /**
+     * @brief 把一批任务交给指定的线程，无界时只对它的任务队列加锁一次
+     * 用于调用方自己决定任务放在哪个线程上的场景（例如 Reactor 按 fd 分配线程）
+     * @param index 线程的编号，在 [0, thread_numb) 之间
+     * @param container 任务容器，必须重载 '[]'
+     * @param size 任务容器的 size
+    */
+    template <typename Container>
+    void submitInBatchTo(int index, Container && container, size_t size) {
+        if (index < 0 || index >= this->thread_numb) {
+            throw std::invalid_argument("[myHipeError]: The worker index is out of range.");
+        }
+        Type * t = &this->threads[index];
+        if (this->taskNum_of_thread_capacity != 0) {
+            for (size_t i = 0; i < size; i++) {
+                if (!this->admit()) {
+                    this->taskOverFlow(std::forward<Container>(container), i, size);
+                    break;
+                }
+                t->enqueue(std::move(container[i]));
+                this->traceSubmit(t, 1);
+            }
+        }
+        else {
+            t->enqueue(std::forward<Container>(container), size);
+            this->traceSubmit(t, static_cast<int>(size));
+        }
+    }
+
+    /**
+     * @brief 对 [0, n) 中的每一个下标 i 调用 func(i)
+     * 不会为每个下标创建一个任务，而是给每个线程提交一个共享同一个区间的 RangeRunner，
+     * 执行时通过原子游标每次领取 grain 个下标，提交的开销是 O(线程数量)
+     * 有界的线程池中，只要有一个 RangeRunner 提交成功整个区间就会被执行完，一个都没有
+     * 提交成功时触发任务溢出机制
+     * @param n 下标的数量
+     * @param func 可执行对象，参数是下标 size_t
+     * @param grain 每次领取的下标数量，0 表示自动计算
+    */
+    template <typename Func>
+    void submitRange(size_t n, Func && func, size_t grain = 0) {
+        using F = typename std::decay<Func>::type;
+
+        if (n == 0) {
+            return;
+        }
+        grain = (grain == 0) ? rangeGrain(n, this->thread_numb) : grain;
+        std::shared_ptr<RangeJob<F>> job = std::make_shared<RangeJob<F>>(F(std::forward<Func>(func)), n, grain);
+
+        size_t runners = std::min(static_cast<size_t>(this->thread_numb), (n + grain - 1) / grain);
+        size_t submitted = 0;
+        for (size_t i = 0; i < runners; i++) {
+            if (!this->admit()) {
+                break;
+            }
+            Type * t = this->getThreadNow();
+            t->enqueue(RangeRunner<F>{job});
+            this->traceSubmit(t, 1);
+            util::recyclePlus(this->cursor, 0, this->thread_numb);
+            submitted += 1;
+        }
+        if (submitted == 0) {
+            this->taskOverFlow(RangeRunner<F>{job});
+        }
+    }
+
+    /**
+     * @brief 尝试提交任务，容量不足时不会触发任务溢出机制
+     * @param func 可执行对象，提交失败时 func 不会被移动，调用者可以把它交给其他线程池
+     * @return 提交成功 -- true，反之
+    */
+    template <typename Func>
+    bool trySubmit(Func && func) {
+        if (!this->admit()) {
+            return false;
+        }
+        Type * t = this->getLeastBusyThread();
+        t->enqueue(std::forward<Func>(func));
+        this->traceSubmit(t, 1);
+        return true;
+    }
+
+    /**
+     * @brief 尝试批量提交任务，容量不足时不会触发任务溢出机制
+     * @param container 任务容器，必须重载 '[]'
+     * @param size 任务容器的 size
+     * @return 成功提交的任务数量 n，容器中 [n, size) 的任务不会被移动
+    */
+    template <typename Container>
+    size_t trySubmitInBatch(Container & container, size_t size) {
+        if (this->taskNum_of_thread_capacity == 0) {
+            Type * t = this->getLeastBusyThread();
+            t->enqueue(container, size);
+            this->traceSubmit(t, static_cast<int>(size));
+            return size;
+        }
+        this->moveCursorToLeastBusy();
+        for (size_t i = 0; i < size; i++) {
+            if (!this->admit()) {
+                return i;
+            }
+            Type * t = this->getThreadNow();
+            t->enqueue(std::move(container[i]));
+            this->traceSubmit(t, 1);
         }
+        return size;
     }
 
 protected:
+    template <typename Func>
+    void enqueueBefore(Type * t, std::chrono::steady_clock::time_point deadline, Func && func, std::true_type) {
+        t->enqueue(util::Deadlined<util::SafeTask>{deadline, util::SafeTask(std::forward<Func>(func))});
+    }
+
+    template <typename Func>
+    void enqueueBefore(Type * t, std::chrono::steady_clock::time_point, Func && func, std::false_type) {
+        t->enqueue(std::forward<Func>(func));
+    }
+
     // ====================================================
     //              设置负载平衡机制
     // ====================================================
@@ -335,9 +988,21 @@ public:
             throw std::invalid_argument("[myHipeError]: The number of stealing threads must smaller than thread number and greater than zero.");
         }
         this->max_steal = maxNumb;
+        util::CpuTopology::get();       // 提前读取拓扑，工作线程窃取时不需要再读取 sysfs
         this->enable_steal_tasks = true;
     }
 
+    /**
+     * @brief 设置任务窃取时选择被窃取线程的顺序，默认是 StealOrder::Topology
+    */
+    void setStealOrder(StealOrder order) {
+        this->steal_order = order;
+    }
+
+    StealOrder getStealOrder() const {
+        return this->steal_order;
+    }
+
     /**
      * @brief 关闭任意两个线程之间的任务窃取
     */
@@ -345,6 +1010,362 @@ public:
         this->enable_steal_tasks = false;
     }
 
+public:
+    // ====================================================
+    //                    活动追踪
+    // ====================================================
+
+    /**
+     * @brief 开启追踪，每个线程和提交任务的线程各有一个环形缓冲区
+     * @param events_per_thread 每个缓冲区最多保留的事件数量
+     * 重复开启会继续使用第一次创建的缓冲区
+    */
+    void enableTracing(size_t events_per_thread = 1 << 16) {
+        if (!this->tracer) {
+            std::vector<std::string> names;
+            for (int i = 0; i < this->thread_numb; i++) {
+                names.push_back("worker " + std::to_string(i));
+            }
+            names.push_back("submitter");
+            this->tracer.reset(new util::PondTracer(names, events_per_thread));
+        }
+        for (int i = 0; i < this->thread_numb; i++) {
+            this->threads[i].bindTrace(this->tracer->lane(i));
+        }
+        this->submit_trace.store(this->tracer->lane(this->thread_numb), std::memory_order_release);
+    }
+
+    /**
+     * @brief 关闭追踪，已经记录的事件仍然可以导出
+    */
+    void disableTracing() {
+        for (int i = 0; i < this->thread_numb; i++) {
+            this->threads[i].bindTrace(nullptr);
+        }
+        this->submit_trace.store(nullptr, std::memory_order_release);
+    }
+
+    /**
+     * @return Chrome trace JSON，没有开启过追踪时返回空字符串
+    */
+    std::string traceToJson(const std::string & pond_name = "myHipe") const {
+        return this->tracer ? this->tracer->toChromeJson(pond_name) : std::string();
+    }
+
+    /**
+     * @brief 将追踪的事件导出为 Chrome trace JSON 文件，可在 Perfetto 中打开
+     * @return 若写入成功 -- true，反之
+    */
+    bool dumpTrace(const std::string & path, const std::string & pond_name = "myHipe") const {
+        return this->tracer && this->tracer->dump(path, pond_name);
+    }
+
+protected:
+    // 串行队列和溢出任务容器占用的内存，遍历时对每个串行队列加锁
+    size_t sharedBytes() const {
+        size_t bytes = this->overflow_tasks.capacity() * sizeof(util::SafeTask);
+        if (this->strands) {
+            bytes += sizeof(Strand) * (this->strand_mask + 1);
+            for (size_t i = 0; i <= this->strand_mask; i++) {
+                std::lock_guard<util::SpinLock> lock(this->strands[i].locker);
+                bytes += this->strands[i].tasks.memoryBytes();
+            }
+        }
+        return bytes;
+    }
+
+    /**
+     * @brief 工作线程进入空闲时调用，处理 shrinkToFit 的请求或者在空闲足够久之后释放自己任务队列的内存
+    */
+    void reclaimIdle(Type & self) {
+        if (self.shouldReclaim(this->shrink_epoch.load(std::memory_order_relaxed),
+                               this->reclaim_after_ns.load(std::memory_order_relaxed))) {
+            size_t keep = static_cast<size_t>(this->taskNum_of_thread_capacity);
+            self.shrinkOwned(keep);
+            self.shrinkShared(keep);
+        }
+    }
+
+    // 补偿线程，见 BlockingScope 和 enableBlockingWatchdog
+    struct Compensator {
+        std::thread handle;
+        std::atomic<bool> done{false};
+    };
+
+    /**
+     * @brief 从线程 start 开始依次尝试取出一个还没有开始执行的任务，在当前线程中执行
+     * @param self 当前线程在线程池中的编号，-1 表示不是工作线程
+    */
+    bool runPendingFrom(int start, int self) {
+        util::SafeTask task;
+        for (int i = start, j = 0; j < this->thread_numb; j++) {
+            if (this->threads[i].tryPopTask(task, i == self)) {
+                if (self >= 0) {
+                    this->threads[self].traceEvent(util::TraceEvent::RunBegin);
+                }
+                util::invoke(task);
+                if (self >= 0) {
+                    this->threads[self].traceEvent(util::TraceEvent::RunEnd);
+                    this->threads[self].markProgress();
+                    Policy::stats_type::addTasks(this->threads[self]);
+                }
+                this->threads[i].finishTasks(1);
+                return true;
+            }
+            util::recyclePlus(i, 0, this->thread_numb);
+        }
+        return false;
+    }
+
+    // 工作线程中的 BlockingScope 调用
+    static void blockingHook(const void * pond, int index, bool enter) {
+        FixedThreadPond * self = const_cast<FixedThreadPond *>(static_cast<const FixedThreadPond *>(pond));
+        Type & t = self->threads[index];
+        if (enter) {
+            if (t.enterBlocking()) {
+                self->blocking_scopes.fetch_add(1, std::memory_order_relaxed);
+                t.publishBuffer();
+                if (t.getTasksNumb() > 1) {     // 除了正在执行的任务之外还有任务在等待
+                    self->compensate(index);
+                }
+            }
+        }
+        else {
+            int64_t ns = t.leaveBlocking();
+            if (ns > 0) {
+                self->blocked_ns.fetch_add(ns, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief 为卡住的线程 index 创建一个补偿线程，已经有补偿线程或者达到上限时什么也不做
+    */
+    void compensate(int index) {
+        Type & t = this->threads[index];
+        int limit = this->max_compensators.load();
+        limit = (limit == 0) ? this->thread_numb : limit;
+
+        // 检查上限和增加 active_compensators 都在锁中，同时补偿几个线程时也不会超过上限
+        std::lock_guard<std::mutex> lock(this->compensate_locker);
+        if (this->is_stop || this->active_compensators.load() >= limit || !t.claimCompensation()) {
+            return;
+        }
+        // 顺便回收已经退出的补偿线程
+        for (size_t i = 0; i < this->compensators.size();) {
+            if (this->compensators[i]->done.load()) {
+                this->compensators[i]->handle.join();
+                this->compensators[i] = std::move(this->compensators.back());
+                this->compensators.pop_back();
+            }
+            else {
+                i++;
+            }
+        }
+        this->active_compensators.fetch_add(1);
+        this->compensations.fetch_add(1, std::memory_order_relaxed);
+        std::unique_ptr<Compensator> c(new Compensator);
+        c->handle = std::thread(&FixedThreadPond::runCompensator, this, index, t.getProgress(), c.get());
+        this->compensators.push_back(std::move(c));
+    }
+
+    /**
+     * @brief 补偿线程：执行线程 index 和其他线程公开队列中的任务，
+     * 直到线程 index 离开 BlockingScope 并且执行完了卡住的任务
+    */
+    void runCompensator(int index, uint64_t stuck, Compensator * self) {
+        Type & t = this->threads[index];
+        while (!this->is_stop && (t.isBlocking() || t.getProgress() == stuck)) {
+            if (!this->runPendingFrom(index, -1)) {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        }
+        t.releaseCompensation();
+        this->active_compensators.fetch_sub(1);
+        self->done.store(true);
+    }
+
+    /**
+     * @brief 看门狗：有任务的线程的任务序号超过 threshold 没有变化时，认为它卡住了
+    */
+    void watch(int64_t threshold) {
+        std::vector<uint64_t> last(static_cast<size_t>(this->thread_numb), 0);
+        std::vector<int64_t> since(static_cast<size_t>(this->thread_numb), util::steadyNowNs());
+        std::vector<char> stalled(static_cast<size_t>(this->thread_numb), 0);
+        auto period = std::chrono::nanoseconds(std::max<int64_t>(threshold / 4, 1000000));
+
+        while (!this->watchdog_stop.load()) {
+            std::this_thread::sleep_for(period);
+            int64_t now = util::steadyNowNs();
+            for (int i = 0; i < this->thread_numb; i++) {
+                Type & t = this->threads[i];
+                uint64_t progress = t.getProgress();
+                // BlockingScope 中的阻塞由 blockingHook 统计，这里只在阻塞期间有新任务时补偿
+                if (t.getTasksNumb() == 0 || progress != last[i] || t.isBlocking()) {
+                    if (stalled[i]) {
+                        this->blocked_ns.fetch_add(now - since[i], std::memory_order_relaxed);
+                        stalled[i] = 0;
+                    }
+                    if (t.isBlocking() && t.getTasksNumb() > 1) {
+                        this->compensate(i);
+                    }
+                    last[i] = progress;
+                    since[i] = now;
+                    continue;
+                }
+                // 只有卡住的任务本身时没有其他任务被耽误，不需要补偿
+                if (now - since[i] >= threshold && t.getTasksNumb() > 1) {
+                    if (!stalled[i]) {
+                        stalled[i] = 1;
+                        this->stalls_detected.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    this->compensate(i);
+                }
+            }
+        }
+    }
+
+    // 工作线程启动时调用，标记当前线程属于这个线程池
+    void bindCurrentWorker(int index) {
+        currentWorker().pond = static_cast<const void *>(this);
+        currentWorker().index = index;
+        currentWorker().on_blocking = &FixedThreadPond::blockingHook;
+        this->threads[index].updateCpu();
+        this->threads[index].getStealRand().seed(0x9E3779B9u * static_cast<uint32_t>(index + 1));
+    }
+
+    /**
+     * @brief 线程 index 按照 steal_order 的顺序最多尝试 max_steal 次窃取任务
+     * @param take 尝试从线程 i 窃取任务，bool(int i)，窃取成功返回 true
+     * @return 被窃取的线程编号，没有窃取到任务时返回 -1
+    */
+    template <typename Take>
+    int trySteal(int index, Take && take) {
+        using Stats = typename Policy::stats_type;
+
+        Type & self = this->threads[index];
+        int others = this->thread_numb - 1;
+        if (others <= 0) {
+            return -1;
+        }
+
+        const util::CpuTopology & topology = util::CpuTopology::get();
+        bool known = topology.known();
+        bool by_distance = known && this->steal_order == StealOrder::Topology;
+        int self_cpu = -1;
+        if (known) {
+            self.updateCpu();
+            self_cpu = self.getCpu();
+        }
+
+        // 从 start 开始依次经过除自己以外的所有线程，按照距离分成几轮，近的先尝试
+        int start = (this->steal_order == StealOrder::Linear) ? 0 : static_cast<int>(self.getStealRand().next() % static_cast<uint32_t>(others));
+        int last_tier = by_distance ? util::cpu_distance_remote : util::cpu_distance_cache;
+        int probes = 0;
+        for (int tier = util::cpu_distance_cache; tier <= last_tier; tier++) {
+            for (int k = 0; k < others && probes < this->max_steal; k++) {
+                int victim = (index + 1 + (start + k) % others) % this->thread_numb;
+                int distance = known ? topology.distance(self_cpu, this->threads[victim].getCpu()) : util::cpu_distance_cache;
+                if (by_distance && distance != tier) {
+                    continue;
+                }
+                probes += 1;
+                bool stolen = take(victim);
+                Stats::addStealAttempt(self, stolen, distance != util::cpu_distance_cache);
+                if (stolen) {
+                    return victim;
+                }
+            }
+        }
+        return -1;
+    }
+
+    // 在提交任务的线程的缓冲区中记录一次入队，target 是任务实际放入的线程
+    void traceSubmit(const Type * target, int numb) {
+        util::TraceRing * ring = this->submit_trace.load(std::memory_order_acquire);
+        if (ring != nullptr) {
+            ring->record(util::TraceEvent::Enqueue, static_cast<int>(target - this->threads.get()), numb);
+        }
+    }
+
+public:
+    // ====================================================
+    //                 按 key 有序提交
+    // ====================================================
+
+    /**
+     * @brief 提交一个和 key 关联的任务
+     * 同一个 key 的任务按照提交顺序执行，并且不会同时执行；不同的 key 在不同的线程中并行执行。
+     * key 被散列到固定数量的 Strand 上，散列到同一个 Strand 的不同 key 也会串行执行
+     * 注意：排队中的任务保存在 Strand 中，不受线程池任务容量的限制
+     * @param key 例如连接的编号
+     * @param func 可执行对象
+    */
+    template <typename Func>
+    void submitKeyed(uint64_t key, Func && func) {
+        std::call_once(this->strand_once, [this] () {
+            size_t numb = 1;
+            while (numb < static_cast<size_t>(this->thread_numb) * strands_per_thread) {
+                numb <<= 1;
+            }
+            this->strand_mask = numb - 1;
+            this->strands.reset(new Strand[numb]);
+            this->strand_bytes.fetch_add(sizeof(Strand) * numb, std::memory_order_relaxed);
+        });
+
+        // 斐波那契散列，连续的 key 也会被分散到不同的 Strand
+        Strand & strand = this->strands[(key * 0x9E3779B97F4A7C15ULL >> 32) & this->strand_mask];
+        bool schedule = false;
+        {
+            util::SpinLock_guard lock(strand.locker);
+            size_t before = strand.tasks.memoryBytes();
+            strand.tasks.emplace(std::forward<Func>(func));
+            this->strand_bytes.fetch_add(strand.tasks.memoryBytes() - before, std::memory_order_relaxed);
+            if (!strand.scheduled) {
+                strand.scheduled = true;
+                schedule = true;
+            }
+        }
+        if (schedule) {
+            Type * t = this->getLeastBusyThread();
+            t->enqueue(StrandDrain{this, &strand});
+            this->traceSubmit(t, 1);
+        }
+    }
+
+protected:
+    // 排空一个 Strand 的任务
+    struct StrandDrain {
+        FixedThreadPond * pond;
+        Strand * strand;
+
+        void operator()() {
+            this->pond->drainStrand(*this->strand);
+        }
+    };
+
+    /**
+     * @brief 按顺序执行 Strand 中的任务，最多执行 strand_batch 个，
+     * 还有剩余任务时把排空任务放回当前线程的队列末尾，让其他任务也有机会执行
+    */
+    void drainStrand(Strand & strand) {
+        for (int i = 0; i < strand_batch; i++) {
+            util::SafeTask task;
+            {
+                util::SpinLock_guard lock(strand.locker);
+                if (strand.tasks.empty()) {
+                    strand.scheduled = false;
+                    return;
+                }
+                task = std::move(strand.tasks.front());
+                strand.tasks.pop();
+            }
+            util::invoke(task);
+        }
+        Type * t = this->isWorkerThread() ? &this->threads[currentWorker().index] : this->getLeastBusyThread();
+        t->enqueue(StrandDrain{this, &strand});
+    }
+
 public:
     // ====================================================
     //                 任务溢出机制
@@ -409,14 +1430,21 @@ protected:
         return true;
     }
 
+    // 记录溢出任务容器占用的内存，用于 stats()
+    void recordOverflow() {
+        this->overflow_bytes.store(this->overflow_tasks.capacity() * sizeof(util::SafeTask), std::memory_order_relaxed);
+    }
+
     /**
      * @brief 任务溢出后，进行回调一个任务
      * @param T 类似于 SafeTask类型
     */
     template <typename T>
     void taskOverFlow(T && task) {
+        this->overflow_count += 1;
         this->overflow_tasks.clear();
         this->overflow_tasks.emplace_back(std::forward<T>(task));
+        this->recordOverflow();
 
         if (this->refuse_call_back.isSet()) {
             util::invoke(this->refuse_call_back);
@@ -435,6 +1463,7 @@ protected:
     template <typename T>
     void taskOverFlow(T && tasks, int left, int right) {
         int nums = right - left;
+        this->overflow_count += static_cast<uint64_t>(nums);
         this->overflow_tasks.clear();
         // this->overflowTasks 的容量不够，进行扩充
         if (static_cast<int>(this->overflow_tasks.capacity()) < nums) {
@@ -444,6 +1473,7 @@ protected:
         for (int i = left; i < right; i++) {
             this->overflow_tasks.emplace_back(std::move(tasks[i]));
         }
+        this->recordOverflow();
         
         if (this->refuse_call_back.isSet()) {
             util::invoke(this->refuse_call_back);
@@ -461,10 +1491,32 @@ protected:
     int cousor_move_limit{0};       // 在任务窃取时(负载均衡机制)，游标可以移动的范围
     int max_steal{0};               // 线程池最多可以偷窃的任务数量
     bool enable_steal_tasks{false}; // 是否可以使用 任务窃取
+    StealOrder steal_order{StealOrder::Topology};      // 选择被窃取线程的顺序
     std::unique_ptr<Type[]> threads{nullptr};           // 指向线程池的指针（Type 是 ThreadBase）
     int taskNum_of_thread_capacity{0};                             // 每个线程的任务容量
     std::vector<util::SafeTask> overflow_tasks{1};   // 提交失败的任务
     util::SafeTask refuse_call_back;                    // 处理任务溢出，回调到 refuse_call_back 中
+    std::unique_ptr<util::PondTracer> tracer{nullptr};  // 活动追踪器，开启追踪后才会创建
+    std::atomic<util::TraceRing *> submit_trace{nullptr};   // 提交任务的线程的追踪缓冲区
+    std::atomic<uint64_t> overflow_count{0};            // 溢出的任务总数
+    std::unique_ptr<Strand[]> strands{nullptr};         // submitKeyed 使用的串行队列，第一次使用时创建
+    size_t strand_mask{0};
+    std::once_flag strand_once;
+    std::atomic<int64_t> reclaim_after_ns{0};           // 空闲多久之后回收任务队列的内存，0 表示不回收
+    std::atomic<uint64_t> shrink_epoch{0};              // shrinkToFit 的请求序号
+    std::atomic<size_t> strand_bytes{0};                // 串行队列占用的内存，修改串行队列后更新
+    std::atomic<size_t> overflow_bytes{0};              // 溢出任务容器占用的内存
+
+    std::mutex compensate_locker;                       // 保护 compensators
+    std::vector<std::unique_ptr<Compensator>> compensators;
+    std::atomic<int> max_compensators{0};               // 同时存在的补偿线程的上限，0 表示线程的数量
+    std::atomic<int> active_compensators{0};
+    std::thread watchdog;
+    std::atomic<bool> watchdog_stop{false};
+    std::atomic<uint64_t> blocking_scopes{0};           // 进入最外层 BlockingScope 的次数
+    std::atomic<uint64_t> stalls_detected{0};           // 看门狗发现线程卡住的次数
+    std::atomic<uint64_t> compensations{0};             // 创建补偿线程的次数
+    std::atomic<int64_t> blocked_ns{0};                 // 阻塞的总时间
 };
 
 }   // !! namespace myHipd
@@ -4,5 +4,14 @@
 #include "./thread_pond/steady_pond.h"
 #include "./thread_pond/balanced_pond.h"
 #include "./thread_pond/dynamic_pond.h"
+#include "./thread_pond/hybrid_pond.h"
+#include "./thread_pond/typed_pond.h"
+#include "./thread_pond/shared_pond.h"
+#include "./thread_pond/laned_pond.h"
+#include "./task_group.h"
+#include "./pipeline.h"
+#include "./algorithm.h"
+#include "./reactor.h"
+#include "./async_io.h"
 
 #endif
\ No newline at end of file
@@ -0,0 +1,466 @@
+#ifndef MYHIPE_INCLUDE_PIPELINE_H__
+#define MYHIPE_INCLUDE_PIPELINE_H__
+
+//===-- pipeline.h - 多阶段流水线 -------*- C++ -*-----------===//
+//
+//     把 parse -> transform -> serialize 这样的处理过程拆成多个阶段，每个阶段在
+// 指定的线程池上执行，最多同时有 parallelism 个任务，阶段之间通过有界的无锁队列
+// util::MpmcQueue 连接：
+//
+//     auto pipe = Pipeline<std::string>::build()
+//                     .then(pond, parse, 2)               // std::string -> Record
+//                     .then(pond, transform, 4, 256)      // Record -> Record
+//                     .sink(io_pond, write, 1, 256);      // Record -> void
+//     pipe.push(line);
+//     pipe.wait();
+//
+// 反压：
+//     每个阶段的输入队列都有容量，一个阶段在取出数据之前先在下一个阶段的队列中占好
+// 位置，占不到位置就停下（stall），不会阻塞线程池的线程；下一个阶段取出数据后会
+// 重新调度上一个阶段。第一个阶段的队列满了时，push() 会等待，所以生产者的速度最终
+// 被最慢的阶段限制，队列中的数据总量不会超过各个阶段的容量之和。
+//
+//     一个阶段在线程池中的任务每次最多处理 pipeline_batch 个数据，之后退出，把线程
+// 让给线程池中的其他任务。阶段之间的数据必须可以默认构造和移动，线程池应当是无界的。
+//
+// 异常：
+//     阶段的函数抛出异常时，这个数据被丢弃（不会进入后面的阶段），占好的位置被释放，
+// 流水线继续处理其他数据。第一个异常被保存下来，由 wait() 重新抛出。
+//
+//===----------------------------------------------------------------------===//
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "./util.h"
+#include "./stats.h"
+
+namespace myHipe
+{
+
+static const int pipeline_batch = 64;       // 一个阶段的任务每次最多处理的数据数量
+
+// ======================================
+//  流水线所有阶段共享的状态
+// ======================================
+struct PipelineState
+{
+    std::atomic<int64_t> in_flight{0};          // 已经 push 但是还没有被最后一个阶段处理完的数据数量
+    std::atomic<int> runners{0};                // 已经提交到线程池中还没有结束的任务数量
+    bool drained{true};                         // 最后一个数据是否已经发出了通知
+    std::exception_ptr error;                   // 阶段的函数抛出的第一个异常，由 wait() 重新抛出
+    std::mutex locker;
+    std::condition_variable done_cond_var;
+    std::chrono::steady_clock::time_point start{std::chrono::steady_clock::now()};
+
+    void startOne() {
+        // 从 0 变为 1 时，清除上一轮的结束标记
+        if (this->in_flight.fetch_add(1) == 0) {
+            std::lock_guard<std::mutex> lock(this->locker);
+            this->drained = false;
+        }
+    }
+
+    void finishOne() {
+        if (this->in_flight.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(this->locker);
+            this->drained = true;
+            this->done_cond_var.notify_all();
+        }
+    }
+
+    // 记录阶段的函数抛出的异常，只保留第一个
+    void fail(std::exception_ptr e) {
+        std::lock_guard<std::mutex> lock(this->locker);
+        if (!this->error) {
+            this->error = e;
+        }
+    }
+};
+
+class PipelineStageBase
+{
+public:
+    virtual ~PipelineStageBase() = default;
+
+    // 若有数据并且还没有达到并行度，向线程池提交一个任务
+    virtual void schedule() = 0;
+
+    virtual util::StageStats stats(double seconds) const = 0;
+};
+
+// ======================================
+//  有输入队列的阶段
+//  slots 是输入队列中已经被占用的位置（算上上一个阶段占好但还没有放入的），
+//  它不超过 capacity，所以放入数据时 MpmcQueue 一定不会满
+// ======================================
+template <typename T>
+class PipelineInput : public PipelineStageBase
+{
+public:
+    explicit PipelineInput(size_t capacity) : queue(capacity), capacity(capacity) {}
+
+    /**
+     * @brief 占用输入队列中的一个位置
+     * @return 队列满了 -- false
+    */
+    bool acquireSlot() {
+        size_t used = this->slots.load();
+        while (used < this->capacity) {
+            if (this->slots.compare_exchange_weak(used, used + 1)) {
+                size_t seen = this->max_occupancy.load(std::memory_order_relaxed);
+                while (used + 1 > seen && !this->max_occupancy.compare_exchange_weak(seen, used + 1, std::memory_order_relaxed)) {}
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 放弃占用的位置
+    void releaseSlot() {
+        this->slots.fetch_sub(1);
+    }
+
+    bool hasSpace() const {
+        return this->slots.load() < this->capacity;
+    }
+
+    /**
+     * @brief 放入一个数据并调度这个阶段，调用前必须已经通过 acquireSlot 占好了位置
+    */
+    void put(T && item) {
+        bool pushed = this->queue.tryPush(std::move(item));
+        assert(pushed);
+        (void)pushed;
+        this->items.fetch_add(1);
+        this->schedule();
+    }
+
+protected:
+    util::MpmcQueue<T> queue;
+    const size_t capacity;
+    std::atomic<size_t> slots{0};
+    std::atomic<size_t> items{0};               // 输入队列中可以取出的数据数量
+    std::atomic<size_t> max_occupancy{0};
+};
+
+// ======================================
+//  流水线的一个阶段，在 Pond 上执行 Func
+//  Func 的返回值是 void 时是最后一个阶段
+// ======================================
+template <typename T, typename Func, typename Pond>
+class PipelineStage : public PipelineInput<T>
+{
+public:
+    using Out = typename std::result_of<Func(T)>::type;
+    using NextItem = typename std::conditional<std::is_void<Out>::value, char, typename std::decay<Out>::type>::type;
+    using Next = PipelineInput<NextItem>;
+
+    PipelineStage(int index, Pond & pond, Func && func, int parallelism, size_t capacity, PipelineState * state)
+        : PipelineInput<T>(capacity), index(index), pond(pond), func(std::forward<Func>(func)), parallelism(parallelism), state(state) {}
+
+    void schedule() override {
+        if (this->items.load() == 0 || (this->next != nullptr && !this->next->hasSpace())) {
+            return;
+        }
+        int now = this->active.load();
+        while (now < this->parallelism) {
+            if (this->active.compare_exchange_weak(now, now + 1)) {
+                this->state->runners.fetch_add(1);
+                this->pond.submit(Runner{this});
+                return;
+            }
+        }
+    }
+
+    util::StageStats stats(double seconds) const override {
+        util::StageStats ss;
+        ss.index = this->index;
+        ss.parallelism = this->parallelism;
+        ss.active = this->active.load(std::memory_order_relaxed);
+        ss.capacity = this->capacity;
+        ss.occupancy = this->slots.load(std::memory_order_relaxed);
+        ss.max_occupancy = this->max_occupancy.load(std::memory_order_relaxed);
+        ss.processed = this->processed.load(std::memory_order_relaxed);
+        ss.stalls = this->stalls.load(std::memory_order_relaxed);
+        ss.throughput = (seconds > 0) ? static_cast<double>(ss.processed) / seconds : 0.0;
+        return ss;
+    }
+
+    // 由 PipelineBuilder 连接前后两个阶段
+    PipelineStageBase * prev{nullptr};
+    Next * next{nullptr};
+
+private:
+    struct Runner {
+        PipelineStage * stage;
+
+        void operator()() {
+            PipelineState * state = this->stage->state;
+            this->stage->run();
+            state->runners.fetch_sub(1);        // 之后不能再访问这个阶段，流水线可能已经被析构了
+        }
+    };
+
+    void run() {
+        for (int i = 0; i < pipeline_batch; i++) {
+            // 先在下一个阶段占好位置，占不到就停下，等下一个阶段取出数据后重新调度
+            if (this->next != nullptr && !this->next->acquireSlot()) {
+                this->stalls.fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+            T item;
+            if (!this->queue.tryPop(item)) {
+                if (this->next != nullptr) {
+                    this->next->releaseSlot();
+                }
+                break;
+            }
+            this->items.fetch_sub(1);
+            this->releaseSlot();
+            if (this->prev != nullptr) {
+                this->prev->schedule();     // 上一个阶段可能因为这里满了而停下
+            }
+            try {
+                this->process(std::move(item), std::is_void<Out>());
+            }
+            catch (...) {
+                // 丢弃这个数据：释放在下一个阶段占好的位置，它不会再到达最后一个阶段
+                if (this->next != nullptr) {
+                    this->next->releaseSlot();
+                }
+                this->state->fail(std::current_exception());
+                this->state->finishOne();
+                continue;
+            }
+            this->processed.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // 先退出再检查，和 put / releaseSlot 之后的 schedule 配合，不会漏掉调度
+        this->active.fetch_sub(1);
+        this->schedule();
+    }
+
+    void process(T && item, std::false_type) {
+        this->next->put(this->func(std::move(item)));
+    }
+
+    void process(T && item, std::true_type) {
+        this->func(std::move(item));
+        this->state->finishOne();
+    }
+
+private:
+    int index;
+    Pond & pond;
+    typename std::decay<Func>::type func;
+    int parallelism;
+    PipelineState * state;
+    std::atomic<int> active{0};
+    std::atomic<uint64_t> processed{0};
+    std::atomic<uint64_t> stalls{0};
+};
+
+template <typename In>
+class Pipeline;
+
+// ======================================
+//  构造流水线，In 是流水线的输入类型，Cur 是最后一个阶段的输出类型
+// ======================================
+template <typename In, typename Cur>
+class PipelineBuilder
+{
+    template <typename, typename>
+    friend class PipelineBuilder;
+
+    friend class Pipeline<In>;
+
+public:
+    /**
+     * @brief 添加一个中间阶段
+     * @param pond 执行这个阶段的线程池
+     * @param func 处理一个数据，参数是 Cur，返回值是下一个阶段的输入
+     * @param parallelism 最多同时执行的任务数量
+     * @param capacity 这个阶段输入队列的容量
+    */
+    template <typename Pond, typename Func>
+    auto then(Pond & pond, Func && func, int parallelism = 1, size_t capacity = 1024)
+        -> PipelineBuilder<In, typename std::decay<typename std::result_of<Func(Cur)>::type>::type> {
+        using Out = typename std::result_of<Func(Cur)>::type;
+        static_assert(!std::is_void<Out>::value, "[HipeError]: The last stage of a pipeline must be added by sink().");
+
+        PipelineStage<Cur, Func, Pond> * stage = this->addStage(pond, std::forward<Func>(func), parallelism, capacity);
+        PipelineBuilder<In, typename std::decay<Out>::type> result(std::move(this->state), std::move(this->stages), this->first, &stage->next, stage);
+        return result;
+    }
+
+    /**
+     * @brief 添加最后一个阶段，返回构造好的流水线
+     * @param func 处理一个数据，返回值是 void
+    */
+    template <typename Pond, typename Func>
+    Pipeline<In> sink(Pond & pond, Func && func, int parallelism = 1, size_t capacity = 1024) {
+        static_assert(std::is_void<typename std::result_of<Func(Cur)>::type>::value, "[HipeError]: The sink of a pipeline must return void.");
+
+        this->addStage(pond, std::forward<Func>(func), parallelism, capacity);
+        return Pipeline<In>(std::move(this->state), std::move(this->stages), this->first);
+    }
+
+private:
+    PipelineBuilder(std::unique_ptr<PipelineState> state, std::vector<std::unique_ptr<PipelineStageBase>> stages,
+                    PipelineInput<In> * first, PipelineInput<Cur> ** tail, PipelineStageBase * last)
+        : state(std::move(state)), stages(std::move(stages)), first(first), tail(tail), last(last) {}
+
+    template <typename Pond, typename Func>
+    PipelineStage<Cur, Func, Pond> * addStage(Pond & pond, Func && func, int parallelism, size_t capacity) {
+        if (parallelism <= 0 || capacity == 0) {
+            throw std::invalid_argument("[myHipeError]: The parallelism and capacity of a pipeline stage must be positive.");
+        }
+        PipelineStage<Cur, Func, Pond> * stage = new PipelineStage<Cur, Func, Pond>(
+            static_cast<int>(this->stages.size()), pond, std::forward<Func>(func), parallelism, capacity, this->state.get());
+        this->stages.emplace_back(stage);
+
+        if (this->tail == nullptr) {
+            this->setFirst(stage);
+        }
+        else {
+            *this->tail = stage;
+        }
+        stage->prev = this->last;
+        return stage;
+    }
+
+    void setFirst(PipelineInput<In> * stage) {
+        this->first = stage;
+    }
+
+    // 只有 Cur 和 In 相同时才会是第一个阶段
+    template <typename U>
+    void setFirst(PipelineInput<U> *) {}
+
+private:
+    std::unique_ptr<PipelineState> state;
+    std::vector<std::unique_ptr<PipelineStageBase>> stages;
+    PipelineInput<In> * first{nullptr};
+    PipelineInput<Cur> ** tail{nullptr};        // 最后一个阶段的 next
+    PipelineStageBase * last{nullptr};          // 最后一个阶段
+};
+
+// ======================================
+//                流水线
+// ======================================
+template <typename In>
+class Pipeline
+{
+    template <typename, typename>
+    friend class PipelineBuilder;
+
+public:
+    /**
+     * @brief 开始构造一条流水线
+    */
+    static PipelineBuilder<In, In> build() {
+        return PipelineBuilder<In, In>(std::unique_ptr<PipelineState>(new PipelineState), std::vector<std::unique_ptr<PipelineStageBase>>(),
+                                       nullptr, nullptr, nullptr);
+    }
+
+    Pipeline(Pipeline &&) = default;
+    Pipeline & operator = (Pipeline &&) = delete;
+
+    // 线程池中的任务引用了各个阶段，析构前必须等待所有数据处理完、所有任务结束
+    ~Pipeline() {
+        if (this->state) {
+            this->waitDrained();
+            while (this->state->runners.load() != 0) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+public:
+    /**
+     * @brief 放入一个数据，第一个阶段的队列满了时等待
+    */
+    void push(In item) {
+        while (!this->first->acquireSlot()) {
+            std::this_thread::yield();
+        }
+        this->state->startOne();
+        this->first->put(std::move(item));
+    }
+
+    /**
+     * @brief 尝试放入一个数据，第一个阶段的队列满了时立刻返回
+     * @return 放入成功 -- true，失败时 item 不会被移动
+    */
+    bool tryPush(In & item) {
+        if (!this->first->acquireSlot()) {
+            return false;
+        }
+        this->state->startOne();
+        this->first->put(std::move(item));
+        return true;
+    }
+
+    /**
+     * @brief 等待所有放入的数据被最后一个阶段处理完（或者被丢弃）
+     * 若有阶段的函数抛出了异常，重新抛出第一个异常，之后清除它
+    */
+    void wait() {
+        std::exception_ptr error = this->waitDrained();
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    /**
+     * @return 还没有被最后一个阶段处理完的数据数量
+    */
+    int64_t getInFlight() const {
+        return this->state->in_flight.load();
+    }
+
+    /**
+     * @brief 获取每个阶段的运行指标的快照，throughput 是从流水线创建开始的平均值
+    */
+    std::vector<util::StageStats> stats() const {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - this->state->start).count();
+        std::vector<util::StageStats> result;
+        result.reserve(this->stages.size());
+        for (size_t i = 0; i < this->stages.size(); i++) {
+            result.push_back(this->stages[i]->stats(seconds));
+        }
+        return result;
+    }
+
+private:
+    // 等待流水线排空，取出保存的异常
+    std::exception_ptr waitDrained() {
+        std::unique_lock<std::mutex> lock(this->state->locker);
+        this->state->done_cond_var.wait(lock, [this] () -> bool {
+            return this->state->in_flight.load() == 0 && this->state->drained;
+        });
+        std::exception_ptr error = this->state->error;
+        this->state->error = nullptr;
+        return error;
+    }
+
+    Pipeline(std::unique_ptr<PipelineState> state, std::vector<std::unique_ptr<PipelineStageBase>> stages, PipelineInput<In> * first)
+        : state(std::move(state)), stages(std::move(stages)), first(first) {}
+
+private:
+    std::unique_ptr<PipelineState> state;
+    std::vector<std::unique_ptr<PipelineStageBase>> stages;
+    PipelineInput<In> * first{nullptr};
+};
+
+}   // !! myHipe
+
+#endif  // !! MYHIPE_INCLUDE_PIPELINE_H__
@@ -0,0 +1,321 @@
+#ifndef MYHIPE_INCLUDE_POLICY_H__
+#define MYHIPE_INCLUDE_POLICY_H__
+
+//===-- policy.h - 线程池的编译期策略 -------*- C++ -*-----------===//
+//
+//     线程类的任务队列、保护任务队列的锁、工作线程空闲时的等待方式以及运行指标
+// 的统计原本都写死在各个线程池中。PondPolicy 把它们组合成一个编译期的策略包，
+// 作为模板参数交给 FixedThreadPond 和 Steady / Balanced 线程池：
+//
+//     PondPolicy<Lock, Queue, Idle, Stats>
+//         Lock  -- 保护任务队列的锁：util::SpinLock / std::mutex / util::TTASLock<> ...
+//         Queue -- 任务队列：util::RingQueue(默认) / util::DequeQueue(std::queue) / util::ListQueue
+//                  / util::DeadlineQueue(最早截止优先)
+//         Idle  -- 没有任务时的等待方式：util::YieldIdle / util::SpinIdle / util::SleepIdle<us>
+//         Stats -- 运行指标：util::CountWorkerStats / util::NoWorkerStats
+//
+//     默认的任务队列是环形缓冲区 util::RingBuffer，有界的线程池在创建时就按照每个
+// 线程的任务容量分配好队列的空间；其余的默认策略和之前写死的行为相同。所有策略的
+// 选择都在编译期完成，不会引入虚函数调用或运行时判断。
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdint>
+#include <chrono>
+#include <list>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "./util.h"
+
+namespace myHipe
+{
+
+namespace util
+{
+
+// ======================
+//       任务队列策略
+// ======================
+
+// 环形缓冲区 util::RingBuffer，有界的线程池会在创建时按照每个线程的任务容量预先分配，
+// 之后提交和执行任务都不会再分配内存
+struct RingQueue
+{
+    template <typename T>
+    using type = RingBuffer<T>;
+};
+
+// std::queue（底层是 std::deque），按块分配内存
+struct DequeQueue
+{
+    template <typename T>
+    using type = std::queue<T>;
+};
+
+// 底层是 std::list，每个任务一个节点，入队出队不会移动其他元素
+struct ListQueue
+{
+    template <typename T>
+    using type = std::queue<T, std::list<T>>;
+};
+
+// ======================
+//       空闲等待策略
+//  每个工作线程持有一个自己的对象，没有任务时调用 wait()，拿到任务后调用 reset()
+// ======================
+
+// 让出 cpu，唤醒延迟低，但空闲时仍然会占用 cpu
+struct YieldIdle
+{
+    void wait() {
+        std::this_thread::yield();
+    }
+
+    void reset() {}
+};
+
+// 先指数退避地自旋，超过 max_spins_before_yield 之后让出 cpu，适合任务间隔很短的任务流
+class SpinIdle
+{
+public:
+    void wait() {
+        if (this->spins < max_spins_before_yield) {
+            for (uint64_t i = 0; i <= this->spins; i++) {
+                cpuRelax();
+            }
+            this->spins = (this->spins == 0) ? 1 : this->spins * 2;
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+
+    void reset() {
+        this->spins = 0;
+    }
+
+private:
+    uint64_t spins{0};
+};
+
+// 睡眠 Micro 微秒，空闲时几乎不占用 cpu，但是唤醒延迟最多为 Micro 微秒
+template <int Micro = 50>
+struct SleepIdle
+{
+    static_assert(Micro > 0, "[HipeError]: The sleep time of SleepIdle must be positive.");
+
+    void wait() {
+        std::this_thread::sleep_for(std::chrono::microseconds(Micro));
+    }
+
+    void reset() {}
+};
+
+// ======================
+//       运行指标策略
+// ======================
+
+// 统计每个工作线程的任务数、窃取次数、空闲 / 忙碌时间（见 stats.h）
+struct CountWorkerStats
+{
+    template <typename Thread>
+    static void addTasks(Thread & thread, uint64_t numb = 1) {
+        thread.getCounters().addTasks(numb);
+    }
+
+    template <typename Thread>
+    static void addStealAttempt(Thread & thread, bool success, bool remote = false) {
+        thread.getCounters().addStealAttempt(success, remote);
+    }
+
+    template <typename Thread>
+    static void markIdle(Thread & thread) {
+        thread.markIdle();
+    }
+
+    template <typename Thread>
+    static void markBusy(Thread & thread) {
+        thread.markBusy();
+    }
+};
+
+// 不统计，stats() 中的计数器都是 0，追踪时也不会记录 空闲 / 唤醒 事件
+struct NoWorkerStats
+{
+    template <typename Thread>
+    static void addTasks(Thread &, uint64_t = 1) {}
+
+    template <typename Thread>
+    static void addStealAttempt(Thread &, bool, bool = false) {}
+
+    template <typename Thread>
+    static void markIdle(Thread &) {}
+
+    template <typename Thread>
+    static void markBusy(Thread &) {}
+};
+
+// 按截止时间排序的队列 util::DeadlineHeap：通过 submitBefore 提交的任务按照最早截止优先
+// （EDF）的顺序执行，窃取时也先拿走最紧急的任务；没有截止时间的任务排在它们之后
+struct DeadlineQueue
+{
+    template <typename T>
+    using type = DeadlineHeap<T>;
+};
+
+struct PondPolicyTag {};
+
+// 预先分配队列的空间，只有 RingBuffer 支持，其他队列什么也不做
+template <typename Queue>
+inline void reserveQueue(Queue &, size_t) {}
+
+template <typename T>
+inline void reserveQueue(RingBuffer<T> & queue, size_t capacity)
+{
+    queue.reserve(capacity);
+}
+
+template <typename T>
+inline void reserveQueue(DeadlineHeap<T> & queue, size_t capacity)
+{
+    queue.reserve(capacity);
+}
+
+// 释放队列中多余的内存，至少保留 keep 个元素的容量
+// std::queue（std::deque）没有 shrink_to_fit，把元素移到一条新的队列中
+template <typename Queue>
+inline void shrinkQueue(Queue & queue, size_t)
+{
+    Queue temp;
+    while (!queue.empty()) {
+        temp.emplace(std::move(queue.front()));
+        queue.pop();
+    }
+    queue.swap(temp);
+}
+
+// std::list 出队时就释放了节点
+template <typename T>
+inline void shrinkQueue(std::queue<T, std::list<T>> &, size_t) {}
+
+template <typename T>
+inline void shrinkQueue(RingBuffer<T> & queue, size_t keep)
+{
+    queue.shrinkToFit(keep);
+}
+
+template <typename T>
+inline void shrinkQueue(DeadlineHeap<T> & queue, size_t keep)
+{
+    queue.shrinkToFit(keep);
+}
+
+// std::vector（TypedSteadyPond 的任务队列、溢出任务容器）
+template <typename T>
+inline void shrinkQueue(std::vector<T> & queue, size_t keep)
+{
+    size_t need = std::max(queue.size(), keep);
+    if (need < queue.capacity()) {
+        std::vector<T> temp;
+        temp.reserve(need);
+        for (size_t i = 0; i < queue.size(); i++) {
+            temp.emplace_back(std::move(queue[i]));
+        }
+        queue.swap(temp);
+    }
+}
+
+// 队列占用的堆内存，std::queue 只能按照元素的数量估计
+template <typename T>
+inline size_t queueBytes(const std::queue<T> & queue)
+{
+    return queue.size() * sizeof(T);
+}
+
+template <typename T>
+inline size_t queueBytes(const std::queue<T, std::list<T>> & queue)
+{
+    return queue.size() * (sizeof(T) + 2 * sizeof(void *));
+}
+
+template <typename T>
+inline size_t queueBytes(const std::vector<T> & queue)
+{
+    return queue.capacity() * sizeof(T);
+}
+
+template <typename T>
+inline size_t queueBytes(const RingBuffer<T> & queue)
+{
+    return queue.memoryBytes();
+}
+
+template <typename T>
+inline size_t queueBytes(const DeadlineHeap<T> & queue)
+{
+    return queue.memoryBytes();
+}
+
+// 把 from 的队首元素移动到 to 中，DeadlineHeap 会保留元素的截止时间
+template <typename Queue>
+inline void moveFront(Queue & from, Queue & to)
+{
+    to.emplace(std::move(from.front()));
+    from.pop();
+}
+
+template <typename T>
+inline void moveFront(DeadlineHeap<T> & from, DeadlineHeap<T> & to)
+{
+    from.moveFrontTo(to);
+}
+
+// 队列是否会按照截止时间排序
+template <typename Queue>
+struct isDeadlineQueue : std::false_type {};
+
+template <typename T>
+struct isDeadlineQueue<DeadlineHeap<T>> : std::true_type {};
+
+}   // !! namespace util
+
+// ======================
+//        策略包
+// ======================
+template <typename Lock = util::SpinLock, typename Queue = util::RingQueue,
+          typename Idle = util::YieldIdle, typename Stats = util::CountWorkerStats>
+struct PondPolicy : util::PondPolicyTag
+{
+    using lock_type = Lock;
+    using idle_type = Idle;
+    using stats_type = Stats;
+
+    template <typename T>
+    using queue_type = typename Queue::template type<T>;
+};
+
+namespace util
+{
+
+// =====================================================
+//  把模板参数转换为策略包：
+//  已经是 PondPolicy 的保持不变，否则把它当作锁的类型，例如 TicketLock<LockStats>
+// =====================================================
+template <typename T, bool = std::is_base_of<PondPolicyTag, T>::value>
+struct toPondPolicy
+{
+    using type = T;
+};
+
+template <typename T>
+struct toPondPolicy<T, false>
+{
+    using type = PondPolicy<T>;
+};
+
+}   // !! namespace util
+}   // !! namespace myHipe
+
+#endif  // !! MYHIPE_INCLUDE_POLICY_H__
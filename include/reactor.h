@@ -0,0 +1,306 @@
+#ifndef MYHIPE_INCLUDE_REACTOR_H__
+#define MYHIPE_INCLUDE_REACTOR_H__
+
+//===-- reactor.h - 把就绪的 fd 分发到线程池的 epoll 反应器 -------*- C++ -*-----------===//
+//
+//     原来的做法是在一个单独的线程中运行 epoll 循环，每个就绪的 fd 调用一次
+// submit()，每次都要经过 getLeastBusyThread 并对一个任务队列加锁。Reactor 的循环
+// 线程一次 epoll_wait 最多取出 max_events 个事件，按 fd 分配到固定的工作线程
+// （fd % thread_numb），再通过 submitInBatchTo 把每个线程的一批回调一次放入它的
+// 任务队列，一轮事件对每个线程只加锁一次。
+//
+//     顺序：fd 以 EPOLLONESHOT 注册，一个事件被取出后这个 fd 不会再产生事件，直到
+// 它的回调执行结束并重新启用（EPOLL_CTL_MOD），所以同一个 fd 的回调不会同时执行，
+// 并且按照事件发生的顺序执行。
+//
+//     唤醒：循环线程阻塞在 epoll_wait 中，析构时通过 eventfd 唤醒它。
+//
+//     只在 Linux 上可用，Pond 可以是 SteadyThreadPond / BalancedThreadPond，并且必须
+// 是无界的：有界的线程池会把超出容量的回调放到溢出队列中，这些 fd 不会再被重新启用，
+// 析构时也会一直等待它们的回调结束，所以构造时会拒绝有界的线程池。
+//
+//===----------------------------------------------------------------------===//
+
+#ifdef __linux__
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include "./util.h"
+
+namespace myHipe
+{
+
+template <typename Pond>
+class Reactor
+{
+public:
+    // 参数是 epoll 返回的事件（EPOLLIN / EPOLLOUT / EPOLLHUP ...）
+    using Callback = std::function<void(uint32_t)>;
+
+    /**
+     * @param pond 执行回调的线程池，需要比 Reactor 活得更久，必须是无界的
+     * @param max_events 每次 epoll_wait 最多取出的事件数量
+    */
+    explicit Reactor(Pond & pond, int max_events = 256)
+        : pond(pond), events(static_cast<size_t>(max_events > 0 ? max_events : 1)),
+          batches(static_cast<size_t>(pond.getThreadNumb())) {
+        if (pond.getTaskCapacity() != 0) {
+            throw std::invalid_argument("[myHipeError]: The pond of a reactor must be unbounded.");
+        }
+        this->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (this->epoll_fd < 0) {
+            throw std::runtime_error("[myHipeError]: epoll_create1 failed: " + std::string(std::strerror(errno)));
+        }
+        this->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (this->wake_fd < 0) {
+            ::close(this->epoll_fd);
+            throw std::runtime_error("[myHipeError]: eventfd failed: " + std::string(std::strerror(errno)));
+        }
+        epoll_event ev;
+        std::memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.u64 = wake_key;
+        epoll_ctl(this->epoll_fd, EPOLL_CTL_ADD, this->wake_fd, &ev);
+
+        this->loop_thread = std::thread(&Reactor::loop, this);
+    }
+
+    // 回调中引用了 Reactor，析构时先停止循环，再等待已经分发的回调全部结束
+    ~Reactor() {
+        this->stop.store(true);
+        this->wakeup();
+        if (this->loop_thread.joinable()) {
+            this->loop_thread.join();
+        }
+        while (this->running.load() != 0) {
+            std::this_thread::yield();
+        }
+        ::close(this->wake_fd);
+        ::close(this->epoll_fd);
+    }
+
+    Reactor(const Reactor &) = delete;
+    Reactor & operator = (const Reactor &) = delete;
+
+public:
+    /**
+     * @brief 监听一个 fd，它就绪时在线程池中执行 callback
+     * fd 应当是非阻塞的，回调中需要读完 / 写完当前可以处理的数据，回调结束后 fd 才会被重新监听
+     * @param fd 文件描述符，同一个 fd 不能重复添加
+     * @param events 监听的事件，例如 EPOLLIN、EPOLLOUT，不需要加 EPOLLONESHOT
+     * @param callback 参数是就绪的事件
+    */
+    void add(int fd, uint32_t events, Callback callback) {
+        std::shared_ptr<Handler> handler = std::make_shared<Handler>();
+        handler->fd = fd;
+        handler->events = events;
+        handler->callback = std::move(callback);
+
+        std::lock_guard<std::mutex> lock(this->locker);
+        if (this->handlers.count(fd)) {
+            throw std::invalid_argument("[myHipeError]: The fd has been added to the reactor.");
+        }
+        handler->generation = ++this->generation;
+        epoll_event ev = this->makeEvent(*handler);
+        if (epoll_ctl(this->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            throw std::runtime_error("[myHipeError]: epoll_ctl(ADD) failed: " + std::string(std::strerror(errno)));
+        }
+        this->handlers[fd] = std::move(handler);
+    }
+
+    /**
+     * @brief 修改监听的事件，只能在这个 fd 的回调中调用，回调结束后按新的事件重新监听
+     * 例如写缓冲区中还有数据时加上 EPOLLOUT
+    */
+    void modify(int fd, uint32_t events) {
+        std::lock_guard<std::mutex> lock(this->locker);
+        auto found = this->handlers.find(fd);
+        if (found == this->handlers.end()) {
+            throw std::invalid_argument("[myHipeError]: The fd has not been added to the reactor.");
+        }
+        found->second->events.store(events);
+    }
+
+    /**
+     * @brief 停止监听一个 fd，之后不会再分发新的回调
+     * 已经分发的回调可能仍在执行，fd 应当在回调结束后再关闭（例如在回调中调用 remove 后关闭）
+     * @return 若 fd 被添加过 -- true，反之
+    */
+    bool remove(int fd) {
+        std::lock_guard<std::mutex> lock(this->locker);
+        auto found = this->handlers.find(fd);
+        if (found == this->handlers.end()) {
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> handler_lock(found->second->locker);
+            found->second->removed.store(true);
+            epoll_ctl(this->epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        }
+        this->handlers.erase(found);
+        return true;
+    }
+
+    /**
+     * @return 正在监听的 fd 数量
+    */
+    size_t size() {
+        std::lock_guard<std::mutex> lock(this->locker);
+        return this->handlers.size();
+    }
+
+    /**
+     * @return 分发的回调总数
+    */
+    uint64_t getDispatched() const {
+        return this->dispatched_count.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @return epoll_wait 返回的次数（每次分发一批回调）
+    */
+    uint64_t getRounds() const {
+        return this->rounds.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Handler {
+        int fd{-1};
+        uint32_t generation{0};
+        std::atomic<uint32_t> events{0};
+        std::atomic<bool> removed{false};
+        std::mutex locker;                          // 重新监听和 remove 互斥
+        Callback callback;
+    };
+
+    // 线程池中执行的任务，结束后重新监听 fd
+    struct Dispatch {
+        Reactor * reactor;
+        std::shared_ptr<Handler> handler;
+        uint32_t revents;
+
+        void operator()() {
+            Reactor * r = this->reactor;
+            this->reactor->run(*this->handler, this->revents);
+            this->handler.reset();
+            r->running.fetch_sub(1);        // 之后不能再访问 Reactor
+        }
+    };
+
+    // epoll 的 data 中保存 fd 和 generation，fd 被关闭后重新使用时可以识别出过期的事件
+    static uint64_t keyOf(const Handler & handler) {
+        return (static_cast<uint64_t>(handler.generation) << 32) | static_cast<uint32_t>(handler.fd);
+    }
+
+    static epoll_event makeEvent(const Handler & handler) {
+        epoll_event ev;
+        std::memset(&ev, 0, sizeof(ev));
+        ev.events = handler.events.load() | EPOLLONESHOT;
+        ev.data.u64 = keyOf(handler);
+        return ev;
+    }
+
+    void wakeup() {
+        uint64_t one = 1;
+        ssize_t n = ::write(this->wake_fd, &one, sizeof(one));
+        (void)n;
+    }
+
+    void run(Handler & handler, uint32_t revents) {
+        try {
+            handler.callback(revents);
+        }
+        catch (...) {
+            // 回调的异常不能传播到线程池中，忽略
+        }
+
+        // 和 remove 互斥，避免重新启用一个已经删除的 fd（fd 可能已经被关闭并重新使用）
+        std::lock_guard<std::mutex> lock(handler.locker);
+        if (!handler.removed.load()) {
+            epoll_event ev = this->makeEvent(handler);
+            epoll_ctl(this->epoll_fd, EPOLL_CTL_MOD, handler.fd, &ev);
+        }
+    }
+
+    void loop() {
+        while (!this->stop.load()) {
+            int n = epoll_wait(this->epoll_fd, this->events.data(), static_cast<int>(this->events.size()), -1);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            this->rounds.fetch_add(1, std::memory_order_relaxed);
+            this->dispatchEvents(n);
+        }
+    }
+
+    // 一轮事件按照 fd 分配线程，每个线程的回调一次提交
+    void dispatchEvents(int n) {
+        int thread_numb = static_cast<int>(this->batches.size());
+        {
+            std::lock_guard<std::mutex> lock(this->locker);
+            for (int i = 0; i < n; i++) {
+                uint64_t key = this->events[i].data.u64;
+                if (key == wake_key) {
+                    uint64_t value;
+                    ssize_t r = ::read(this->wake_fd, &value, sizeof(value));
+                    (void)r;
+                    continue;
+                }
+                int fd = static_cast<int>(static_cast<uint32_t>(key));
+                auto found = this->handlers.find(fd);
+                if (found == this->handlers.end() || keyOf(*found->second) != key) {
+                    continue;       // 已经删除的 fd
+                }
+                this->running.fetch_add(1);
+                this->batches[fd % thread_numb].emplace_back(Dispatch{this, found->second, this->events[i].events});
+            }
+        }
+        for (int i = 0; i < thread_numb; i++) {
+            std::vector<util::SafeTask> & batch = this->batches[i];
+            if (!batch.empty()) {
+                this->dispatched_count.fetch_add(batch.size(), std::memory_order_relaxed);
+                this->pond.submitInBatchTo(i, batch, batch.size());
+                batch.clear();
+            }
+        }
+    }
+
+private:
+    static const uint64_t wake_key = ~static_cast<uint64_t>(0);
+
+    Pond & pond;
+    int epoll_fd{-1};
+    int wake_fd{-1};
+    std::vector<epoll_event> events;
+    std::vector<std::vector<util::SafeTask>> batches;       // 每个线程的一批回调，只由循环线程使用
+    std::unordered_map<int, std::shared_ptr<Handler>> handlers;
+    uint32_t generation{0};
+    std::mutex locker;                                      // 保护 handlers 和 epoll_ctl
+    std::atomic<bool> stop{false};
+    std::atomic<int> running{0};                            // 已经分发还没有结束的回调数量
+    std::atomic<uint64_t> dispatched_count{0};
+    std::atomic<uint64_t> rounds{0};
+    std::thread loop_thread;
+};
+
+}   // !! myHipe
+
+#endif  // !! __linux__
+
+#endif  // !! MYHIPE_INCLUDE_REACTOR_H__
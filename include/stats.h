@@ -0,0 +1,336 @@
+#ifndef MYHIPE_INCLUDE_STATS_H__
+#define MYHIPE_INCLUDE_STATS_H__
+
+//===-- stats.h - 线程池的运行指标 -------*- C++ -*-----------===//
+//
+//     每个工作线程都有一组自己的计数器 WorkerCounters（执行的任务数、窃取次数、
+// 空闲次数、空闲 / 忙碌时间），只由工作线程自己写入，使用 relaxed 的原子读写，
+// 不需要加锁，也不需要 fetch_add。
+//     线程池的 stats() 会把这些计数器收集成一个快照 PondStats，toPrometheus()
+// 把快照渲染成 Prometheus 的文本格式，dumpPrometheus() 把它写入文件（先写临时文件
+// 再改名，可以直接给 node_exporter 的 textfile collector 使用）。
+//
+//===----------------------------------------------------------------------===//
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace myHipe
+{
+
+namespace util
+{
+
+inline int64_t steadyNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 只有一个线程写入的计数器，不需要 fetch_add
+template <typename T>
+inline void relaxedAdd(std::atomic<T> & counter, T value)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+// ======================
+//   一个工作线程的快照
+// ======================
+struct WorkerStats
+{
+    int index{0};                       // 线程的编号
+    int queue_depth{0};                 // 线程中的任务数量（算上正在执行的任务）
+    uint64_t tasks_executed{0};         // 执行完的任务数量
+    uint64_t steals_attempted{0};       // 尝试窃取的次数
+    uint64_t steals_succeeded{0};       // 成功窃取的次数
+    uint64_t steals_remote{0};          // 成功窃取中，被窃取的线程和自己不共享 L3 缓存的次数
+    uint64_t parks{0};                  // 进入空闲的次数
+    double idle_seconds{0};             // 空闲的总时间
+    double busy_seconds{0};             // 忙碌的总时间
+    uint64_t queue_bytes{0};            // 任务队列占用的堆内存
+};
+
+// ======================
+//    一个线程池的快照
+// ======================
+struct PondStats
+{
+    std::string pond_type;              // steady / balanced / dynamic / hybrid
+    int thread_numb{0};                 // 线程的数量
+    int tasks_remain{0};                // 线程池中的任务数量
+    uint64_t overflow_tasks{0};         // 溢出的任务总数
+    uint64_t memory_bytes{0};           // 线程池占用的内存，见 FixedThreadPond::memoryFootprint
+    std::vector<WorkerStats> workers;
+
+    // 所有线程执行完的任务总数
+    uint64_t tasksExecuted() const {
+        uint64_t result = 0;
+        for (size_t i = 0; i < this->workers.size(); i++) {
+            result += this->workers[i].tasks_executed;
+        }
+        return result;
+    }
+};
+
+// ======================
+//  阻塞的任务和补偿线程
+//  见 FixedThreadPond::blockingStats
+// ======================
+struct BlockingStats
+{
+    uint64_t scopes{0};                 // 进入 BlockingScope 的次数（只算最外层）
+    uint64_t stalls{0};                 // 看门狗发现线程卡在一个任务上的次数
+    uint64_t compensations{0};          // 创建补偿线程的次数
+    int active_compensators{0};         // 正在运行的补偿线程数量
+    double blocked_seconds{0};          // BlockingScope 和看门狗发现的阻塞的总时间
+};
+
+// ======================
+//    一个租户的快照
+//  见 BalancedThreadPond::tenantStats
+// ======================
+struct TenantStats
+{
+    int tenant{0};                      // 租户的编号
+    int weight{1};                      // 权重
+    int max_running{0};                 // 同时执行的任务上限，0 表示没有上限
+    int running{0};                     // 正在执行的任务数量
+    uint64_t submitted{0};              // 提交的任务总数
+    uint64_t completed{0};              // 执行完的任务总数
+    uint64_t queued{0};                 // 还在队列中等待的任务数量
+    uint64_t throttled{0};              // 因为达到上限而被跳过的次数
+};
+
+// ======================
+//  流水线中一个阶段的快照
+//  见 Pipeline::stats
+// ======================
+struct StageStats
+{
+    int index{0};                       // 阶段的编号，从 0 开始
+    int parallelism{1};                 // 最多同时执行的任务数量
+    int active{0};                      // 正在线程池中执行的任务数量
+    size_t capacity{0};                 // 输入队列的容量
+    size_t occupancy{0};                // 输入队列中的数据数量
+    size_t max_occupancy{0};            // 输入队列中数据数量的最大值
+    uint64_t processed{0};              // 处理完的数据数量
+    uint64_t stalls{0};                 // 因为下一个阶段的队列满了而暂停的次数
+    double throughput{0};               // 每秒处理的数据数量
+};
+
+// =====================================================
+//  工作线程的计数器，只由工作线程自己写入
+//  前面的填充使计数器和生产者频繁修改的 task_numb 不在同一个缓存行上
+// =====================================================
+class WorkerCounters
+{
+public:
+    WorkerCounters() : state_since(steadyNowNs()) {}
+
+    void addTasks(uint64_t numb = 1) {
+        relaxedAdd(this->tasks_executed, numb);
+    }
+
+    /**
+     * @param success 是否窃取成功
+     * @param remote 被窃取的线程是否和自己不共享 L3 缓存（见 topology.h）
+    */
+    void addStealAttempt(bool success, bool remote = false) {
+        relaxedAdd(this->steals_attempted, static_cast<uint64_t>(1));
+        if (success) {
+            relaxedAdd(this->steals_succeeded, static_cast<uint64_t>(1));
+            if (remote) {
+                relaxedAdd(this->steals_remote, static_cast<uint64_t>(1));
+            }
+        }
+    }
+
+    bool isIdle() const {
+        return this->idle.load(std::memory_order_relaxed);
+    }
+
+    // 忙碌 -> 空闲
+    void toIdle() {
+        int64_t now = steadyNowNs();
+        relaxedAdd(this->busy_ns, now - this->state_since.load(std::memory_order_relaxed));
+        relaxedAdd(this->parks, static_cast<uint64_t>(1));
+        this->state_since.store(now, std::memory_order_relaxed);
+        this->idle.store(true, std::memory_order_relaxed);
+    }
+
+    // 空闲 -> 忙碌
+    void toBusy() {
+        int64_t now = steadyNowNs();
+        relaxedAdd(this->idle_ns, now - this->state_since.load(std::memory_order_relaxed));
+        this->state_since.store(now, std::memory_order_relaxed);
+        this->idle.store(false, std::memory_order_relaxed);
+    }
+
+    // 任何线程都可以读取，当前所处状态的时间也会算进去
+    WorkerStats snapshot(int index, int queue_depth) const {
+        WorkerStats ws;
+        ws.index = index;
+        ws.queue_depth = queue_depth;
+        ws.tasks_executed = this->tasks_executed.load(std::memory_order_relaxed);
+        ws.steals_attempted = this->steals_attempted.load(std::memory_order_relaxed);
+        ws.steals_succeeded = this->steals_succeeded.load(std::memory_order_relaxed);
+        ws.steals_remote = this->steals_remote.load(std::memory_order_relaxed);
+        ws.parks = this->parks.load(std::memory_order_relaxed);
+
+        int64_t idle_ = this->idle_ns.load(std::memory_order_relaxed);
+        int64_t busy_ = this->busy_ns.load(std::memory_order_relaxed);
+        int64_t current = steadyNowNs() - this->state_since.load(std::memory_order_relaxed);
+        current = (current > 0) ? current : 0;
+        if (this->isIdle()) {
+            idle_ += current;
+        }
+        else {
+            busy_ += current;
+        }
+        ws.idle_seconds = static_cast<double>(idle_) / 1e9;
+        ws.busy_seconds = static_cast<double>(busy_) / 1e9;
+        return ws;
+    }
+
+private:
+    char padding[64];
+    std::atomic<uint64_t> tasks_executed{0};
+    std::atomic<uint64_t> steals_attempted{0};
+    std::atomic<uint64_t> steals_succeeded{0};
+    std::atomic<uint64_t> steals_remote{0};
+    std::atomic<uint64_t> parks{0};
+    std::atomic<int64_t> idle_ns{0};
+    std::atomic<int64_t> busy_ns{0};
+    std::atomic<int64_t> state_since{0};        // 进入当前状态的时间
+    std::atomic<bool> idle{false};              // 当前是否空闲
+};
+
+/**
+ * @brief 按照 Prometheus 文本格式转义标签的值：反斜杠、双引号和换行
+*/
+inline std::string escapeLabel(const std::string & value)
+{
+    std::string result;
+    result.reserve(value.size());
+    for (char c : value) {
+        switch (c) {
+        case '\\':
+            result += "\\\\";
+            break;
+        case '"':
+            result += "\\\"";
+            break;
+        case '\n':
+            result += "\\n";
+            break;
+        default:
+            result += c;
+        }
+    }
+    return result;
+}
+
+// =====================================================
+//  渲染 Prometheus 的文本格式
+//  每个元素是 (线程池的名字, 快照)，同名指标的 HELP/TYPE 只输出一次
+// =====================================================
+inline std::string toPrometheus(const std::vector<std::pair<std::string, PondStats>> & ponds)
+{
+    std::ostringstream out;
+    char value[64];
+
+    auto header = [&] (const char * name, const char * type, const char * help) {
+        out << "# HELP " << name << " " << help << "\n";
+        out << "# TYPE " << name << " " << type << "\n";
+    };
+    auto pondLabels = [&] (size_t i) -> std::string {
+        return "pond=\"" + escapeLabel(ponds[i].first) + "\",type=\"" + escapeLabel(ponds[i].second.pond_type) + "\"";
+    };
+    auto pondMetric = [&] (const char * name, const char * type, const char * help, double (*get)(const PondStats &)) {
+        header(name, type, help);
+        for (size_t i = 0; i < ponds.size(); i++) {
+            std::snprintf(value, sizeof(value), "%.17g", get(ponds[i].second));
+            out << name << "{" << pondLabels(i) << "} " << value << "\n";
+        }
+    };
+    auto workerMetric = [&] (const char * name, const char * type, const char * help, double (*get)(const WorkerStats &)) {
+        header(name, type, help);
+        for (size_t i = 0; i < ponds.size(); i++) {
+            const std::vector<WorkerStats> & workers = ponds[i].second.workers;
+            for (size_t j = 0; j < workers.size(); j++) {
+                std::snprintf(value, sizeof(value), "%.17g", get(workers[j]));
+                out << name << "{" << pondLabels(i) << ",worker=\"" << workers[j].index << "\"} " << value << "\n";
+            }
+        }
+    };
+
+    pondMetric("hipe_pond_threads", "gauge", "Number of worker threads in the pond.",
+               [] (const PondStats & s) -> double { return s.thread_numb; });
+    pondMetric("hipe_pond_tasks_remain", "gauge", "Tasks queued or running in the pond.",
+               [] (const PondStats & s) -> double { return s.tasks_remain; });
+    pondMetric("hipe_pond_overflow_tasks_total", "counter", "Tasks rejected by the pond capacity.",
+               [] (const PondStats & s) -> double { return static_cast<double>(s.overflow_tasks); });
+    pondMetric("hipe_pond_memory_bytes", "gauge", "Memory held by the pond's threads and task queues.",
+               [] (const PondStats & s) -> double { return static_cast<double>(s.memory_bytes); });
+    workerMetric("hipe_worker_queue_depth", "gauge", "Tasks queued or running on the worker.",
+                 [] (const WorkerStats & w) -> double { return w.queue_depth; });
+    workerMetric("hipe_worker_tasks_executed_total", "counter", "Tasks executed by the worker.",
+                 [] (const WorkerStats & w) -> double { return static_cast<double>(w.tasks_executed); });
+    workerMetric("hipe_worker_steals_attempted_total", "counter", "Steal attempts made by the worker.",
+                 [] (const WorkerStats & w) -> double { return static_cast<double>(w.steals_attempted); });
+    workerMetric("hipe_worker_steals_succeeded_total", "counter", "Successful steals made by the worker.",
+                 [] (const WorkerStats & w) -> double { return static_cast<double>(w.steals_succeeded); });
+    workerMetric("hipe_worker_steals_remote_total", "counter", "Successful steals from workers outside the thief's L3 domain.",
+                 [] (const WorkerStats & w) -> double { return static_cast<double>(w.steals_remote); });
+    workerMetric("hipe_worker_parks_total", "counter", "Times the worker went idle.",
+                 [] (const WorkerStats & w) -> double { return static_cast<double>(w.parks); });
+    workerMetric("hipe_worker_idle_seconds_total", "counter", "Time the worker spent idle.",
+                 [] (const WorkerStats & w) -> double { return w.idle_seconds; });
+    workerMetric("hipe_worker_busy_seconds_total", "counter", "Time the worker spent busy.",
+                 [] (const WorkerStats & w) -> double { return w.busy_seconds; });
+    workerMetric("hipe_worker_queue_bytes", "gauge", "Heap memory held by the worker's task queues.",
+                 [] (const WorkerStats & w) -> double { return static_cast<double>(w.queue_bytes); });
+    return out.str();
+}
+
+inline std::string toPrometheus(const PondStats & stats, const std::string & pond_name = "hipe")
+{
+    return toPrometheus(std::vector<std::pair<std::string, PondStats>>(1, std::make_pair(pond_name, stats)));
+}
+
+/**
+ * @brief 把 Prometheus 的文本写入文件，先写入 path.tmp 再改名，读取的一方不会看到写了一半的文件
+ * @return 若写入成功 -- true，反之
+*/
+inline bool dumpPrometheus(const std::string & path, const std::string & text)
+{
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream file(tmp.c_str(), std::ios::out | std::ios::trunc);
+        if (!file) {
+            return false;
+        }
+        file << text;
+        if (!file) {
+            return false;
+        }
+    }
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+inline bool dumpPrometheus(const std::string & path, const PondStats & stats, const std::string & pond_name = "hipe")
+{
+    return dumpPrometheus(path, toPrometheus(stats, pond_name));
+}
+
+}   // !! namespace util
+}   // !! namespace myHipe
+
+#endif  // !! MYHIPE_INCLUDE_STATS_H__
@@ -0,0 +1,180 @@
+#ifndef MYHIPE_INCLUDE_TASK_GROUP_H__
+#define MYHIPE_INCLUDE_TASK_GROUP_H__
+
+//===-- task_group.h - 任务组 -------*- C++ -*-----------===//
+//
+//     线程池的 waitForTasks() 要等待整个线程池中的任务全部结束，TaskGroup 只等待
+// 通过它提交的那一部分任务。
+//
+//     每个任务执行结束时只对 outstanding 做一次 fetch_sub，只有最后一个结束的任务
+// 才会加锁并通知等待的线程。若是在线程池的工作线程中调用 wait()（例如一个任务
+// 提交了子任务并等待它们），等待的线程不会阻塞，而是通过 runPendingTask() 执行
+// 线程池中的任务，直到这个任务组结束，避免线程池中所有线程都在等待而死锁。
+//
+//     Pond 可以是 SteadyThreadPond / BalancedThreadPond / DynamicThreadPond。
+//
+//===----------------------------------------------------------------------===//
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace myHipe
+{
+
+template <typename Pond>
+class TaskGroup
+{
+public:
+    explicit TaskGroup(Pond & pond) : pond(pond) {}
+
+    // 任务中引用了任务组，析构前必须等待所有任务结束
+    ~TaskGroup() {
+        this->wait();
+    }
+
+    TaskGroup(const TaskGroup &) = delete;
+    TaskGroup & operator = (const TaskGroup &) = delete;
+
+public:
+    /**
+     * @brief 通过任务组提交一个任务
+     * 注意：若线程池是有界的，溢出的任务需要在回调中被执行，否则 wait() 不会结束
+    */
+    template <typename Func>
+    void submit(Func && func) {
+        this->onSubmit();
+        try {
+            this->pond.submit(GroupTask<Func>(this, std::forward<Func>(func)));
+        }
+        catch (...) {
+            this->onFinish();
+            throw;
+        }
+    }
+
+    /**
+     * @brief 通过任务组提交一个任务并获得结果
+     * @return 一个 future
+    */
+    template <typename Func>
+    auto submitForReturn(Func && func) -> std::future<typename std::result_of<Func()>::type> {
+        using RT = typename std::result_of<Func()>::type;
+
+        std::packaged_task<RT()> pack(std::forward<Func>(func));
+        std::future<RT> future(pack.get_future());
+        this->submit(std::move(pack));
+        return future;
+    }
+
+    /**
+     * @brief 等待通过任务组提交的任务全部结束
+     * 在线程池的工作线程中调用时，会帮助线程池执行任务而不是阻塞
+    */
+    void wait() {
+        if (this->pond.isWorkerThread()) {
+            while (!this->isDone()) {
+                if (!this->pond.runPendingTask()) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+        else {
+            std::unique_lock<std::mutex> lock(this->locker);
+            this->done_cond_var.wait(lock, [this] () -> bool {
+                return this->isDone();
+            });
+        }
+        // 等待最后一个任务的通知结束，之后任务组就可以被安全地析构了
+        std::lock_guard<std::mutex> lock(this->locker);
+    }
+
+    /**
+     * @brief 最多等待 timeout 的时间
+     * @return 若任务组中的任务全部结束 -- true，超时 -- false
+    */
+    template <typename Rep, typename Period>
+    bool waitFor(const std::chrono::duration<Rep, Period> & timeout) {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        bool done = false;
+        if (this->pond.isWorkerThread()) {
+            while (!(done = this->isDone()) && std::chrono::steady_clock::now() < deadline) {
+                if (!this->pond.runPendingTask()) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+        else {
+            std::unique_lock<std::mutex> lock(this->locker);
+            done = this->done_cond_var.wait_until(lock, deadline, [this] () -> bool {
+                return this->isDone();
+            });
+        }
+        if (done) {
+            std::lock_guard<std::mutex> lock(this->locker);
+        }
+        return done;
+    }
+
+    /**
+     * @return 任务组中还没有结束的任务数量
+    */
+    int getTasksRemain() const {
+        return this->outstanding.load(std::memory_order_acquire);
+    }
+
+private:
+    // 包装用户的任务，结束时（包括抛出异常）通知任务组
+    template <typename Func, typename T = typename std::decay<Func>::type>
+    struct GroupTask {
+        TaskGroup * group;
+        T func;
+
+        GroupTask(TaskGroup * group, Func && func) : group(group), func(std::forward<Func>(func)) {}
+
+        void operator()() {
+            struct Finisher {
+                TaskGroup * group;
+                ~Finisher() { group->onFinish(); }
+            } finisher{this->group};
+            this->func();
+        }
+    };
+
+    void onSubmit() {
+        // 从 0 变为 1 时，清除上一轮的结束标记
+        if (this->outstanding.fetch_add(1, std::memory_order_acq_rel) == 0) {
+            std::lock_guard<std::mutex> lock(this->locker);
+            this->drained.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    void onFinish() {
+        if (this->outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(this->locker);
+            this->drained.store(true, std::memory_order_release);
+            this->done_cond_var.notify_all();
+        }
+    }
+
+    // outstanding 为 0 并且最后一个任务已经发出了通知
+    bool isDone() const {
+        return this->outstanding.load(std::memory_order_acquire) == 0 && this->drained.load(std::memory_order_acquire);
+    }
+
+private:
+    Pond & pond;
+    std::atomic<int> outstanding{0};        // 还没有结束的任务数量
+    std::atomic<bool> drained{true};        // 最后一个任务是否已经发出了通知
+    std::mutex locker;
+    std::condition_variable done_cond_var;
+};
+
+}   // !! myHipe
+
+#endif  // !! MYHIPE_INCLUDE_TASK_GROUP_H__
@@ -18,6 +18,22 @@
 //     Balanced_pond 的竞争主要来自于 主线程 和 异步线程 之间的竞争，因为异步线程
 // 在从自己的任务队列中加载任务时，可能同时主线程要向这个任务队列添加任务，或者反之，
 // 这就造成了竞争
+//
+// 租户：
+//     addTenant(weight, max_running) 注册一个租户，submitAs(tenant, task) 提交属于
+// 这个租户的任务。每个线程为每个租户维护一条子队列（未标记租户的任务仍然在原来的
+// 队列中，权重为 1），线程加载任务时按照加权的差额轮询（deficit round robin）在各个
+// 租户之间选择：每轮到一个租户，它可以连续取出 weight 个任务。max_running 限制一个
+// 租户同时在执行的任务数量，达到上限的租户会被跳过，所以一个租户提交再多的任务，也
+// 不能占满所有的线程。没有注册租户时，线程加载任务的路径和原来相同。
+//
+// 批量加载：
+//     线程每次加锁时最多取出队列中一半的任务（不超过 max_load_batch 个）放入自己的
+// 缓冲区，另一半任务留在公开的队列中供其他线程窃取。缓冲区由一个只在线程自己和
+// 窃取者之间竞争的自旋锁保护：线程自己从队首取任务，窃取者在公开队列为空时从队尾
+// 取任务，所以一个运行很久的任务不会让缓冲区中排在它后面的任务一直等着。代价是
+// 线程自己每取一个任务都要获取一次（通常没有竞争的）自旋锁，而不是完全不加锁。
+// 注册了租户的任务、以及按截止时间排序的队列（util::DeadlineQueue）仍然每次取一个。
 //===----------------------------------------------------------------------===//
 
 #include <iterator>
@@ -27,12 +43,60 @@
 namespace myHipe
 {
 
+// 一个线程池最多的租户数量，0 号是未标记租户的任务
+const int max_pond_tenants = 16;
+
+// 线程每次加锁最多加载的任务数量
+const int max_load_batch = 32;
+
+//=======================================//
+//  一个租户的配置和计数器，由线程池的所有线程共享
+//=======================================//
+struct TenantState
+{
+    std::atomic<int> weight{1};                 // 每轮可以连续取出的任务数量
+    std::atomic<int> max_running{0};            // 同时执行的任务上限，0 表示没有上限
+    std::atomic<int> running{0};                // 正在执行的任务数量
+    std::atomic<uint64_t> submitted{0};         // 提交的任务总数
+    std::atomic<uint64_t> completed{0};         // 执行完的任务总数
+    std::atomic<uint64_t> throttled{0};         // 因为达到上限而被跳过的次数
+
+    /**
+     * @brief 占用一个执行名额
+     * @return 没有达到上限 -- true，反之
+    */
+    bool tryAcquire() {
+        int cap = this->max_running.load(std::memory_order_relaxed);
+        int now = this->running.load(std::memory_order_relaxed);
+        while (cap == 0 || now < cap) {
+            if (this->running.compare_exchange_weak(now, now + 1, std::memory_order_acq_rel)) {
+                return true;
+            }
+        }
+        this->throttled.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // 任务执行结束，释放执行名额
+    void release() {
+        this->completed.fetch_add(1, std::memory_order_relaxed);
+        this->running.fetch_sub(1, std::memory_order_acq_rel);
+    }
+};
+
+struct TenantTable
+{
+    TenantState tenants[max_pond_tenants];
+    std::atomic<int> tenant_numb{1};            // 已经注册的租户数量（算上 0 号）
+};
+
 //=======================================//
 //  OqThread 是 Balanced_pond 的基础线程
 // 成员变量：
 //          util::SafeTask task;                        // 当前正在执行的任务
 //          std::queue<util::SafeTask> task_queue;      // 当前线程的中任务队列
 //          std::mutex task_queue_locker;               // 任务队列专用锁
+//          util::RingBuffer<util::SafeTask> run_buffer; // 批量加载的任务，窃取者可以从队尾取走
 //          bool is_wait{false};                        // 当前线程是否工作，若是 true，表示要自己任务队列中的任务全部执行完
 //          std::thread handle;                         // 处理任务的线程
 //          std::atomic<int> task_numb{0};              // 任务的数量(算上正在执行的任务)
@@ -44,31 +108,68 @@ namespace myHipe
 //          void enqueue(Container & container)
 //          void runTask()
 //          bool tryLoadTask()
+// 模板参数 Config 是策略包 PondPolicy（见 policy.h），也可以只给出保护任务队列的锁，
+// 默认使用 std::mutex
 //=======================================//
-class OqThread : public ThreadBase
+template <typename Config = PondPolicy<std::mutex>>
+class BasicOqThread : public ThreadBase
 {
 public:
+    using Policy = typename util::toPondPolicy<Config>::type;
+    using Locker = typename Policy::lock_type;
+    using Stats = typename Policy::stats_type;
+    using TaskQueue = typename Policy::template queue_type<util::SafeTask>;
+
     /**
      * @brief 尝试将当前线程的一个任务交给另外一个线程
      * @param other 另一个线程
      * @return 若成功 -- true，反之
      */
-    bool tryGiveTaskToOther(OqThread & another) {
+    bool tryGiveTaskToOther(BasicOqThread & another) {
+        int tenant = -1;
         if (this->task_queue_locker.try_lock()) {
-            if (!this->task_queue.empty()) {
-                another.task = std::move(this->task_queue.front());
-                this->task_queue.pop();
-                this->task_queue_locker.unlock();
-                this->task_numb -= 1;
-                another.task_numb += 1;
+            tenant = this->pickTask(another.task);
+            this->task_queue_locker.unlock();
+        }
+        // 公开队列中没有任务时，取走批量加载的缓冲区队尾的任务
+        if (tenant < 0 && this->popBuffered(another.task)) {
+            tenant = 0;
+        }
+        if (tenant < 0) {
+            return false;
+        }
+        another.task_tenant = tenant;
+        // 先增加再减少，避免 waitForTasks 看到总任务数短暂为 0
+        another.task_numb += 1;
+        this->task_numb -= 1;
+        return true;
+    }
+
+    /**
+     * @brief 取出一个还没有开始执行的任务，交给其他线程执行，执行完后需要调用 finishTasks()
+     * @param task 取出的任务，属于租户的任务会被包装起来，执行结束时释放租户的执行名额
+     * @param owner 调用者是否是当前线程自己
+    */
+    bool tryPopTask(util::SafeTask & task, bool owner) {
+        if (owner) {
+            util::SpinLock_guard lock(this->buffer_locker);
+            if (!this->run_buffer.empty()) {
+                task = std::move(this->run_buffer.front());
+                this->run_buffer.pop();
                 return true;
             }
-            else {
-                this->task_queue_locker.unlock();
-                return false;
+        }
+        if (this->task_queue_locker.try_lock()) {
+            int tenant = this->pickTask(task);
+            this->task_queue_locker.unlock();
+            if (tenant > 0) {
+                task.reset(TenantTask{std::move(task), &this->tenant_table->tenants[tenant]});
+            }
+            if (tenant >= 0) {
+                return true;
             }
         }
-        return false;
+        return !owner && this->popBuffered(task);
     }
 
     /**
@@ -78,6 +179,7 @@ public:
     void enqueue(T && tarTask) {
         this->task_queue_locker.lock();
         this->task_queue.emplace(std::forward<T>(tarTask));
+        this->recordShared();
         this->task_numb += 1;
         this->task_queue_locker.unlock();
     }
@@ -94,14 +196,132 @@ public:
             this->task_queue.emplace(std::move(container[i]));
             this->task_numb += 1;
         }
+        this->recordShared();
         this->task_queue_locker.unlock();
     }
 
+    /**
+     * @brief 添加一个属于租户 tenant 的任务到这个租户的子队列中
+    */
+    template <typename T>
+    void enqueueAs(int tenant, T && tarTask) {
+        std::lock_guard<Locker> lock(this->task_queue_locker);
+        this->tenantQueue(tenant).emplace(std::forward<T>(tarTask));
+        this->recordShared();
+        this->tenant_tasks += 1;
+        this->task_numb += 1;
+    }
+
+    /**
+     * @brief 添加多个属于租户 tenant 的任务
+     * @param begin 容器中第一个任务的下标
+     * @param end 容器中最后一个任务的下一个下标
+    */
+    template <typename Container>
+    void enqueueAs(int tenant, Container & container, size_t begin, size_t end) {
+        std::lock_guard<Locker> lock(this->task_queue_locker);
+        TaskQueue & queue = this->tenantQueue(tenant);
+        for (size_t i = begin; i < end; i++) {
+            queue.emplace(std::move(container[i]));
+        }
+        this->recordShared();
+        this->tenant_tasks += static_cast<int>(end - begin);
+        this->task_numb += static_cast<int>(end - begin);
+    }
+
+    /**
+     * @brief 按照任务容量预先分配任务队列的空间
+    */
+    void reserve(size_t capacity) {
+        util::reserveQueue(this->task_queue, capacity);
+        this->recordShared();
+        util::SpinLock_guard lock(this->buffer_locker);
+        this->run_buffer.reserve(static_cast<size_t>(max_load_batch));
+        this->owned_bytes.store(this->run_buffer.memoryBytes(), std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 把批量加载的任务放回任务队列，让其他线程可以取走，在 BlockingScope 中由线程自己调用
+    */
+    void publishBuffer() {
+        std::lock_guard<Locker> lock(this->task_queue_locker);
+        util::SpinLock_guard buffer_lock(this->buffer_locker);
+        if (this->run_buffer.empty()) {
+            return;
+        }
+        while (!this->run_buffer.empty()) {
+            this->task_queue.emplace(std::move(this->run_buffer.front()));
+            this->run_buffer.pop();
+        }
+        this->recordShared();
+    }
+
+    /**
+     * @brief 释放任务队列和租户子队列多余的内存，至少保留 keep 个任务的容量
+    */
+    void shrinkShared(size_t keep) {
+        std::lock_guard<Locker> lock(this->task_queue_locker);
+        util::shrinkQueue(this->task_queue, keep);
+        if (this->tenant_queues) {
+            for (int i = 0; i < max_pond_tenants; i++) {
+                util::shrinkQueue(this->tenant_queues[i], 0);
+            }
+        }
+        this->recordShared();
+    }
+
+    /**
+     * @brief 释放批量加载的缓冲区，有界的线程池保留 max_load_batch 个任务的容量，只由线程自己调用
+    */
+    void shrinkOwned(size_t keep) {
+        util::SpinLock_guard lock(this->buffer_locker);
+        this->run_buffer.shrinkToFit((keep == 0) ? 0 : static_cast<size_t>(max_load_batch));
+        this->owned_bytes.store(this->run_buffer.memoryBytes(), std::memory_order_relaxed);
+    }
+
+    /**
+     * @return 任务队列、租户子队列和批量加载的缓冲区占用的堆内存
+    */
+    size_t memoryBytes() {
+        std::lock_guard<Locker> lock(this->task_queue_locker);
+        size_t bytes = util::queueBytes(this->task_queue) + this->owned_bytes.load(std::memory_order_relaxed);
+        if (this->tenant_queues) {
+            for (int i = 0; i < max_pond_tenants; i++) {
+                bytes += util::queueBytes(this->tenant_queues[i]);
+            }
+        }
+        return bytes;
+    }
+
+    /**
+     * @brief 设置每次加锁最多加载的任务数量，1 表示每次只加载一个任务
+    */
+    void setLoadBatch(int numb) {
+        this->load_batch.store(numb, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 绑定线程池的租户表，在工作线程启动之前调用
+    */
+    void bindTenants(TenantTable * table) {
+        this->tenant_table = table;
+    }
+
     /**
      * @param 运行任务
     */
     void runTask() {
-        util::invoke(this->task);
+        this->traceEvent(util::TraceEvent::RunBegin);
+        if (this->task_tenant > 0) {
+            TenantFinisher finisher{&this->tenant_table->tenants[this->task_tenant]};
+            util::invoke(this->task);
+        }
+        else {
+            util::invoke(this->task);
+        }
+        this->traceEvent(util::TraceEvent::RunEnd);
+        this->markProgress();
+        Stats::addTasks(*this);
         this->task_numb -= 1;
     }
 
@@ -109,50 +329,329 @@ public:
      * @brief 从自己的任务队列中加载任务 
     */
     bool tryLoadTask() {
+        // 缓冲区的锁只和窃取者竞争，不会和提交任务的线程竞争
+        {
+            util::SpinLock_guard lock(this->buffer_locker);
+            if (!this->run_buffer.empty()) {
+                this->task = std::move(this->run_buffer.front());
+                this->run_buffer.pop();
+                this->task_tenant = 0;
+                return true;
+            }
+        }
+
         this->task_queue_locker.lock();
-        if (!this->task_queue.empty()) {
-            this->task = std::move(this->task_queue.front());
+        int tenant = this->pickTask(this->task);
+        int loaded = (tenant < 0) ? 0 : 1;
+        if (tenant == 0 && this->tenant_tasks == 0 && !util::isDeadlineQueue<TaskQueue>::value) {
+            // 最多取走队列中一半的任务，剩下的留给窃取者
+            int batch = std::min(this->load_batch.load(std::memory_order_relaxed), static_cast<int>(this->task_queue.size() + 1) / 2);
+            if (loaded < batch) {
+                util::SpinLock_guard lock(this->buffer_locker);
+                for (; loaded < batch; loaded++) {
+                    this->run_buffer.emplace(std::move(this->task_queue.front()));
+                    this->task_queue.pop();
+                }
+                this->owned_bytes.store(this->run_buffer.memoryBytes(), std::memory_order_relaxed);
+            }
+            this->recordShared();
+        }
+        this->task_queue_locker.unlock();
+        if (tenant < 0) {
+            return false;
+        }
+        this->task_tenant = tenant;
+        this->traceEvent(util::TraceEvent::Dequeue, 0, loaded);
+        return true;
+    }
+
+private:
+    // 结束时（包括抛出异常）释放租户的执行名额
+    struct TenantFinisher {
+        TenantState * state;
+        ~TenantFinisher() { this->state->release(); }
+    };
+
+    // 被 runPendingTask 取走的租户任务
+    struct TenantTask {
+        util::SafeTask task;
+        TenantState * state;
+
+        void operator()() {
+            TenantFinisher finisher{this->state};
+            util::invoke(this->task);
+        }
+    };
+
+    TaskQueue & tenantQueue(int tenant) {
+        if (!this->tenant_queues) {
+            this->tenant_queues.reset(new TaskQueue[max_pond_tenants]);
+        }
+        return this->tenant_queues[tenant];
+    }
+
+    /**
+     * @brief 取出下一个要执行的任务，调用前需要持有 task_queue_locker
+     * 子队列中没有任务时直接取 task_queue 的队头，否则按照加权的差额轮询选择租户：
+     * 轮到一个租户时它的额度增加 weight，每取出一个任务额度减 1，额度用完或者
+     * 队列空了才轮到下一个租户；达到 max_running 的租户会被跳过
+     * @return 任务所属的租户，0 表示未标记租户的任务，-1 表示没有可以执行的任务
+    */
+    int pickTask(util::SafeTask & out) {
+        if (this->tenant_tasks == 0) {
+            if (this->task_queue.empty()) {
+                return -1;
+            }
+            out = std::move(this->task_queue.front());
             this->task_queue.pop();
-            this->task_queue_locker.unlock();
-            return true;
+            this->recordShared();
+            return 0;
         }
-        else {
-            this->task_queue_locker.unlock();
+
+        int numb = this->tenant_table->tenant_numb.load(std::memory_order_acquire);
+        for (int scanned = 0; scanned < numb; scanned++) {
+            int tenant = (this->drr_cursor < numb) ? this->drr_cursor : 0;
+            TaskQueue & queue = (tenant == 0) ? this->task_queue : this->tenant_queues[tenant];
+
+            if (!queue.empty() && (tenant == 0 || this->tenant_table->tenants[tenant].tryAcquire())) {
+                if (this->deficits[tenant] <= 0) {
+                    this->deficits[tenant] += (tenant == 0) ? 1 : this->tenant_table->tenants[tenant].weight.load(std::memory_order_relaxed);
+                }
+                out = std::move(queue.front());
+                queue.pop();
+                this->deficits[tenant] -= 1;
+                if (tenant != 0) {
+                    this->tenant_tasks -= 1;
+                }
+                if (queue.empty() || this->deficits[tenant] <= 0) {
+                    this->deficits[tenant] = 0;
+                    this->drr_cursor = tenant + 1;
+                }
+                this->recordShared();
+                return tenant;
+            }
+            // 没有任务或者达到上限的租户放弃这一轮剩下的额度
+            this->deficits[tenant] = 0;
+            this->drr_cursor = tenant + 1;
+        }
+        return -1;
+    }
+
+    /**
+     * @brief 窃取者取走批量加载的缓冲区队尾的任务，缓冲区中的任务都不属于租户
+     * @return 若取到了任务 -- true，反之
+    */
+    bool popBuffered(util::SafeTask & out) {
+        if (!this->buffer_locker.try_lock()) {
             return false;
         }
+        bool found = !this->run_buffer.empty();
+        if (found) {
+            out = std::move(this->run_buffer.back());
+            this->run_buffer.popBack();
+        }
+        this->buffer_locker.unlock();
+        return found;
+    }
+
+    // 记录任务队列和租户子队列占用的内存，调用时需要持有 task_queue_locker
+    void recordShared() {
+        size_t bytes = util::queueBytes(this->task_queue);
+        if (this->tenant_queues) {
+            for (int i = 0; i < max_pond_tenants; i++) {
+                bytes += util::queueBytes(this->tenant_queues[i]);
+            }
+        }
+        this->shared_bytes.store(bytes, std::memory_order_relaxed);
     }
 
 private:
     util::SafeTask task;
-    std::queue<util::SafeTask> task_queue;
-    std::mutex task_queue_locker;
-};
+    TaskQueue task_queue;
+    Locker task_queue_locker;
+    util::RingBuffer<util::SafeTask> run_buffer;        // 批量加载的任务，自己从队首取，窃取者从队尾取
+    util::SpinLock buffer_locker;                       // 保护 run_buffer
+    std::atomic<int> load_batch{max_load_batch};        // 每次加锁最多加载的任务数量
 
-// ======================================
+    int task_tenant{0};                             // task 所属的租户
+    TenantTable * tenant_table{nullptr};            // 线程池的租户表
+    std::unique_ptr<TaskQueue[]> tenant_queues;     // 每个租户一条子队列，第一次提交租户任务时创建
+    int tenant_tasks{0};                            // 子队列中的任务数量
+    int deficits[max_pond_tenants] = {};            // 每个租户在这一轮中剩下的额度
+    int drr_cursor{0};                              // 轮询到的租户
+};
 
+using OqThread = BasicOqThread<>;
 
-class BalancedThreadPond : public FixedThreadPond<OqThread>
+// ======================================
+//              均衡线程池
+// 模板参数 Config 见 BasicOqThread
+// ======================================
+template <typename Config = PondPolicy<std::mutex>>
+class BasicBalancedThreadPond : public FixedThreadPond<BasicOqThread<Config>, typename util::toPondPolicy<Config>::type>
 {
+    using Thread = BasicOqThread<Config>;
+    using Policy = typename Thread::Policy;
+    using Stats = typename Thread::Stats;
+
 public:
     /**
      * @param thread_numb 固定线程的数量
      * @param task_capactiry 线程池中任务的容量，默认是 unlimited
     */
-    explicit BalancedThreadPond(int thread_numb, int task_capactiry = HipeUnlimited) : FixedThreadPond(thread_numb, task_capactiry) {
+    explicit BasicBalancedThreadPond(int thread_numb, int task_capactiry = HipeUnlimited)
+        : FixedThreadPond<Thread, Policy>(thread_numb, task_capactiry) {
         // 创建线程
-        this->threads.reset(new OqThread[this->thread_numb]);
+        this->threads.reset(new Thread[this->thread_numb]);
+        this->tenant_table.reset(new TenantTable);
 
         for (int i = 0; i < this->thread_numb; i++) {
-            this->threads[i].bindHandle(std::thread(&BalancedThreadPond::worker, this, i));
+            this->threads[i].reserve(static_cast<size_t>(this->taskNum_of_thread_capacity));
+            this->threads[i].bindTenants(this->tenant_table.get());
+            this->threads[i].bindHandle(std::thread(&BasicBalancedThreadPond::worker, this, i));
         }
     }
 
     // 在基类 FixedThreadPond 对线程池中的线程进行集体释放
-    ~BalancedThreadPond() override = default;
+    ~BasicBalancedThreadPond() override = default;
+
+    std::string pondType() const override {
+        return "balanced";
+    }
+
+    /**
+     * @brief 设置线程每次加锁最多从自己的队列中加载的任务数量
+     * @param numb 取值 [1, max_load_batch]，实际加载的数量不超过队列中任务的一半，1 表示每次只加载一个任务
+    */
+    void setLoadBatch(int numb) {
+        if (numb < 1 || numb > max_load_batch) {
+            throw std::invalid_argument("[myHipeError]: The load batch must be in [1, max_load_batch].");
+        }
+        for (int i = 0; i < this->thread_numb; i++) {
+            this->threads[i].setLoadBatch(numb);
+        }
+    }
+
+    // ====================================================
+    //                     租户
+    // ====================================================
+
+    /**
+     * @brief 注册一个租户
+     * @param weight 权重，每轮可以连续取出的任务数量，未标记租户的任务权重为 1
+     * @param max_running 这个租户同时执行的任务上限，0 表示没有上限
+     * @return 租户的编号，从 1 开始
+    */
+    int addTenant(int weight = 1, int max_running = 0) {
+        std::lock_guard<std::mutex> lock(this->tenant_locker);
+        int tenant = this->tenant_table->tenant_numb.load(std::memory_order_relaxed);
+        if (tenant >= max_pond_tenants) {
+            throw std::runtime_error("[myHipeError]: Too many tenants in the pond.");
+        }
+        this->configTenant(tenant, weight, max_running);
+        this->tenant_table->tenant_numb.store(tenant + 1, std::memory_order_release);
+        return tenant;
+    }
+
+    /**
+     * @brief 修改一个租户的权重和执行上限，正在执行的任务不受影响
+    */
+    void setTenant(int tenant, int weight, int max_running = 0) {
+        this->checkTenant(tenant);
+        this->configTenant(tenant, weight, max_running);
+    }
+
+    /**
+     * @brief 提交一个属于租户 tenant 的任务
+    */
+    template <typename Func>
+    void submitAs(int tenant, Func && func) {
+        this->checkTenant(tenant);
+        if (!this->admit()) {
+            this->taskOverFlow(std::forward<Func>(func));
+            return;
+        }
+        this->tenant_table->tenants[tenant].submitted.fetch_add(1, std::memory_order_relaxed);
+        Thread * t = this->getLeastBusyThread();
+        t->enqueueAs(tenant, std::forward<Func>(func));
+        this->traceSubmit(t, 1);
+    }
+
+    /**
+     * @brief 批量提交属于租户 tenant 的任务，注意：任务容器必须重载 '[]'
+     * @param container 任务容器
+     * @param size 任务容器的 size
+    */
+    template <typename Container>
+    void submitInBatchAs(int tenant, Container & container, size_t size) {
+        this->checkTenant(tenant);
+        TenantState & state = this->tenant_table->tenants[tenant];
+        if (this->taskNum_of_thread_capacity != 0) {
+            this->moveCursorToLeastBusy();
+            for (size_t i = 0; i < size; i++) {
+                if (!this->admit()) {
+                    this->taskOverFlow(container, static_cast<int>(i), static_cast<int>(size));
+                    break;
+                }
+                state.submitted.fetch_add(1, std::memory_order_relaxed);
+                Thread * t = this->getThreadNow();
+                t->enqueueAs(tenant, container, i, i + 1);
+                this->traceSubmit(t, 1);
+            }
+        }
+        else {
+            state.submitted.fetch_add(size, std::memory_order_relaxed);
+            Thread * t = this->getLeastBusyThread();
+            t->enqueueAs(tenant, container, 0, size);
+            this->traceSubmit(t, static_cast<int>(size));
+        }
+    }
+
+    /**
+     * @return 已经注册的租户数量，不算未标记租户的任务
+    */
+    int getTenantNumb() const {
+        return this->tenant_table->tenant_numb.load(std::memory_order_acquire) - 1;
+    }
+
+    /**
+     * @brief 获取一个租户的运行指标的快照
+    */
+    util::TenantStats tenantStats(int tenant) const {
+        this->checkTenant(tenant);
+        const TenantState & state = this->tenant_table->tenants[tenant];
+        util::TenantStats ts;
+        ts.tenant = tenant;
+        ts.weight = state.weight.load(std::memory_order_relaxed);
+        ts.max_running = state.max_running.load(std::memory_order_relaxed);
+        ts.running = state.running.load(std::memory_order_relaxed);
+        ts.completed = state.completed.load(std::memory_order_relaxed);
+        ts.submitted = state.submitted.load(std::memory_order_relaxed);
+        ts.throttled = state.throttled.load(std::memory_order_relaxed);
+        uint64_t done = ts.completed + static_cast<uint64_t>(ts.running);
+        ts.queued = (ts.submitted > done) ? ts.submitted - done : 0;
+        return ts;
+    }
 
 private:
+    void checkTenant(int tenant) const {
+        if (tenant <= 0 || tenant >= this->tenant_table->tenant_numb.load(std::memory_order_acquire)) {
+            throw std::invalid_argument("[myHipeError]: The tenant has not been added to the pond.");
+        }
+    }
+
+    void configTenant(int tenant, int weight, int max_running) {
+        if (weight <= 0 || max_running < 0) {
+            throw std::invalid_argument("[myHipeError]: The weight of a tenant must be positive and its max running tasks can not be negative.");
+        }
+        this->tenant_table->tenants[tenant].weight.store(weight, std::memory_order_relaxed);
+        this->tenant_table->tenants[tenant].max_running.store(max_running, std::memory_order_relaxed);
+    }
+
     void worker(int index) {
-        OqThread & self = this->threads[index];      // 当前线程  
+        Thread & self = this->threads[index];      // 当前线程  
+        typename Policy::idle_type idle;            // 没有任务时的等待方式
+        this->bindCurrentWorker(index);
 
         // while (this->is_stop == false) {
         while (!this->is_stop) {
@@ -167,12 +666,15 @@ private:
 
                 // 程序进行到这里，表示任务队列为空，但是主线程并没有要停止该线程的意图, 所以 从其他线程中 窃取 任务
                 if (this->enable_steal_tasks) {
-                    for (int i = 0, j = 0; j < this->max_steal; j++) {
-                        util::recyclePlus(i, 0, this->thread_numb);
-                        if (this->threads[i].tryGiveTaskToOther(self)) {
-                            self.runTask();
-                            break;
-                        }
+                    int victim = this->trySteal(index, [this, &self] (int i) -> bool {
+                        return this->threads[i].tryGiveTaskToOther(self);
+                    });
+                    if (victim >= 0) {
+                        Stats::markBusy(self);
+                        self.markWorking();
+                        idle.reset();
+                        self.traceEvent(util::TraceEvent::Steal, victim, 1);
+                        self.runTask();
                     }
                     if (!self.notTask() || self.isWaiting()) {
                         // 若有任务，去执行文物
@@ -180,19 +682,34 @@ private:
                         continue;
                     }
                 }
-                std::this_thread::yield();
+                Stats::markIdle(self);
+                this->reclaimIdle(self);
+                idle.wait();
             }
             else {
                 // 尝试加载自己任务队列中的任务
                 if (self.tryLoadTask()) {
                     // 因为有任务窃取机制，所以上一刻有任务，下一刻可能就没有任务了
+                    Stats::markBusy(self);
+                    self.markWorking();
+                    idle.reset();
                     self.runTask();
                 }
+                else {
+                    // 剩下的任务都属于达到执行上限的租户
+                    idle.wait();
+                }
             }
         }
     }
+
+private:
+    std::unique_ptr<TenantTable> tenant_table;      // 所有线程共享的租户表
+    std::mutex tenant_locker;                       // 注册租户时使用
 };
 
+using BalancedThreadPond = BasicBalancedThreadPond<>;
+
 }   // !! myHipe
 
 #endif  // MYHIPE_INCLUDE_THREAD_POND_BALANCED_POND_H__
\ No newline at end of file
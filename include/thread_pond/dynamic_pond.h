@@ -19,13 +19,24 @@
 //     在线程池工作的过程中，可以手动的调整线程池中线程的数量
 //     删除线程，是通过调整 this->shrink_numb 的值，若是 this->shrink_nums 不是
 // 0，表示要减少线程池中的线程数量，DyncmicThreadPond::worker 中有一个 if语句，
-// 判断当前 this->shrink_nums 是不是 0，若是 0，则将该线程添加到 this->dead_threads 
-// 中，再从 pond 中移除, (是使用并没有释放)
+// 判断当前 this->shrink_nums 是不是 0，若不是 0，则当前线程退出工作循环
 //     添加线程，就是创建线程后，使其在 worker 中循环
 //
+// 线程槽位:
+//     每个线程占用 this->slots 中的一个槽位（线程对象、计数器、状态），槽位的编号
+// 就是线程的编号。创建和回收线程只使用 this->thread_locker，不会和提交任务争抢
+// this->shared_locker。退出的线程会把槽位标记为 Retired，之后创建 / 退出的线程
+// 会顺便 join 这些线程并把槽位放回空闲列表，不需要再手动调用 joinDeadThreads()。
+//
+// 空闲退出 (keep-alive):
+//     通过 setKeepAlive(core_numb, keep_alive) 设置后，线程空闲超过 keep_alive
+// 时，若期望的线程数量多于 core_numb，线程会自己退出，直到只剩下 core_numb 个线程。
+// 注意：core_numb 为 0 时所有线程都可能退出，之后提交的任务需要先 addThreads()。
+//
 //===----------------------------------------------------------------------===//
 
 
+#include <deque>
 #include <iostream>
 #include "../header.h"
 
@@ -37,6 +48,22 @@ namespace myHipe
 // ===============
 class DynamicThreadPond
 {
+    enum class SlotState : uint8_t
+    {
+        Free,           // 可以复用
+        Running,        // 线程正在运行
+        Retired         // 线程已经退出工作循环，等待被 join
+    };
+
+    // 一个工作线程的槽位
+    struct WorkerSlot
+    {
+        std::thread handle;
+        util::WorkerCounters counters;
+        SlotState state{SlotState::Free};
+        std::atomic<util::TraceRing *> trace{nullptr};      // 追踪缓冲区，开启追踪后为每个槽位创建一个
+    };
+
 public:
     /**
      * @brief DynamicThreadPond 的构造函数
@@ -56,33 +83,35 @@ public:
     /**
     * @brief 添加 一个 或 多个 线程
     * @param tdNumb 要添加的线程数量
-    * 线程池会通过创建新的线程而扩大
+    * 线程池会通过创建新的线程而扩大，优先复用已经回收的槽位
     */
     void addThreads(int tdNumb = 1) {
         assert(tdNumb >= 0);
 
         this->expect_thread_numb += tdNumb;
-        std::lock_guard<std::mutex> locker(this->shared_locker);
-        while (tdNumb > 0) {
-#if 1
-            std::thread td(&DynamicThreadPond::worker, this);       
-            this->pond.emplace(std::make_pair<std::thread::id, std::thread>(td.get_id(), std::move(td)));   
-#else 
-            if (!this->dead_threads.empty()) {
-                // this->shared_locker.lock();
-                this->pond.emplace(std::make_pair<std::thread::id, std::thread>(this->dead_threads.front().get_id(), std::move(this->dead_threads.front())));   
-                this->dead_threads.pop();
-                // this->shared_locker.unlock();
-            }
-            else {
-                std::thread td(&DynamicThreadPond::worker, this);       
-                this->pond.emplace(std::make_pair<std::thread::id, std::thread>(td.get_id(), std::move(td)));   
+        std::vector<std::thread> retired;
+        {
+            std::lock_guard<std::mutex> locker(this->thread_locker);
+            this->collectRetired(retired);
+            while (tdNumb > 0) {
+                int index = 0;
+                if (!this->free_slots.empty()) {
+                    index = this->free_slots.back();
+                    this->free_slots.pop_back();
+                }
+                else {
+                    this->slots.emplace_back();
+                    index = static_cast<int>(this->slots.size()) - 1;
+                }
+                WorkerSlot & slot = this->slots[index];
+                this->bindTrace(slot, index);
+                slot.state = SlotState::Running;
+                slot.handle = std::thread(&DynamicThreadPond::worker, this, &slot, index);
+                tdNumb -= 1;
             }
-#endif
-                    // 这里只是创建了线程，但是没有给线程任务，任务是线程自己获得，所以是有竞争力的
-                    // 线程池是 map 类型，方便查询，但是为什么不使用 std::unordered_map
-            tdNumb -= 1;
         }
+        joinAll(retired);
+        this->traceEvent(util::TraceEvent::Resize, 0, this->expect_thread_numb.load());
     }
 
     /**
@@ -94,10 +123,8 @@ public:
     void delThreads(int tdNumb = 1) {
         assert((tdNumb <= this->expect_thread_numb) && (tdNumb >= 0));
 
-        this->expect_thread_numb -= tdNumb;
-        this->shrink_numb += tdNumb;
         std::lock_guard<std::mutex> locker(this->shared_locker);
-        awake_cond_var.notify_all();
+        this->shrinkLocked(this->expect_thread_numb - tdNumb);
     }
 
     /**
@@ -108,7 +135,18 @@ public:
         this->is_stop = true;
         this->adjustThreads(0);
         this->waitForThreads();
-        this->joinDeadThreads();
+
+        // 所有线程都已经离开了工作循环，join 全部线程
+        std::vector<std::thread> handles;
+        {
+            std::lock_guard<std::mutex> locker(this->thread_locker);
+            for (size_t i = 0; i < this->slots.size(); i++) {
+                if (this->slots[i].handle.joinable()) {
+                    handles.push_back(std::move(this->slots[i].handle));
+                }
+            }
+        }
+        joinAll(handles);
     }
 
     /**
@@ -122,30 +160,42 @@ public:
             this->addThreads(target_td_numb - this->expect_thread_numb);
         }
         else if (target_td_numb < this->expect_thread_numb) {   // 减少线程池中的线程数量
-            this->delThreads(this->expect_thread_numb - target_td_numb);
+            std::lock_guard<std::mutex> locker(this->shared_locker);
+            this->shrinkLocked(target_td_numb);
         }
     }
 
+    /**
+     * @brief 设置线程的空闲退出
+     * @param core_numb 核心线程数量，线程数量不会因为空闲而少于这个值
+     * @param keep_alive 线程空闲多久之后退出，0 表示关闭空闲退出
+     * 正在等待任务的线程在下一次进入等待时才会使用新的 keep_alive
+    */
+    void setKeepAlive(int core_numb, std::chrono::milliseconds keep_alive) {
+        assert(core_numb >= 0 && keep_alive.count() >= 0);
+
+        this->core_thread_numb = core_numb;
+        this->keep_alive_ms = static_cast<long long>(keep_alive.count());
+    }
+
+    /**
+     * @return 核心线程数量
+    */
+    int getCoreThreadNumb() const {
+        return this->core_thread_numb.load();
+    }
 
     /**
-     * @brief 释放 this->dead_threads 中所有的线程
+     * @brief 回收已经退出的线程
+     * 退出的线程会在之后创建 / 退出线程时被自动回收，这里只是立即回收它们
     */
     void joinDeadThreads() {
-        std::thread td;
-        while (true) {
-            this->shared_locker.lock();
-
-            if (this->dead_threads.empty() == false) {
-                td = std::move(this->dead_threads.front());
-                this->dead_threads.pop();
-                this->shared_locker.unlock();
-            }
-            else {
-                this->shared_locker.unlock();
-                break;
-            }
-            td.join();
+        std::vector<std::thread> retired;
+        {
+            std::lock_guard<std::mutex> locker(this->thread_locker);
+            this->collectRetired(retired);
         }
+        joinAll(retired);
     }
 
     /**
@@ -184,6 +234,55 @@ public:
         return this->expect_thread_numb.load();
     }
 
+    /**
+     * @brief 获取线程池运行指标的快照
+     * 每个线程槽位对应一个工作线程，线程退出后槽位会留给新的线程继续累加，
+     * 所以计数器是单调递增的；只报告正在运行的线程的槽位，和 thread_numb 一致。
+     * 收集时只短暂持有 thread_locker 来遍历槽位
+    */
+    util::PondStats stats() {
+        util::PondStats result;
+        result.pond_type = "dynamic";
+        result.thread_numb = this->running_thread_numb.load();
+        result.tasks_remain = this->total_tasks.load();
+
+        std::lock_guard<std::mutex> locker(this->thread_locker);
+        for (size_t i = 0; i < this->slots.size(); i++) {
+            if (this->slots[i].state == SlotState::Running) {
+                result.workers.push_back(this->slots[i].counters.snapshot(static_cast<int>(i), 0));
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @return 当前线程是否是这个线程池的工作线程
+    */
+    bool isWorkerThread() const {
+        return currentWorker().pond == static_cast<const void *>(this);
+    }
+
+    /**
+     * @brief 在当前线程中执行一个共享任务队列中的任务
+     * 工作线程在任务内部等待其他任务时调用（例如 TaskGroup::wait）
+     * @return 若执行了一个任务 -- true，反之
+    */
+    bool runPendingTask() {
+        util::SafeTask task;
+        {
+            std::lock_guard<std::mutex> locker(this->shared_locker);
+            if (this->shared_task_queue.empty()) {
+                return false;
+            }
+            task = std::move(this->shared_task_queue.front());
+            this->shared_task_queue.pop();
+        }
+        tasks_loaded += 1;
+        util::invoke(task);
+        this->finishTask();
+        return true;
+    }
+
     /**
      * @brief 等待线程数量的调整
     */
@@ -218,6 +317,7 @@ public:
             std::lock_guard<std::mutex> locker(this->shared_locker);
             this->shared_task_queue.emplace(std::forward<Runnable>(func));
             total_tasks += 1;
+            this->traceEvent(util::TraceEvent::Enqueue, 0, 1);
         }
         awake_cond_var.notify_one();
     }
@@ -237,6 +337,7 @@ public:
             std::lock_guard<std::mutex> locker(this->shared_locker);
             this->shared_task_queue.emplace(std::move(pack));
             total_tasks += 1;
+            this->traceEvent(util::TraceEvent::Enqueue, 0, 1);
         }
         awake_cond_var.notify_one();
         return future;
@@ -255,11 +356,198 @@ public:
             for (size_t  i = 0; i < size; i++) {
                 this->shared_task_queue.emplace(std::move(container[i]));
             }
+            this->traceEvent(util::TraceEvent::Enqueue, 0, static_cast<int>(size));
+        }
+        awake_cond_var.notify_all();
+    }
+
+    /**
+     * @brief 批量的提交容器中 [left, right) 范围内的任务
+     * @param container 任务容器，必须重载 '[]'
+     * @param left 范围的左边(include)
+     * @param right 范围的右边(exclude)
+    */
+    template <typename Container>
+    void submitInBatch(Container & container, size_t left, size_t right) {
+        {
+            std::lock_guard<std::mutex> lock(this->shared_locker);
+            this->total_tasks += static_cast<int>(right - left);
+            for (size_t i = left; i < right; i++) {
+                this->shared_task_queue.emplace(std::move(container[i]));
+            }
+            this->traceEvent(util::TraceEvent::Enqueue, 0, static_cast<int>(right - left));
+        }
+        awake_cond_var.notify_all();
+    }
+
+    /**
+     * @brief 对 [0, n) 中的每一个下标 i 调用 func(i)
+     * 只提交 min(线程数量, 区间块数) 个共享同一个区间的 RangeRunner，执行时通过原子游标
+     * 每次领取 grain 个下标，见 FixedThreadPond::submitRange
+     * @param n 下标的数量
+     * @param func 可执行对象，参数是下标 size_t
+     * @param grain 每次领取的下标数量，0 表示自动计算
+    */
+    template <typename Func>
+    void submitRange(size_t n, Func && func, size_t grain = 0) {
+        using F = typename std::decay<Func>::type;
+
+        if (n == 0) {
+            return;
+        }
+        int threads = std::max(this->expect_thread_numb.load(), 1);
+        grain = (grain == 0) ? rangeGrain(n, threads) : grain;
+        std::shared_ptr<RangeJob<F>> job = std::make_shared<RangeJob<F>>(F(std::forward<Func>(func)), n, grain);
+
+        int runners = static_cast<int>(std::min(static_cast<size_t>(threads), (n + grain - 1) / grain));
+        {
+            std::lock_guard<std::mutex> lock(this->shared_locker);
+            this->total_tasks += runners;
+            for (int i = 0; i < runners; i++) {
+                this->shared_task_queue.emplace(RangeRunner<F>{job});
+            }
+            this->traceEvent(util::TraceEvent::Enqueue, 0, runners);
         }
         awake_cond_var.notify_all();
     }
 
+    /**
+     * @brief 开启追踪
+     * @param events_per_thread 每个缓冲区最多保留的事件数量
+     * 每个线程槽位有自己的缓冲区（之后创建的槽位在创建时添加），槽位被复用时
+     * 新的线程继续使用这个缓冲区；提交任务的线程共用一个缓冲区。
+     * 重复开启会继续使用第一次创建的缓冲区
+    */
+    void enableTracing(size_t events_per_thread = 1 << 16) {
+        {
+            std::lock_guard<std::mutex> locker(this->thread_locker);
+            if (!this->tracer) {
+                this->tracer.reset(new util::PondTracer(std::vector<std::string>(1, "submitter"), events_per_thread));
+                this->submit_trace.store(this->tracer->lane(0), std::memory_order_release);
+                for (size_t i = 0; i < this->slots.size(); i++) {
+                    this->bindTrace(this->slots[i], static_cast<int>(i));
+                }
+            }
+        }
+        this->active_tracer.store(this->tracer.get(), std::memory_order_release);
+    }
+
+    /**
+     * @brief 关闭追踪，已经记录的事件仍然可以导出
+    */
+    void disableTracing() {
+        this->active_tracer.store(nullptr, std::memory_order_release);
+    }
+
+    /**
+     * @return Chrome trace JSON，没有开启过追踪时返回空字符串
+    */
+    std::string traceToJson(const std::string & pond_name = "myHipe-Dynamic") const {
+        return this->tracer ? this->tracer->toChromeJson(pond_name) : std::string();
+    }
+
+    /**
+     * @brief 将追踪的事件导出为 Chrome trace JSON 文件，可在 Perfetto 中打开
+     * @return 若写入成功 -- true，反之
+    */
+    bool dumpTrace(const std::string & path, const std::string & pond_name = "myHipe-Dynamic") const {
+        return this->tracer && this->tracer->dump(path, pond_name);
+    }
+
 private:
+    /**
+     * @brief 为槽位创建追踪缓冲区，没有开启过追踪或者已经创建过时什么也不做，调用时需要持有 thread_locker
+    */
+    void bindTrace(WorkerSlot & slot, int index) {
+        if (this->tracer && slot.trace.load(std::memory_order_relaxed) == nullptr) {
+            slot.trace.store(this->tracer->addLane("worker " + std::to_string(index)), std::memory_order_release);
+        }
+    }
+
+    /**
+     * @brief 在提交任务 / 调整线程的线程的缓冲区中记录一个追踪事件，没有开启追踪时什么也不做
+    */
+    void traceEvent(util::TraceEvent type, int arg0 = 0, int arg1 = 0) {
+        if (this->active_tracer.load(std::memory_order_acquire) != nullptr) {
+            this->submit_trace.load(std::memory_order_acquire)->record(type, arg0, arg1);
+        }
+    }
+
+    /**
+     * @brief 在工作线程的槽位的缓冲区中记录一个追踪事件，没有开启追踪时什么也不做
+    */
+    void traceEvent(WorkerSlot * slot, util::TraceEvent type, int arg0 = 0, int arg1 = 0) {
+        if (this->active_tracer.load(std::memory_order_acquire) != nullptr) {
+            util::TraceRing * ring = slot->trace.load(std::memory_order_acquire);
+            if (ring != nullptr) {
+                ring->record(type, arg0, arg1);
+            }
+        }
+    }
+
+    /**
+     * @brief 把期望的线程数量减少到 target，调用时需要持有 shared_locker
+     * 线程的空闲退出也在 shared_locker 下修改期望的线程数量，两者不会互相覆盖
+    */
+    void shrinkLocked(int target) {
+        int numb = this->expect_thread_numb - std::max(target, 0);
+        if (numb <= 0) {
+            return;
+        }
+        this->expect_thread_numb -= numb;
+        this->shrink_numb += numb;
+        this->traceEvent(util::TraceEvent::Resize, 0, this->expect_thread_numb.load());
+        this->awake_cond_var.notify_all();
+    }
+
+    /**
+     * @brief 线程空闲超时后尝试退出，调用时需要持有 shared_locker
+     * @return 若期望的线程数量多于核心线程数量 -- true（期望的线程数量已经减 1），反之
+    */
+    bool tryRetireIdle() {
+        int expect = this->expect_thread_numb.load();
+        while (expect > this->core_thread_numb.load()) {
+            if (this->expect_thread_numb.compare_exchange_weak(expect, expect - 1)) {
+                this->traceEvent(util::TraceEvent::Resize, 0, expect - 1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief 取出已经退出的线程，并把它们的槽位放回空闲列表，调用时需要持有 thread_locker
+    */
+    void collectRetired(std::vector<std::thread> & retired) {
+        for (size_t i = 0; i < this->retired_slots.size(); i++) {
+            WorkerSlot & slot = this->slots[this->retired_slots[i]];
+            if (slot.handle.joinable()) {
+                retired.push_back(std::move(slot.handle));
+            }
+            slot.state = SlotState::Free;
+            this->free_slots.push_back(this->retired_slots[i]);
+        }
+        this->retired_slots.clear();
+    }
+
+    static void joinAll(std::vector<std::thread> & threads) {
+        for (size_t i = 0; i < threads.size(); i++) {
+            threads[i].join();
+        }
+    }
+
+    /**
+     * @brief 一个任务执行结束
+    */
+    void finishTask() {
+        total_tasks -= 1;
+
+        if (this->is_waiting_for_task) {
+            std::lock_guard<std::mutex> lock(this->shared_locker);
+            this->task_done_cond_var.notify_one();
+        }
+    }
+
     void notifyThreadAdjust() {
         std::lock_guard<std::mutex> locker(this->shared_locker);
         this->thread_cond_var.notify_one();
@@ -267,9 +555,17 @@ private:
 
     /**
      * @brief 工作线程默认循环
+     * @param slot 线程占用的槽位
+     * @param lane 槽位的编号，也是线程的编号
     */
-    void worker() {
+    void worker(WorkerSlot * slot, int lane) {
         util::SafeTask task;    // 任务容器
+        util::WorkerCounters * counters = &slot->counters;
+        if (counters->isIdle()) {       // 复用的槽位，上一个线程退出时处于空闲状态
+            counters->toBusy();
+        }
+        currentWorker().pond = static_cast<const void *>(this);
+        currentWorker().index = lane;
         this->running_thread_numb += 1;
 
         if (this->is_waiting_for_thread) {
@@ -278,19 +574,45 @@ private:
         
         do {
             std::unique_lock<std::mutex> locker(this->shared_locker);
-            this->awake_cond_var.wait(locker, [this] () {       // 调整线程池中线程的数量
+            bool parked = this->shared_task_queue.empty() && this->shrink_numb == 0;
+            if (parked) {
+                counters->toIdle();
+                this->traceEvent(slot, util::TraceEvent::Park);
+            }
+            auto awake = [this] () {       // 调整线程池中线程的数量
                 // 若是当前 任务队列 不是空，就抢任务
                 // 若当前没有任务 或 有任务并 this->shrink_numb 不是0，就准备删除当前线程
                 return !this->shared_task_queue.empty() || this->shrink_numb > 0;
-            });
+            };
+            bool retire = false;
+            long long keep_alive = this->keep_alive_ms.load();
+            if (keep_alive > 0) {
+                // 空闲超时并且线程数量多于核心线程数量时，当前线程退出
+                while (!this->awake_cond_var.wait_for(locker, std::chrono::milliseconds(keep_alive), awake)) {
+                    if (this->tryRetireIdle()) {
+                        retire = true;
+                        break;
+                    }
+                }
+            }
+            else {
+                this->awake_cond_var.wait(locker, awake);
+            }
+            if (parked) {
+                if (!retire) {
+                    counters->toBusy();
+                }
+                this->traceEvent(slot, util::TraceEvent::Unpark);
+            }
 
-            // 接受到删除通知
+            // 空闲退出 或 接受到删除通知
+            if (retire) {
+                break;
+            }
             if (this->shrink_numb) {        
                 // 若当前 shrink_numb 不是0，表示有待删除的线程，删除当前的线程
                 this->shrink_numb -= 1;
-                auto id = std::this_thread::get_id();
-                this->dead_threads.emplace(std::move(this->pond[id]));  
-                this->pond.erase(id);
+                counters->toIdle();
                 break;
             }
 
@@ -298,20 +620,29 @@ private:
             this->shared_task_queue.pop();
             locker.unlock();
 
+            this->traceEvent(slot, util::TraceEvent::Dequeue, 0, 1);
             tasks_loaded += 1;
+            this->traceEvent(slot, util::TraceEvent::RunBegin);
             util::invoke(task);
-            total_tasks -= 1;
-
-            if (this->is_waiting_for_task) {
-                std::lock_guard<std::mutex> lock(this->shared_locker);
-                this->task_done_cond_var.notify_one();
-            }
+            this->traceEvent(slot, util::TraceEvent::RunEnd);
+            counters->addTasks();
+            this->finishTask();
         } while (true);
 
         this->running_thread_numb -= 1;
         if (this->is_waiting_for_thread) {
             this->notifyThreadAdjust();
         }
+
+        // 回收之前退出的线程，并把自己的槽位标记为 Retired，留给之后的线程回收
+        std::vector<std::thread> retired;
+        {
+            std::lock_guard<std::mutex> locker(this->thread_locker);
+            this->collectRetired(retired);
+            slot->state = SlotState::Retired;
+            this->retired_slots.push_back(lane);
+        }
+        joinAll(retired);
     }
 
 private:
@@ -326,10 +657,17 @@ private:
     std::condition_variable awake_cond_var{};        // 任务队列有新任务通知线程池中的线程
     std::condition_variable task_done_cond_var{};   // 负责任务结束
     std::condition_variable thread_cond_var{};      // 线程开始或删除
-    std::map<std::thread::id, std::thread> pond;    // 动态线程池
-    std::queue<std::thread> dead_threads;           // 保留不工作的线程
     std::atomic<int> shrink_numb{0};             // 线程的收缩空间
     std::atomic<int> tasks_loaded{0};            // 加载到线程中的任务数量
+    std::atomic<int> core_thread_numb{0};        // 核心线程数量，空闲退出不会少于这个值
+    std::atomic<long long> keep_alive_ms{0};     // 线程空闲多久之后退出（毫秒），0 表示不退出
+    std::unique_ptr<util::PondTracer> tracer{nullptr};          // 活动追踪器，开启追踪后才会创建
+    std::atomic<util::PondTracer *> active_tracer{nullptr};    // 当前正在使用的追踪器，nullptr 表示不追踪
+    std::atomic<util::TraceRing *> submit_trace{nullptr};      // 提交任务 / 调整线程的线程共用的追踪缓冲区
+    std::mutex thread_locker;                       // 创建 / 回收线程使用的锁，和 shared_locker 不会嵌套
+    std::deque<WorkerSlot> slots;                   // 线程槽位，deque 扩容时不会移动已有的元素
+    std::vector<int> free_slots;                    // 可以复用的槽位
+    std::vector<int> retired_slots;                 // 线程已经退出，但还没有被 join 的槽位
 };
 
 }   // !! myHipe
@@ -0,0 +1,237 @@
+#ifndef MYHIPE_INCLUDE_THREAD_POND_HYBRID_POND_H__
+#define MYHIPE_INCLUDE_THREAD_POND_HYBRID_POND_H__
+
+//===-- thread_pond/hybrid_pond.h - 混合线程池 -------*- C++ -*-----------===//
+//
+//     Hipe-Hybrid 把 steady_pond.h 开头描述的用法做成了一个线程池：一个有界的
+// SteadyThreadPond 作为核心线程池处理基准任务流，一个 DynamicThreadPond 作为
+// 溢出线程池（CacheThreadPond）接收核心线程池放不下的任务。
+//
+// 结构:
+//     提交任务时先通过 SteadyThreadPond::trySubmit 尝试放入核心线程池，若核心线程
+// 池容量不足，任务会被直接转发到溢出线程池，不会先放入 overflow_tasks 再拷贝出来，
+// 也不需要用户自己注册 setRefuseCallBack。
+//     溢出线程池初始没有线程，发生溢出时按照积压的任务数量扩容（每个线程负责
+// spill_tasks_per_thread 个任务，最多 max_overflow_thread_numb 个线程），溢出线程池
+// 的线程空闲超过 keep_alive 后会自己退出（DynamicThreadPond::setKeepAlive），直到 0。
+//     线程池会统计提交的任务总数和溢出的任务数量，用来观察有多少负载溢出了。
+//
+//===----------------------------------------------------------------------===//
+
+#include "./steady_pond.h"
+#include "./dynamic_pond.h"
+
+namespace myHipe
+{
+
+// ===============
+//    混合线程池
+// ===============
+class HybridPond
+{
+public:
+    /**
+     * @param core_thread_numb 核心线程池中线程的数量，0 表示 cpu 核心数
+     * @param core_task_capacity 核心线程池的任务容量，必须是有界的
+     * @param max_overflow_thread_numb 溢出线程池最多的线程数量，0 表示和核心线程池相同
+    */
+    HybridPond(int core_thread_numb, int core_task_capacity, int max_overflow_thread_numb = 0)
+        : core_pond(core_thread_numb, core_task_capacity), overflow_pond(0) {
+        if (core_task_capacity <= 0) {
+            throw std::invalid_argument("[myHipeError]: The task capacity of the core pond must be positive.");
+        }
+        if (max_overflow_thread_numb < 0) {
+            throw std::invalid_argument("[myHipeError]: The max number of overflow threads can not be negative.");
+        }
+
+        this->max_overflow_thread_numb = (max_overflow_thread_numb == 0) ? this->core_pond.getThreadNumb() : max_overflow_thread_numb;
+        this->overflow_pond.setKeepAlive(0, std::chrono::milliseconds(1000));
+    }
+
+    ~HybridPond() = default;
+
+public:
+    /**
+     * @brief 提交一个任务，核心线程池放不下时转发到溢出线程池
+    */
+    template <typename Func>
+    void submit(Func && func) {
+        if (this->core_pond.trySubmit(std::forward<Func>(func))) {
+            this->submitted_tasks += 1;
+            return;
+        }
+        this->overflow_pond.submit(std::forward<Func>(func));
+        this->submitted_tasks += 1;
+        this->onSpill(1);
+    }
+
+    /**
+     * @brief 提交一个任务并获得结果
+     * @return 一个 future
+    */
+    template <typename Func>
+    auto submitForReturn(Func && func) -> std::future<typename std::result_of<Func()>::type> {
+        using RT = typename std::result_of<Func()>::type;
+
+        std::packaged_task<RT()> pack(std::forward<Func>(func));
+        std::future<RT> future(pack.get_future());
+        this->submit(std::move(pack));
+        return future;
+    }
+
+    /**
+     * @brief 批量提交任务，注意：任务容器必须重载 '[]'
+     * @param container 任务容器
+     * @param size 任务容器的 size
+    */
+    template <typename Container>
+    void submitInBatch(Container & container, size_t size) {
+        size_t accepted = this->core_pond.trySubmitInBatch(container, size);
+        this->submitted_tasks += static_cast<long long>(size);
+        if (accepted == size) {
+            return;
+        }
+        this->overflow_pond.submitInBatch(container, accepted, size);
+        this->onSpill(static_cast<int>(size - accepted));
+    }
+
+    /**
+     * @brief 等待核心线程池和溢出线程池中的任务结束
+    */
+    void waitForTasks() {
+        this->core_pond.waitForTasks();
+        this->overflow_pond.waitForTasks();
+    }
+
+    /**
+     * @brief 关闭两个线程池
+     * 注意：还在等待的任务不会得到执行了
+    */
+    void close() {
+        this->core_pond.close();
+        this->overflow_pond.close();
+    }
+
+    /**
+     * @brief 启动核心线程池的任务窃取
+    */
+    void enableStealTasks(int maxNumb = 0) {
+        this->core_pond.enableStealTasks(maxNumb);
+    }
+
+    /**
+     * @brief 关闭核心线程池的任务窃取
+    */
+    void disableStealTasks() {
+        this->core_pond.disableStealTasks();
+    }
+
+    /**
+     * @brief 设置溢出线程池扩容的粒度
+     * @param numb 溢出线程池中每个线程负责的积压任务数量
+    */
+    void setSpillTasksPerThread(int numb) {
+        if (numb <= 0) {
+            throw std::invalid_argument("[myHipeError]: The spill tasks per thread must be positive.");
+        }
+        this->spill_tasks_per_thread = numb;
+    }
+
+    /**
+     * @brief 设置溢出线程池中的线程空闲多久之后退出
+     * 正在等待任务的线程在下一次进入等待时才会使用新的值
+    */
+    void setOverflowKeepAlive(std::chrono::milliseconds keep_alive) {
+        this->overflow_pond.setKeepAlive(0, keep_alive);
+    }
+
+    /**
+     * @return 获取线程池中的任务数量，正在进行中的任务也算在内
+    */
+    int getTasksRemain() {
+        return this->core_pond.getTasksRemain() + this->overflow_pond.getTasksRemain();
+    }
+
+    /**
+     * @return 提交到线程池中的任务总数
+    */
+    long long getSubmittedTasks() const {
+        return this->submitted_tasks;
+    }
+
+    /**
+     * @return 溢出到溢出线程池中的任务总数
+    */
+    long long getSpilledTasks() const {
+        return this->spilled_tasks;
+    }
+
+    /**
+     * @return 溢出任务占所有提交任务的比例
+    */
+    double getSpillRatio() const {
+        return (this->submitted_tasks == 0) ? 0.0 : static_cast<double>(this->spilled_tasks) / static_cast<double>(this->submitted_tasks);
+    }
+
+    /**
+     * @return 溢出线程池当前期望的线程数量
+    */
+    int getOverflowThreadNumb() const {
+        return this->overflow_pond.getExpectThreadNumb();
+    }
+
+    /**
+     * @brief 获取运行指标的快照，溢出线程池的线程编号排在核心线程池之后，
+     * overflow_tasks 是溢出到溢出线程池中的任务总数
+    */
+    util::PondStats stats() {
+        util::PondStats result = this->core_pond.stats();
+        util::PondStats overflow = this->overflow_pond.stats();
+
+        result.pond_type = "hybrid";
+        result.thread_numb += overflow.thread_numb;
+        result.tasks_remain += overflow.tasks_remain;
+        result.overflow_tasks = static_cast<uint64_t>(this->spilled_tasks.load());
+        int offset = this->core_pond.getThreadNumb();
+        for (size_t i = 0; i < overflow.workers.size(); i++) {
+            overflow.workers[i].index += offset;
+            result.workers.push_back(overflow.workers[i]);
+        }
+        return result;
+    }
+
+    SteadyThreadPond & getCorePond() {
+        return this->core_pond;
+    }
+
+    DynamicThreadPond & getOverflowPond() {
+        return this->overflow_pond;
+    }
+
+private:
+    /**
+     * @brief 发生溢出后，按照溢出线程池中积压的任务数量扩容
+    */
+    void onSpill(int numb) {
+        this->spilled_tasks += numb;
+
+        int remain = this->overflow_pond.getTasksRemain();
+        int target = (remain + this->spill_tasks_per_thread - 1) / this->spill_tasks_per_thread;
+        target = std::max(1, std::min(target, this->max_overflow_thread_numb));
+        if (target > this->overflow_pond.getExpectThreadNumb()) {
+            this->overflow_pond.adjustThreads(target);
+        }
+    }
+
+private:
+    SteadyThreadPond core_pond;                     // 核心线程池
+    DynamicThreadPond overflow_pond;                // 溢出线程池
+    int max_overflow_thread_numb{0};                // 溢出线程池最多的线程数量
+    int spill_tasks_per_thread{64};                 // 溢出线程池中每个线程负责的积压任务数量
+    std::atomic<long long> submitted_tasks{0};      // 提交的任务总数
+    std::atomic<long long> spilled_tasks{0};        // 溢出的任务总数
+};
+
+}   // !! myHipe
+
+#endif  // !! MYHIPE_INCLUDE_THREAD_POND_HYBRID_POND_H__
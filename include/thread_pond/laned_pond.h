@@ -0,0 +1,279 @@
+#ifndef MYHIPE_INCLUDE_THREAD_POND_LANED_POND_H__
+#define MYHIPE_INCLUDE_THREAD_POND_LANED_POND_H__
+
+//===-- thread_pond/laned_pond.h - 分车道的线程池 -------*- C++ -*-----------===//
+//
+//     计算任务放在 SteadyThreadPond 中、阻塞调用放在 DynamicThreadPond 中时，需要
+// 自己维护两个线程池并在提交时选择。LanedPond 把它们做成一个线程池的两条车道：
+//
+//     Cpu 车道      -- SteadyThreadPond，线程数量是 cpu 核心数（可以指定），处理计算任务
+//     Blocking 车道 -- DynamicThreadPond，初始没有线程，按照积压的任务数量扩容（每个任务
+//                      一个线程，最多 max_blocking_thread_numb 个），线程空闲超过
+//                      keep_alive 之后退出
+//
+// 车道之间移动任务:
+//     Cpu 车道的任务中调用 runBlocking(func)，func 被放到 Blocking 车道执行，等待的同时
+// 当前线程继续执行 Cpu 车道的任务；Blocking 车道的任务可以通过 submitCpu 把后续的计算
+// 交回 Cpu 车道。Cpu 车道中没有移走的阻塞仍然可以使用 BlockingScope（见 header.h）。
+//
+//     两条车道的运行指标合并在 stats() 中，Blocking 车道的线程编号排在 Cpu 车道之后。
+//
+//===----------------------------------------------------------------------===//
+
+#include "./steady_pond.h"
+#include "./dynamic_pond.h"
+
+namespace myHipe
+{
+
+enum class Lane
+{
+    Cpu,
+    Blocking
+};
+
+// ===============
+//  分车道的线程池
+// ===============
+class LanedPond
+{
+public:
+    /**
+     * @param cpu_thread_numb Cpu 车道的线程数量，0 表示 cpu 核心数
+     * @param max_blocking_thread_numb Blocking 车道最多的线程数量，0 表示 Cpu 车道线程数量的 4 倍
+    */
+    explicit LanedPond(int cpu_thread_numb = 0, int max_blocking_thread_numb = 0)
+        : cpu_pond(cpu_thread_numb), blocking_pond(0) {
+        if (max_blocking_thread_numb < 0) {
+            throw std::invalid_argument("[myHipeError]: The max number of blocking threads can not be negative.");
+        }
+
+        this->max_blocking_thread_numb = (max_blocking_thread_numb == 0) ? 4 * this->cpu_pond.getThreadNumb() : max_blocking_thread_numb;
+        this->blocking_pond.setKeepAlive(0, std::chrono::milliseconds(1000));
+    }
+
+    ~LanedPond() = default;
+
+public:
+    /**
+     * @brief 提交一个计算任务
+    */
+    template <typename Func>
+    void submitCpu(Func && func) {
+        this->cpu_pond.submit(std::forward<Func>(func));
+        this->cpu_submitted += 1;
+    }
+
+    /**
+     * @brief 提交一个会阻塞的任务，Blocking 车道的线程不够时扩容
+    */
+    template <typename Func>
+    void submitBlocking(Func && func) {
+        this->blocking_pond.submit(std::forward<Func>(func));
+        this->blocking_submitted += 1;
+        this->growBlocking();
+    }
+
+    /**
+     * @brief 提交任务到指定的车道
+    */
+    template <typename Func>
+    void submit(Lane lane, Func && func) {
+        if (lane == Lane::Cpu) {
+            this->submitCpu(std::forward<Func>(func));
+        }
+        else {
+            this->submitBlocking(std::forward<Func>(func));
+        }
+    }
+
+    /**
+     * @brief 提交一个任务到指定的车道并获得结果
+     * @return 一个 future
+    */
+    template <typename Func>
+    auto submitForReturn(Lane lane, Func && func) -> std::future<typename std::result_of<Func()>::type> {
+        using RT = typename std::result_of<Func()>::type;
+
+        std::packaged_task<RT()> pack(std::forward<Func>(func));
+        std::future<RT> future(pack.get_future());
+        this->submit(lane, std::move(pack));
+        return future;
+    }
+
+    /**
+     * @brief 批量提交任务到指定的车道，注意：任务容器必须重载 '[]'
+     * @param container 任务容器
+     * @param size 任务容器的 size
+    */
+    template <typename Container>
+    void submitInBatch(Lane lane, Container & container, size_t size) {
+        if (lane == Lane::Cpu) {
+            this->cpu_pond.submitInBatch(container, size);
+            this->cpu_submitted += static_cast<long long>(size);
+        }
+        else {
+            this->blocking_pond.submitInBatch(container, size);
+            this->blocking_submitted += static_cast<long long>(size);
+            this->growBlocking();
+        }
+    }
+
+    /**
+     * @brief 在 Blocking 车道中执行 func 并等待结果
+     * 在 Cpu 车道的工作线程中调用时，等待的同时执行 Cpu 车道的任务，不会占着计算线程空等；
+     * 在其他线程中调用时阻塞等待
+     * @return func 的返回值，func 抛出的异常会在这里重新抛出
+    */
+    template <typename Func>
+    auto runBlocking(Func && func) -> typename std::result_of<Func()>::type {
+        auto future = this->submitForReturn(Lane::Blocking, std::forward<Func>(func));
+        if (this->cpu_pond.isWorkerThread()) {
+            this->moved_tasks += 1;
+            while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                // Cpu 车道没有任务时短暂地阻塞等待，不要空转
+                if (!this->cpu_pond.runPendingTask()) {
+                    future.wait_for(std::chrono::microseconds(200));
+                }
+            }
+        }
+        return future.get();
+    }
+
+    /**
+     * @brief 等待两条车道中的任务全部结束
+     * 两条车道的任务可以互相提交任务，所以一直等到两条车道同时为空
+    */
+    void waitForTasks() {
+        do {
+            this->cpu_pond.waitForTasks();
+            this->blocking_pond.waitForTasks();
+        } while (this->cpu_pond.getTasksRemain() != 0 || this->blocking_pond.getTasksRemain() != 0);
+    }
+
+    /**
+     * @brief 关闭两条车道
+     * 注意：还在等待的任务不会得到执行了
+    */
+    void close() {
+        this->cpu_pond.close();
+        this->blocking_pond.close();
+    }
+
+    /**
+     * @brief 设置 Blocking 车道最多的线程数量
+    */
+    void setMaxBlockingThreadNumb(int numb) {
+        if (numb <= 0) {
+            throw std::invalid_argument("[myHipeError]: The max number of blocking threads must be positive.");
+        }
+        this->max_blocking_thread_numb = numb;
+    }
+
+    /**
+     * @brief 设置 Blocking 车道的线程空闲多久之后退出
+    */
+    void setBlockingKeepAlive(std::chrono::milliseconds keep_alive) {
+        this->blocking_pond.setKeepAlive(0, keep_alive);
+    }
+
+    /**
+     * @return 获取车道中的任务数量，正在进行中的任务也算在内
+    */
+    int getTasksRemain(Lane lane) {
+        return (lane == Lane::Cpu) ? this->cpu_pond.getTasksRemain() : this->blocking_pond.getTasksRemain();
+    }
+
+    int getTasksRemain() {
+        return this->cpu_pond.getTasksRemain() + this->blocking_pond.getTasksRemain();
+    }
+
+    /**
+     * @return 提交到车道中的任务总数
+    */
+    long long getSubmittedTasks(Lane lane) const {
+        return (lane == Lane::Cpu) ? this->cpu_submitted.load() : this->blocking_submitted.load();
+    }
+
+    /**
+     * @return 通过 runBlocking 从 Cpu 车道移到 Blocking 车道的任务数量
+    */
+    long long getMovedTasks() const {
+        return this->moved_tasks;
+    }
+
+    /**
+     * @return Blocking 车道当前期望的线程数量
+    */
+    int getBlockingThreadNumb() const {
+        return this->blocking_pond.getExpectThreadNumb();
+    }
+
+    /**
+     * @return Cpu 车道的线程数量
+    */
+    int getCpuThreadNumb() {
+        return this->cpu_pond.getThreadNumb();
+    }
+
+    /**
+     * @brief 获取一条车道的运行指标的快照
+    */
+    util::PondStats laneStats(Lane lane) {
+        return (lane == Lane::Cpu) ? this->cpu_pond.stats() : this->blocking_pond.stats();
+    }
+
+    /**
+     * @brief 获取运行指标的快照，Blocking 车道的线程编号排在 Cpu 车道之后
+    */
+    util::PondStats stats() {
+        util::PondStats result = this->cpu_pond.stats();
+        util::PondStats blocking = this->blocking_pond.stats();
+
+        result.pond_type = "laned";
+        result.thread_numb += blocking.thread_numb;
+        result.tasks_remain += blocking.tasks_remain;
+        result.overflow_tasks += blocking.overflow_tasks;
+        int offset = this->cpu_pond.getThreadNumb();
+        for (size_t i = 0; i < blocking.workers.size(); i++) {
+            blocking.workers[i].index += offset;
+            result.workers.push_back(blocking.workers[i]);
+        }
+        return result;
+    }
+
+    SteadyThreadPond & getCpuPond() {
+        return this->cpu_pond;
+    }
+
+    DynamicThreadPond & getBlockingPond() {
+        return this->blocking_pond;
+    }
+
+private:
+    /**
+     * @brief 每个积压的阻塞任务一个线程，不超过 max_blocking_thread_numb
+    */
+    void growBlocking() {
+        int target = std::min(this->blocking_pond.getTasksRemain(), this->max_blocking_thread_numb.load());
+        if (target > this->blocking_pond.getExpectThreadNumb()) {
+            std::lock_guard<std::mutex> lock(this->grow_locker);
+            if (target > this->blocking_pond.getExpectThreadNumb()) {
+                this->blocking_pond.adjustThreads(target);
+            }
+        }
+    }
+
+private:
+    SteadyThreadPond cpu_pond;                          // Cpu 车道
+    DynamicThreadPond blocking_pond;                    // Blocking 车道
+    std::atomic<int> max_blocking_thread_numb{0};       // Blocking 车道最多的线程数量
+    std::mutex grow_locker;                             // Blocking 车道扩容时使用，可以从多个线程提交任务
+    std::atomic<long long> cpu_submitted{0};            // 提交到 Cpu 车道的任务总数
+    std::atomic<long long> blocking_submitted{0};       // 提交到 Blocking 车道的任务总数
+    std::atomic<long long> moved_tasks{0};              // runBlocking 移走的任务数量
+};
+
+}   // !! myHipe
+
+#endif  // !! MYHIPE_INCLUDE_THREAD_POND_LANED_POND_H__
@@ -0,0 +1,607 @@
+#ifndef MYHIPE_INCLUDE_THREAD_POND_SHARED_POND_H__
+#define MYHIPE_INCLUDE_THREAD_POND_SHARED_POND_H__
+
+//===-- thread_pond/shared_pond.h - 共享工作线程的线程池 -------*- C++ -*-----------===//
+//
+//     每个 SteadyThreadPond(0) 都会创建 cpu 核心数个线程，一个进程中有几个库各自
+// 创建线程池时，线程的总数是核心数的好几倍，线程之间互相抢占 cpu。
+//
+//     WorkerRegistry 是一组固定数量的工作线程（默认是 cpu 核心数），SharedPond 是
+// 挂在它上面的线程池：每个 SharedPond 只有自己的任务队列和权重，没有自己的线程，
+// 同一个 WorkerRegistry 上的所有 SharedPond 共用这组线程，所以不管创建多少个
+// SharedPond，同时运行的工作线程都不会超过 WorkerRegistry 的线程数量。
+// WorkerRegistry::global() 是进程中共享的默认实例。
+//
+// 调度:
+//     工作线程按照加权的差额轮询选择线程池（和 BalancedThreadPond 的租户相同）：
+// 轮到一个线程池时它的额度增加 weight * shared_quantum，每取出一个任务额度减 1，
+// 额度用完或者队列空了才轮到下一个线程池。一次最多取出 max_load_batch 个任务，
+// 并且不超过队列中任务的 1 / 线程数量，剩下的留给其他线程。
+//     选择线程池时持有 WorkerRegistry 的锁，线程池析构时也要先拿到这个锁才能脱离，
+// 所以工作线程看到的线程池一定还活着；提交任务只对自己的任务队列加锁。
+//
+// 空闲:
+//     所有队列都为空时工作线程先让出几次 cpu，然后阻塞在条件变量上，提交任务时
+// 只有存在阻塞的线程才会去通知。
+//
+// 在任务中等待:
+//     每个任务结束后单独减少任务数量。任务中调用自己线程池的 waitForTasks() 时，
+// 先执行当前线程这一批中剩下的任务，并且不等待当前线程上正在执行的这个线程池的任务
+// （包括调用者自己），否则会永远等不到任务数量变为 0。
+//
+//===----------------------------------------------------------------------===//
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+#include "../header.h"
+
+namespace myHipe
+{
+
+// 权重为 1 的线程池每轮可以连续取出的任务数量
+static const int shared_quantum = 8;
+
+// 工作线程每次加锁最多取出的任务数量
+static const int shared_load_batch = 32;
+
+// 工作线程找不到任务时，阻塞之前让出 cpu 的次数
+static const int shared_idle_spins = 64;
+
+//=======================================//
+//  SharedPond 的任务队列，工作线程通过它执行任务
+//=======================================//
+struct SharedQueue
+{
+    util::SpinLock locker;                          // 保护 tasks
+    util::RingBuffer<util::SafeTask> tasks;
+    std::atomic<int> weight{1};
+    std::atomic<int> task_numb{0};                  // 队列中的任务和正在执行的任务
+    std::mutex done_locker;
+    std::condition_variable task_done;
+    int deficit{0};                                 // 这一轮剩下的额度，由 WorkerRegistry 的锁保护
+
+    /**
+     * @brief numb 个任务执行结束
+     * 在 done_locker 中减少任务数量，waitForTasks 返回（线程池可能被析构）之前，
+     * 这里已经不会再访问这个队列
+    */
+    void finish(int numb) {
+        std::lock_guard<std::mutex> lock(this->done_locker);
+        this->task_numb -= numb;
+        if (this->task_numb == 0) {
+            this->task_done.notify_all();
+        }
+    }
+};
+
+// ======================================
+//    一组固定数量的、共享的工作线程
+// ======================================
+class WorkerRegistry
+{
+    struct Worker
+    {
+        std::thread handle;
+        util::WorkerCounters counters;
+    };
+
+public:
+    /**
+     * @param thread_numb 工作线程的数量，0 表示 cpu 核心数
+    */
+    explicit WorkerRegistry(int thread_numb = 0) {
+        assert(thread_numb >= 0);
+        if (thread_numb == 0) {
+            int temp = static_cast<int>(std::thread::hardware_concurrency());
+            thread_numb = (temp > 0) ? temp : 1;
+        }
+        this->thread_numb = thread_numb;
+        this->workers.reset(new Worker[thread_numb]);
+        for (int i = 0; i < thread_numb; i++) {
+            this->workers[i].handle = std::thread(&WorkerRegistry::worker, this, i);
+        }
+    }
+
+    // 挂在上面的 SharedPond 需要先被析构
+    ~WorkerRegistry() {
+        {
+            std::lock_guard<std::mutex> lock(this->locker);
+            assert(this->queues.empty());
+            this->is_stop.store(true);
+        }
+        this->park_cond.notify_all();
+        for (int i = 0; i < this->thread_numb; i++) {
+            this->workers[i].handle.join();
+        }
+    }
+
+    WorkerRegistry(const WorkerRegistry &) = delete;
+    WorkerRegistry & operator = (const WorkerRegistry &) = delete;
+
+public:
+    /**
+     * @brief 进程中共享的默认实例，第一次调用时创建
+     * 线程数量是 setGlobalThreadNumb 设置的值，没有设置时是 cpu 核心数
+    */
+    static WorkerRegistry & global() {
+        globalCreated().store(true);
+        static WorkerRegistry registry(globalThreadNumb().load());
+        return registry;
+    }
+
+    /**
+     * @brief 设置默认实例的线程数量，需要在第一次调用 global() 之前设置
+     * @return 若默认实例还没有创建 -- true，反之（设置不会生效）
+    */
+    static bool setGlobalThreadNumb(int thread_numb) {
+        assert(thread_numb >= 0);
+        if (globalCreated().load()) {
+            return false;
+        }
+        globalThreadNumb().store(thread_numb);
+        return true;
+    }
+
+    /**
+     * @return 工作线程的数量
+    */
+    int getThreadNumb() const {
+        return this->thread_numb;
+    }
+
+    /**
+     * @return 挂在上面的线程池的数量
+    */
+    int getPondNumb() {
+        std::lock_guard<std::mutex> lock(this->locker);
+        return static_cast<int>(this->queues.size());
+    }
+
+    /**
+     * @return 当前线程是否是这组工作线程之一
+    */
+    bool isWorkerThread() const {
+        return currentWorker().pond == static_cast<const void *>(this);
+    }
+
+    /**
+     * @brief 获取所有工作线程的运行指标的快照，任务数量是所有线程池的任务总数
+    */
+    util::PondStats stats() {
+        util::PondStats result;
+        result.pond_type = "shared";
+        result.thread_numb = this->thread_numb;
+        result.tasks_remain = static_cast<int>(this->pending.load(std::memory_order_relaxed));
+        for (int i = 0; i < this->thread_numb; i++) {
+            result.workers.push_back(this->workers[i].counters.snapshot(i, 0));
+        }
+        return result;
+    }
+
+    // ====================================================
+    //       SharedPond 使用的接口
+    // ====================================================
+
+    /**
+     * @brief 在当前线程中执行 queue 的一个任务，结束后减少它的任务数量
+    */
+    static void runTask(SharedQueue * queue, util::SafeTask & task) {
+        {
+            RunningTask frame(queue);
+            util::invoke(task);
+        }
+        queue->finish(1);           // 之后不能再访问 queue
+    }
+
+    /**
+     * @brief 在当前线程中执行这一批中剩下的一个任务，只有这一批任务属于 queue 时才会执行
+     * @return 若执行了一个任务 -- true，反之
+    */
+    static bool runBatched(SharedQueue * queue) {
+        LocalBatch & local = localBatch();
+        if (local.queue != queue || local.tasks == nullptr || local.tasks->empty()) {
+            return false;
+        }
+        util::SafeTask task(std::move(local.tasks->front()));
+        local.tasks->pop();
+        runTask(queue, task);
+        return true;
+    }
+
+    /**
+     * @return 当前线程上正在执行的 queue 的任务数量（任务中等待时会嵌套执行其他任务）
+    */
+    static int runningOn(const SharedQueue * queue) {
+        int numb = 0;
+        for (RunningTask * frame = localBatch().running; frame != nullptr; frame = frame->prev) {
+            numb += (frame->queue == queue);
+        }
+        return numb;
+    }
+
+    void attach(SharedQueue * queue) {
+        std::lock_guard<std::mutex> lock(this->locker);
+        this->queues.push_back(queue);
+    }
+
+    // 脱离之后工作线程不会再访问这个队列
+    void detach(SharedQueue * queue) {
+        std::lock_guard<std::mutex> lock(this->locker);
+        for (size_t i = 0; i < this->queues.size(); i++) {
+            if (this->queues[i] == queue) {
+                this->queues.erase(this->queues.begin() + static_cast<std::ptrdiff_t>(i));
+                break;
+            }
+        }
+        this->cursor = 0;
+    }
+
+    /**
+     * @brief 放入了 numb 个任务，有阻塞的工作线程时通知它们
+    */
+    void notify(int numb) {
+        this->pending.fetch_add(numb);
+        if (this->sleepers.load() > 0) {
+            std::lock_guard<std::mutex> lock(this->locker);
+            if (numb == 1) {
+                this->park_cond.notify_one();
+            }
+            else {
+                this->park_cond.notify_all();
+            }
+        }
+    }
+
+    /**
+     * @brief 从队列中取走了 numb 个还没有执行的任务（不经过工作线程）
+    */
+    void consume(int numb) {
+        this->pending.fetch_sub(numb);
+    }
+
+private:
+    struct RunningTask;
+
+    // 当前线程正在执行的一批任务，以及正在执行的任务组成的栈
+    struct LocalBatch
+    {
+        SharedQueue * queue{nullptr};                       // 这一批任务所属的队列
+        util::RingBuffer<util::SafeTask> * tasks{nullptr};  // 这一批中还没有执行的任务
+        RunningTask * running{nullptr};
+    };
+
+    static LocalBatch & localBatch() {
+        static thread_local LocalBatch local;
+        return local;
+    }
+
+    // 正在执行的一个任务，在栈上创建
+    struct RunningTask
+    {
+        explicit RunningTask(SharedQueue * queue) : queue(queue), prev(localBatch().running) {
+            localBatch().running = this;
+        }
+        ~RunningTask() {
+            localBatch().running = this->prev;
+        }
+        SharedQueue * queue;
+        RunningTask * prev;
+    };
+
+    static std::atomic<int> & globalThreadNumb() {
+        static std::atomic<int> numb{0};
+        return numb;
+    }
+
+    static std::atomic<bool> & globalCreated() {
+        static std::atomic<bool> created{false};
+        return created;
+    }
+
+    /**
+     * @brief 按照加权的差额轮询选择一个线程池，把它的一批任务移动到 batch 中
+     * @return 任务所属的队列，没有任务时返回 nullptr
+    */
+    SharedQueue * loadTasks(util::RingBuffer<util::SafeTask> & batch) {
+        std::lock_guard<std::mutex> lock(this->locker);
+        size_t numb = this->queues.size();
+        for (size_t scanned = 0; scanned < numb; scanned++) {
+            if (this->cursor >= numb) {
+                this->cursor = 0;
+            }
+            SharedQueue * queue = this->queues[this->cursor];
+
+            queue->locker.lock();
+            size_t avail = queue->tasks.size();
+            if (avail != 0) {
+                if (queue->deficit <= 0) {
+                    queue->deficit += queue->weight.load(std::memory_order_relaxed) * shared_quantum;
+                }
+                size_t fair = (avail + static_cast<size_t>(this->thread_numb) - 1) / static_cast<size_t>(this->thread_numb);
+                size_t take = std::min(std::min(avail, fair), std::min(static_cast<size_t>(queue->deficit), static_cast<size_t>(shared_load_batch)));
+                for (size_t i = 0; i < take; i++) {
+                    batch.emplace(std::move(queue->tasks.front()));
+                    queue->tasks.pop();
+                }
+                queue->locker.unlock();
+
+                this->pending.fetch_sub(static_cast<int>(take));
+                queue->deficit -= static_cast<int>(take);
+                if (queue->deficit <= 0 || take == avail) {
+                    queue->deficit = 0;
+                    this->cursor += 1;
+                }
+                return queue;
+            }
+            queue->locker.unlock();
+
+            // 没有任务的线程池放弃这一轮剩下的额度
+            queue->deficit = 0;
+            this->cursor += 1;
+        }
+        return nullptr;
+    }
+
+    // 所有队列都为空，阻塞到有新的任务或者停止
+    void park() {
+        std::unique_lock<std::mutex> lock(this->locker);
+        this->sleepers.fetch_add(1);
+        this->park_cond.wait(lock, [this] () -> bool {
+            return this->is_stop || this->pending.load() > 0;
+        });
+        this->sleepers.fetch_sub(1);
+    }
+
+    void worker(int index) {
+        Worker & self = this->workers[index];
+        util::RingBuffer<util::SafeTask> batch;
+        batch.reserve(static_cast<size_t>(shared_load_batch));
+        currentWorker().pond = static_cast<const void *>(this);
+        currentWorker().index = index;
+        LocalBatch & local = localBatch();
+        local.tasks = &batch;
+
+        int spins = 0;
+        while (true) {
+            SharedQueue * queue = this->loadTasks(batch);
+            if (queue == nullptr) {
+                if (this->is_stop) {
+                    break;
+                }
+                if (!self.counters.isIdle()) {
+                    self.counters.toIdle();
+                }
+                if (spins++ < shared_idle_spins) {
+                    std::this_thread::yield();
+                }
+                else {
+                    this->park();
+                    spins = 0;
+                }
+                continue;
+            }
+
+            if (self.counters.isIdle()) {
+                self.counters.toBusy();
+            }
+            spins = 0;
+            int numb = static_cast<int>(batch.size());
+            local.queue = queue;
+            while (!batch.empty()) {
+                util::SafeTask task(std::move(batch.front()));
+                batch.pop();
+                runTask(queue, task);   // 最后一个任务结束之后不能再访问 queue
+            }
+            local.queue = nullptr;
+            self.counters.addTasks(static_cast<uint64_t>(numb));
+        }
+    }
+
+private:
+    int thread_numb{0};
+    std::unique_ptr<Worker[]> workers{nullptr};
+    std::vector<SharedQueue *> queues;              // 挂在上面的线程池的队列
+    size_t cursor{0};                               // 轮询到的队列
+    std::mutex locker;                              // 保护 queues、cursor 和每个队列的 deficit
+    std::condition_variable park_cond;
+    std::atomic<int> pending{0};                    // 所有队列中还没有取出的任务数量
+    std::atomic<int> sleepers{0};                   // 阻塞的工作线程数量
+    std::atomic<bool> is_stop{false};               // 在 locker 中修改
+};
+
+// =====================================================
+//  挂在 WorkerRegistry 上的线程池，只有任务队列和权重，没有自己的线程
+// =====================================================
+class SharedPond
+{
+public:
+    /**
+     * @param weight 权重，几个线程池都有任务时，按照权重的比例分配工作线程
+     * @param registry 提供工作线程的 WorkerRegistry，需要比线程池活得更久
+    */
+    explicit SharedPond(int weight = 1, WorkerRegistry & registry = WorkerRegistry::global())
+        : registry(registry) {
+        this->setWeight(weight);
+        this->registry.attach(&this->queue);
+    }
+
+    // 还在等待的任务不会得到执行了，等待正在执行的任务结束后脱离 WorkerRegistry
+    ~SharedPond() {
+        this->close();
+    }
+
+    SharedPond(const SharedPond &) = delete;
+    SharedPond & operator = (const SharedPond &) = delete;
+
+public:
+    /**
+     * @brief 提交任务, 没有返回值
+    */
+    template <typename Func>
+    void submit(Func && func) {
+        this->queue.task_numb += 1;
+        {
+            util::SpinLock_guard lock(this->queue.locker);
+            this->queue.tasks.emplace(std::forward<Func>(func));
+        }
+        this->registry.notify(1);
+    }
+
+    /**
+     * @brief 提交一个任务并获得结果
+     * @return 一个 future
+    */
+    template <typename Func>
+    auto submitForReturn(Func && func) -> std::future<typename std::result_of<Func()>::type> {
+        using RT = typename std::result_of<Func()>::type;
+
+        std::packaged_task<RT()> pack(std::forward<Func>(func));
+        std::future<RT> future(pack.get_future());
+        this->submit(std::move(pack));
+        return future;
+    }
+
+    /**
+     * @brief 批量提交任务，注意：任务容器必须重载 '[]'
+     * @param container 任务容器
+     * @param size 任务容器的 size
+    */
+    template <typename Container>
+    void submitInBatch(Container & container, size_t size) {
+        if (size == 0) {
+            return;
+        }
+        this->queue.task_numb += static_cast<int>(size);
+        {
+            util::SpinLock_guard lock(this->queue.locker);
+            for (size_t i = 0; i < size; i++) {
+                this->queue.tasks.emplace(std::move(container[i]));
+            }
+        }
+        this->registry.notify(static_cast<int>(size));
+    }
+
+    /**
+     * @brief 等待这个线程池的任务全部结束
+     * 在工作线程中调用时，等待的同时执行这个线程池中的任务，不会占着工作线程空等；
+     * 在这个线程池的任务中调用时，不等待当前线程上正在执行的任务（包括调用者自己）
+    */
+    void waitForTasks() {
+        int own = WorkerRegistry::runningOn(&this->queue);
+        if (own != 0 || this->registry.isWorkerThread()) {
+            while (this->queue.task_numb.load() > own) {
+                if (!WorkerRegistry::runBatched(&this->queue) && !this->runPendingTask()) {
+                    std::this_thread::yield();
+                }
+            }
+            return;
+        }
+        std::unique_lock<std::mutex> lock(this->queue.done_locker);
+        this->queue.task_done.wait(lock, [this] () -> bool {
+            return this->queue.task_numb == 0;
+        });
+    }
+
+    /**
+     * @brief 关闭线程池
+     * 注意：还在等待的任务不会得到执行了
+     * 若是想要确保所有任务都被执行，要先调用 waitForTasks()
+    */
+    void close() {
+        if (this->is_stop) {
+            return;
+        }
+        this->is_stop = true;
+
+        int dropped = 0;
+        {
+            util::SpinLock_guard lock(this->queue.locker);
+            dropped = static_cast<int>(this->queue.tasks.size());
+            this->queue.tasks.clear();
+        }
+        if (dropped != 0) {
+            this->registry.consume(dropped);
+            this->queue.finish(dropped);
+        }
+        this->waitForTasks();
+        this->registry.detach(&this->queue);
+    }
+
+    /**
+     * @brief 在当前线程中执行一个这个线程池中还没有开始执行的任务
+     * @return 若执行了一个任务 -- true，反之
+    */
+    bool runPendingTask() {
+        util::SafeTask task;
+        {
+            util::SpinLock_guard lock(this->queue.locker);
+            if (this->queue.tasks.empty()) {
+                return false;
+            }
+            task = std::move(this->queue.tasks.front());
+            this->queue.tasks.pop();
+        }
+        this->registry.consume(1);
+        WorkerRegistry::runTask(&this->queue, task);
+        return true;
+    }
+
+    /**
+     * @brief 设置权重
+     * @param weight 几个线程池都有任务时，每轮可以连续取出 weight * shared_quantum 个任务
+    */
+    void setWeight(int weight) {
+        if (weight <= 0) {
+            throw std::invalid_argument("[myHipeError]: The weight of a shared pond must be positive.");
+        }
+        this->queue.weight.store(weight, std::memory_order_relaxed);
+    }
+
+    int getWeight() const {
+        return this->queue.weight.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @return 线程池中的任务数量，正在进行中的任务也算在内
+    */
+    int getTasksRemain() {
+        return this->queue.task_numb.load();
+    }
+
+    /**
+     * @return 共享的工作线程的数量
+    */
+    int getThreadNumb() {
+        return this->registry.getThreadNumb();
+    }
+
+    /**
+     * @return 当前线程是否是 WorkerRegistry 的工作线程
+    */
+    bool isWorkerThread() const {
+        return this->registry.isWorkerThread();
+    }
+
+    WorkerRegistry & getRegistry() {
+        return this->registry;
+    }
+
+    /**
+     * @brief 获取运行指标的快照，工作线程的计数器由所有共享它们的线程池一起累计
+    */
+    util::PondStats stats() {
+        util::PondStats result = this->registry.stats();
+        result.tasks_remain = this->getTasksRemain();
+        return result;
+    }
+
+private:
+    WorkerRegistry & registry;
+    SharedQueue queue;
+    bool is_stop{false};
+};
+
+}   // !! myHipe
+
+#endif  // !! MYHIPE_INCLUDE_THREAD_POND_SHARED_POND_H__
@@ -34,50 +34,113 @@
 // 
 //===----------------------------------------------------------------------===//
 
+#include <cmath>
 #include "../header.h"
 
-    namespace myHipe {
+namespace myHipe {
 
 //=======================================//
 // 支持双端队列替换算法的 线程对象
+// 模板参数 Config 是策略包 PondPolicy（见 policy.h），也可以只给出保护公开任务队列的锁，
+// 默认是 util::SpinLock，也可以选择 std::mutex / util::TTASLock / util::TicketLock /
+// util::McsLock，搭配 util::LockStats 可以统计每条队列的竞争情况
 //=======================================//
-class DqThread : public ThreadBase
+template <typename Config = PondPolicy<>>
+class BasicDqThread : public ThreadBase
 {
 public:
+    using Policy = typename util::toPondPolicy<Config>::type;
+    using Locker = typename Policy::lock_type;
+    using Stats = typename Policy::stats_type;
+    using TaskQueue = typename Policy::template queue_type<util::SafeTask>;
+
     /**
     * @brief 执行(this->buffer_queue)中的第一个任务
     */
     void runTask() {
         while (!this->buffer_task_queue.empty()) {
-            util::invoke(this->buffer_task_queue.front());
+            // 先取出任务再执行，任务内部调用 runPendingTask 时可以继续执行 buffer_queue 中后面的任务
+            util::SafeTask task(std::move(this->buffer_task_queue.front()));
             this->buffer_task_queue.pop();
+            this->traceEvent(util::TraceEvent::RunBegin);
+            util::invoke(task);
+            this->traceEvent(util::TraceEvent::RunEnd);
+            this->markProgress();
+            Stats::addTasks(*this);
             this->task_numb -= 1;
         }
     }
 
+    /**
+     * @brief 取出一个还没有开始执行的任务，交给其他线程执行，执行完后需要调用 finishTasks()
+     * @param task 取出的任务
+     * @param owner 调用者是否是当前线程自己，只有自己才能访问 buffer_queue
+    */
+    bool tryPopTask(util::SafeTask & task, bool owner) {
+        if (owner && !this->buffer_task_queue.empty()) {
+            task = std::move(this->buffer_task_queue.front());
+            this->buffer_task_queue.pop();
+            return true;
+        }
+        if (this->task_queue_locker.try_lock()) {
+            if (!this->public_task_queue.empty()) {
+                task = std::move(this->public_task_queue.front());
+                this->public_task_queue.pop();
+                this->recordShared();
+                this->task_queue_locker.unlock();
+                return true;
+            }
+            this->task_queue_locker.unlock();
+        }
+        return false;
+    }
+
     /**
      * @brief 尝试从 this->public_queue 中加载任务到 this->buffer_queue 中
     */
     bool tryLoadTask() {
         this->task_queue_locker.lock();
         this->public_task_queue.swap(this->buffer_task_queue);
+        this->recordShared();
         this->task_queue_locker.unlock();
+        this->owned_bytes.store(util::queueBytes(this->buffer_task_queue), std::memory_order_relaxed);
 
-        return !this->buffer_task_queue.empty();
+        if (this->buffer_task_queue.empty()) {
+            return false;
+        }
+        this->traceEvent(util::TraceEvent::Dequeue, 0, static_cast<int>(this->buffer_task_queue.size()));
+        return true;
     }
 
     /**
-     * @brief 尝试从其他线程中获得任务
-     * @param another 另一个线程
+     * @brief 尝试将当前线程公开队列中的一部分任务交给另一个线程
+     * @param another 另一个线程（窃取者），它的 buffer_queue 此时应当为空
+     * @param ratio 每次窃取的比例，取值 (0, 1]，至少窃取一个任务
+     * 只窃取一部分（默认一半）任务，避免窃取者拿走全部任务后被窃取者立刻空闲，
+     * 两个线程之间来回窃取（乒乓）。ratio 为 1 时退化为整条队列交换
     */
-    bool tryGiveTasksToAnother(DqThread & another) {
+    bool tryGiveTasksToAnother(BasicDqThread & another, double ratio = 0.5) {
         if (this->task_queue_locker.try_lock()) {
-            if (!this->public_task_queue.empty()) {
-                auto numb = this->public_task_queue.size();
-                this->public_task_queue.swap(another.buffer_task_queue);
+            auto total = this->public_task_queue.size();
+            if (total != 0) {
+                auto numb = static_cast<size_t>(std::ceil(static_cast<double>(total) * ratio));
+                numb = (numb < 1) ? 1 : ((numb > total) ? total : numb);
+
+                if (numb == total) {
+                    this->public_task_queue.swap(another.buffer_task_queue);
+                }
+                else {
+                    for (size_t i = 0; i < numb; i++) {
+                        util::moveFront(this->public_task_queue, another.buffer_task_queue);
+                    }
+                }
+                this->recordShared();
                 this->task_queue_locker.unlock();
-                this->task_numb -= static_cast<int>(numb);
+                another.owned_bytes.store(util::queueBytes(another.buffer_task_queue), std::memory_order_relaxed);
+
+                // 先增加再减少，避免 waitForTasks 看到总任务数短暂为 0
                 another.task_numb += static_cast<int>(numb);
+                this->task_numb -= static_cast<int>(numb);
                 return true;
             }
             else {
@@ -93,8 +156,9 @@ public:
     */
     template <typename T>
     void enqueue(T && tarTask) {
-        util::SpinLock_guard lock(this->task_queue_locker);
+        std::lock_guard<Locker> lock(this->task_queue_locker);
         this->public_task_queue.emplace(std::forward<T>(tarTask));
+        this->recordShared();
         this->task_numb += 1;
     }
 
@@ -103,42 +167,153 @@ public:
     */
     template <typename Container>
     void enqueue(Container & container, size_t size) {
-        util::SpinLock_guard locker(this->task_queue_locker);
+        std::lock_guard<Locker> locker(this->task_queue_locker);
         for (size_t i = 0; i < size; i++) {
             this->public_task_queue.emplace(std::move(container[i]));
             this->task_numb += 1;
         }
+        this->recordShared();
+    }
+
+    /**
+     * @brief 按照任务容量预先分配两条任务队列的空间
+    */
+    void reserve(size_t capacity) {
+        util::reserveQueue(this->public_task_queue, capacity);
+        util::reserveQueue(this->buffer_task_queue, capacity);
+        this->recordShared();
+        this->owned_bytes.store(util::queueBytes(this->buffer_task_queue), std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 把缓冲任务队列中还没有执行的任务放回公开任务队列，让其他线程可以取走，
+     * 在 BlockingScope 中由线程自己调用
+    */
+    void publishBuffer() {
+        if (this->buffer_task_queue.empty()) {
+            return;
+        }
+        std::lock_guard<Locker> lock(this->task_queue_locker);
+        while (!this->buffer_task_queue.empty()) {
+            util::moveFront(this->buffer_task_queue, this->public_task_queue);
+        }
+        this->recordShared();
+    }
+
+    /**
+     * @brief 释放公开任务队列多余的内存，至少保留 keep 个任务的容量
+    */
+    void shrinkShared(size_t keep) {
+        std::lock_guard<Locker> lock(this->task_queue_locker);
+        util::shrinkQueue(this->public_task_queue, keep);
+        this->recordShared();
+    }
+
+    /**
+     * @brief 释放缓冲任务队列多余的内存，只由线程自己调用
+    */
+    void shrinkOwned(size_t keep) {
+        util::shrinkQueue(this->buffer_task_queue, keep);
+        this->owned_bytes.store(util::queueBytes(this->buffer_task_queue), std::memory_order_relaxed);
+    }
+
+    /**
+     * @return 两条任务队列占用的堆内存，缓冲任务队列是线程自己最近一次记录的值
+    */
+    size_t memoryBytes() {
+        std::lock_guard<Locker> lock(this->task_queue_locker);
+        return util::queueBytes(this->public_task_queue) + this->owned_bytes.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @return 公开任务队列的锁的统计信息，只有 Locker 带有统计策略时才能调用
+    */
+    template <typename L = Locker>
+    auto getLockStats() const -> decltype(std::declval<const L &>().getStats()) {
+        return this->task_queue_locker.getStats();
     }
 
 private:
-    std::queue<util::SafeTask> public_task_queue;
-    std::queue<util::SafeTask> buffer_task_queue;
-    util::SpinLock task_queue_locker{};
+    // 记录公开任务队列占用的内存，调用时需要持有 task_queue_locker
+    void recordShared() {
+        this->shared_bytes.store(util::queueBytes(this->public_task_queue), std::memory_order_relaxed);
+    }
+
+private:
+    TaskQueue public_task_queue;
+    TaskQueue buffer_task_queue;
+    Locker task_queue_locker{};
 };
 
+using DqThread = BasicDqThread<>;
+
 //=======================================//
 //              稳定线程池
 // 支持任务窃取 和 批量提交任务
+// 模板参数 Config 见 BasicDqThread，例如
+// BasicSteadyThreadPond<PondPolicy<std::mutex, util::DequeQueue, util::SleepIdle<>, util::NoWorkerStats>>
 //=======================================//
-class SteadyThreadPond : public FixedThreadPond<DqThread>
+template <typename Config = PondPolicy<>>
+class BasicSteadyThreadPond : public FixedThreadPond<BasicDqThread<Config>, typename util::toPondPolicy<Config>::type>
 {
+    using Thread = BasicDqThread<Config>;
+    using Policy = typename Thread::Policy;
+    using Locker = typename Thread::Locker;
+    using Stats = typename Thread::Stats;
+
 public:
     /**
      * @param thread_numb 固定线程的数量
      * @param task_capacity 线程池的任务容量
     */
-    explicit SteadyThreadPond(int thread_numb = 0, int task_capacity = HipeUnlimited) : FixedThreadPond(thread_numb, task_capacity) {
-        this->threads.reset(new DqThread[this->thread_numb]);
+    explicit BasicSteadyThreadPond(int thread_numb = 0, int task_capacity = HipeUnlimited)
+        : FixedThreadPond<Thread, Policy>(thread_numb, task_capacity) {
+        this->threads.reset(new Thread[this->thread_numb]);
         for (int i = 0; i < this->thread_numb; i++) {
-            this->threads[i].bindHandle(std::thread(&SteadyThreadPond::worker, this, i));
+            this->threads[i].reserve(static_cast<size_t>(this->taskNum_of_thread_capacity));
+            this->threads[i].bindHandle(std::thread(&BasicSteadyThreadPond::worker, this, i));
         }
     }
 
-    ~SteadyThreadPond() override = default;
+    ~BasicSteadyThreadPond() override = default;
+
+    std::string pondType() const override {
+        return "steady";
+    }
+
+    /**
+     * @brief 设置每次任务窃取的比例
+     * @param ratio 取值 (0, 1]，默认 0.5（窃取一半），1 表示窃取全部
+    */
+    void setStealRatio(double ratio) {
+        if (!(ratio > 0.0 && ratio <= 1.0)) {
+            throw std::invalid_argument("[myHipeError]: The steal ratio must be in (0, 1].");
+        }
+        this->steal_ratio = ratio;
+    }
+
+    /**
+     * @return 每次任务窃取的比例
+    */
+    double getStealRatio() const {
+        return this->steal_ratio;
+    }
+
+    /**
+     * @brief 获取第 index 个线程公开任务队列的锁的统计信息
+     * 只有 Locker 带有统计策略时才能调用，例如 BasicSteadyThreadPond<util::TicketLock<util::LockStats>>
+    */
+    template <typename L = Locker>
+    auto getQueueLockStats(int index) const -> decltype(std::declval<const L &>().getStats()) {
+        assert(index >= 0 && index < this->thread_numb);
+        return this->threads[index].getLockStats();
+    }
 
 private:
     void worker(int index) {
-        DqThread & self = this->threads[index];
+        Thread & self = this->threads[index];
+        typename Policy::idle_type idle;
+        this->bindCurrentWorker(index);
 
         while (!this->is_stop) {
             // 若任务队列中没有任务了
@@ -152,28 +327,41 @@ private:
 
                 // 窃取任务
                 if (this->enable_steal_tasks) {
-                    for (int i = index, j = 0; j < this->max_steal; j++) {
-                        util::recyclePlus(i, 0, this->thread_numb);
-                        if (this->threads[i].tryGiveTasksToAnother(self)) {
-                            self.runTask();     // 和 balanced_pond 不同，这里是直接将 this->buffer_queue 中所有任务都执行
-                            break;
-                        }
+                    int victim = this->trySteal(index, [this, &self] (int i) -> bool {
+                        return this->threads[i].tryGiveTasksToAnother(self, this->steal_ratio);
+                    });
+                    if (victim >= 0) {
+                        Stats::markBusy(self);
+                        self.markWorking();
+                        idle.reset();
+                        self.traceEvent(util::TraceEvent::Steal, victim, self.getTasksNumb());
+                        self.runTask();     // 和 balanced_pond 不同，这里是直接将窃取到 this->buffer_queue 中的任务都执行
                     }
                     if (!self.notTask() || self.isWaiting()) {
                         continue;
                     }
                 }
-                std::this_thread::yield();
+                Stats::markIdle(self);
+                this->reclaimIdle(self);
+                idle.wait();
             }
             else {
                 if (self.tryLoadTask()) {
+                    Stats::markBusy(self);
+                    self.markWorking();
+                    idle.reset();
                     self.runTask();
                 }
             }
         }
     }
+
+private:
+    double steal_ratio{0.5};        // 每次窃取任务的比例
 };
 
+using SteadyThreadPond = BasicSteadyThreadPond<>;
+
 }  // !! end namespace myHipe
 
 #endif // !! MYHIPE_THREAD_POND_STEADY_POND_H__
\ No newline at end of file
@@ -0,0 +1,349 @@
+#ifndef MYHIPE_INCLUDE_THREAD_POND_TYPED_POND_H__
+#define MYHIPE_INCLUDE_THREAD_POND_TYPED_POND_H__
+
+//===-- thread_pond/typed_pond.h - 单一任务类型的稳定线程池 -------*- C++ -*-----------===//
+//
+//     SteadyThreadPond 中的每个任务都会被包装成 util::SafeTask：不超过
+// util::safe_task_inline_size（48 字节）的任务直接保存在 SafeTask 内部，不需要分配
+// 内存，但执行时仍然要通过函数指针间接调用，任务的函数体无法内联到工作线程的循环中，
+// 而且每个任务都要占用一个完整的 SafeTask。若任务流中只有一种可调用类型（例如同一个
+// lambda 或仿函数提交上百万次），这些开销是可以省掉的。
+//
+//     TypedSteadyPond<Task> 的机制和 SteadyThreadPond 相同（公开队列 + 缓冲队列
+// 替换、负载均衡、任务窃取、任务溢出），不同的是每个线程的两条队列都是
+// std::vector<Task>，任务直接按值连续地存放在队列中，工作线程直接调用
+// Task::operator()，编译器可以把任务的函数体内联到工作线程的循环中。
+//     交换公开队列和缓冲队列时，缓冲队列的内存会被留给公开队列继续使用，稳定运行
+// 之后提交任务不会再分配内存。
+//
+//     注意：Task 必须是可移动构造的可调用类型，submitForReturn 不可用（需要返回值
+// 时可以把 std::promise 放在任务中）。溢出的任务会被包装成 util::SafeTask 放入
+// pullOverFlowTasks() 中。
+//
+//===----------------------------------------------------------------------===//
+
+#include <cmath>
+#include <vector>
+#include "../header.h"
+
+namespace myHipe {
+
+//=======================================//
+// 只存放 Task 类型任务的双队列线程对象
+// 模板参数 Locker 见 BasicDqThread
+//=======================================//
+template <typename Task, typename Locker = util::SpinLock>
+class TypedDqThread : public ThreadBase
+{
+public:
+    /**
+    * @brief 按顺序执行 this->buffer_queue 中的所有任务
+    */
+    void runTask() {
+        // 任务内部调用 runPendingTask 时会从 buffer_head 继续取任务，所以每次都要重新比较
+        while (this->buffer_head < this->buffer_task_queue.size()) {
+            Task & task = this->buffer_task_queue[this->buffer_head++];
+            this->traceEvent(util::TraceEvent::RunBegin);
+            task();
+            this->traceEvent(util::TraceEvent::RunEnd);
+            this->markProgress();
+            this->counters.addTasks();
+            this->task_numb -= 1;
+        }
+        this->buffer_task_queue.clear();        // 保留容量，留给下一次交换
+        this->buffer_head = 0;
+    }
+
+    /**
+     * @brief 取出一个还没有开始执行的任务，交给其他线程执行，执行完后需要调用 finishTasks()
+     * @param task 取出的任务
+     * @param owner 调用者是否是当前线程自己，只有自己才能访问 buffer_queue
+    */
+    bool tryPopTask(util::SafeTask & task, bool owner) {
+        if (owner && this->buffer_head < this->buffer_task_queue.size()) {
+            task.reset(std::move(this->buffer_task_queue[this->buffer_head++]));
+            return true;
+        }
+        if (this->task_queue_locker.try_lock()) {
+            // 和 buffer_queue 一样从队首取任务，取完之后一起清空
+            if (this->public_head < this->public_task_queue.size()) {
+                task.reset(std::move(this->public_task_queue[this->public_head++]));
+                if (this->public_head == this->public_task_queue.size()) {
+                    this->public_task_queue.clear();
+                    this->public_head = 0;
+                }
+                this->task_queue_locker.unlock();
+                return true;
+            }
+            this->task_queue_locker.unlock();
+        }
+        return false;
+    }
+
+    /**
+     * @brief 尝试从 this->public_queue 中加载任务到 this->buffer_queue 中
+    */
+    bool tryLoadTask() {
+        this->task_queue_locker.lock();
+        this->compactPublic();
+        this->public_task_queue.swap(this->buffer_task_queue);
+        this->recordShared();
+        this->task_queue_locker.unlock();
+        this->owned_bytes.store(util::queueBytes(this->buffer_task_queue), std::memory_order_relaxed);
+
+        if (this->buffer_task_queue.empty()) {
+            return false;
+        }
+        this->traceEvent(util::TraceEvent::Dequeue, 0, static_cast<int>(this->buffer_task_queue.size()));
+        return true;
+    }
+
+    /**
+     * @brief 尝试将当前线程公开队列末尾的一部分任务交给另一个线程
+     * @param another 另一个线程（窃取者），它的 buffer_queue 此时应当为空
+     * @param ratio 每次窃取的比例，取值 (0, 1]，至少窃取一个任务
+    */
+    bool tryGiveTasksToAnother(TypedDqThread & another, double ratio = 0.5) {
+        if (this->task_queue_locker.try_lock()) {
+            this->compactPublic();
+            auto total = this->public_task_queue.size();
+            if (total != 0) {
+                auto numb = static_cast<size_t>(std::ceil(static_cast<double>(total) * ratio));
+                numb = (numb < 1) ? 1 : ((numb > total) ? total : numb);
+
+                if (numb == total) {
+                    this->public_task_queue.swap(another.buffer_task_queue);
+                }
+                else {
+                    auto first = this->public_task_queue.end() - static_cast<std::ptrdiff_t>(numb);
+                    another.buffer_task_queue.insert(another.buffer_task_queue.end(),
+                                                     std::make_move_iterator(first),
+                                                     std::make_move_iterator(this->public_task_queue.end()));
+                    this->public_task_queue.erase(first, this->public_task_queue.end());
+                }
+                this->recordShared();
+                this->task_queue_locker.unlock();
+                another.owned_bytes.store(util::queueBytes(another.buffer_task_queue), std::memory_order_relaxed);
+
+                // 先增加再减少，避免 waitForTasks 看到总任务数短暂为 0
+                another.task_numb += static_cast<int>(numb);
+                this->task_numb -= static_cast<int>(numb);
+                return true;
+            }
+            else {
+                this->task_queue_locker.unlock();
+                return false;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief 按照任务容量预先分配两条任务队列的空间
+    */
+    void reserve(size_t capacity) {
+        this->public_task_queue.reserve(capacity);
+        this->buffer_task_queue.reserve(capacity);
+        this->recordShared();
+        this->owned_bytes.store(util::queueBytes(this->buffer_task_queue), std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 添加一个任务到任务队列中
+    */
+    template <typename T>
+    void enqueue(T && tarTask) {
+        std::lock_guard<Locker> lock(this->task_queue_locker);
+        this->public_task_queue.emplace_back(std::forward<T>(tarTask));
+        this->recordShared();
+        this->task_numb += 1;
+    }
+
+    /**
+     * @brief 添加多个任务到任务队列中
+    */
+    template <typename Container>
+    void enqueue(Container & container, size_t size) {
+        std::lock_guard<Locker> locker(this->task_queue_locker);
+        for (size_t i = 0; i < size; i++) {
+            this->public_task_queue.emplace_back(std::move(container[i]));
+        }
+        this->recordShared();
+        this->task_numb += static_cast<int>(size);
+    }
+
+    /**
+     * @brief 把缓冲任务队列中还没有执行的任务放回公开任务队列，让其他线程可以取走，
+     * 在 BlockingScope 中由线程自己调用。正在执行的任务在 buffer_head 之前，不会被移动
+    */
+    void publishBuffer() {
+        if (this->buffer_head >= this->buffer_task_queue.size()) {
+            return;
+        }
+        auto first = this->buffer_task_queue.begin() + static_cast<std::ptrdiff_t>(this->buffer_head);
+        std::lock_guard<Locker> lock(this->task_queue_locker);
+        this->public_task_queue.insert(this->public_task_queue.end(),
+                                       std::make_move_iterator(first),
+                                       std::make_move_iterator(this->buffer_task_queue.end()));
+        this->recordShared();
+        this->buffer_task_queue.erase(first, this->buffer_task_queue.end());
+    }
+
+    /**
+     * @brief 释放公开任务队列多余的内存，至少保留 keep 个任务的容量
+    */
+    void shrinkShared(size_t keep) {
+        std::lock_guard<Locker> lock(this->task_queue_locker);
+        this->compactPublic();
+        util::shrinkQueue(this->public_task_queue, keep);
+        this->recordShared();
+    }
+
+    /**
+     * @brief 释放缓冲任务队列多余的内存，只由线程自己在空闲时调用
+    */
+    void shrinkOwned(size_t keep) {
+        util::shrinkQueue(this->buffer_task_queue, keep);
+        this->owned_bytes.store(util::queueBytes(this->buffer_task_queue), std::memory_order_relaxed);
+    }
+
+    /**
+     * @return 两条任务队列占用的堆内存，缓冲任务队列是线程自己最近一次记录的值
+    */
+    size_t memoryBytes() {
+        std::lock_guard<Locker> lock(this->task_queue_locker);
+        return util::queueBytes(this->public_task_queue) + this->owned_bytes.load(std::memory_order_relaxed);
+    }
+
+private:
+    // 记录公开任务队列占用的内存，调用时需要持有 task_queue_locker
+    void recordShared() {
+        this->shared_bytes.store(util::queueBytes(this->public_task_queue), std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 移除公开队列中已经被 tryPopTask 取走的任务，调用时需要持有 task_queue_locker
+    */
+    void compactPublic() {
+        if (this->public_head != 0) {
+            this->public_task_queue.erase(this->public_task_queue.begin(),
+                                          this->public_task_queue.begin() + static_cast<std::ptrdiff_t>(this->public_head));
+            this->public_head = 0;
+        }
+    }
+
+private:
+    std::vector<Task> public_task_queue;
+    std::vector<Task> buffer_task_queue;
+    size_t public_head{0};              // public_queue 中下一个可以被 tryPopTask 取走的任务
+    size_t buffer_head{0};              // buffer_queue 中下一个要执行的任务
+    Locker task_queue_locker{};
+};
+
+//=======================================//
+//       单一任务类型的稳定线程池
+// 支持任务窃取 和 批量提交任务
+//=======================================//
+template <typename Task, typename Locker = util::SpinLock>
+class TypedSteadyPond : public FixedThreadPond<TypedDqThread<Task, Locker>>
+{
+    static_assert(std::is_move_constructible<Task>::value, "[HipeError]: The task type of TypedSteadyPond must be move constructible.");
+
+    using Thread = TypedDqThread<Task, Locker>;
+
+public:
+    /**
+     * @param thread_numb 固定线程的数量
+     * @param task_capacity 线程池的任务容量
+    */
+    explicit TypedSteadyPond(int thread_numb = 0, int task_capacity = HipeUnlimited)
+        : FixedThreadPond<Thread>(thread_numb, task_capacity) {
+        this->threads.reset(new Thread[this->thread_numb]);
+        for (int i = 0; i < this->thread_numb; i++) {
+            this->threads[i].reserve(static_cast<size_t>(this->taskNum_of_thread_capacity));
+            this->threads[i].bindHandle(std::thread(&TypedSteadyPond::worker, this, i));
+        }
+    }
+
+    ~TypedSteadyPond() override = default;
+
+    std::string pondType() const override {
+        return "typed";
+    }
+
+    // 队列中只能存放 Task，不能存放 std::packaged_task、RangeRunner 和 StrandDrain
+    template <typename Func>
+    void submitForReturn(Func && func) = delete;
+
+    template <typename Func>
+    void submitRange(size_t n, Func && func, size_t grain = 0) = delete;
+
+    template <typename Func>
+    void submitKeyed(uint64_t key, Func && func) = delete;
+
+    /**
+     * @brief 设置每次任务窃取的比例
+     * @param ratio 取值 (0, 1]，默认 0.5（窃取一半），1 表示窃取全部
+    */
+    void setStealRatio(double ratio) {
+        if (!(ratio > 0.0 && ratio <= 1.0)) {
+            throw std::invalid_argument("[myHipeError]: The steal ratio must be in (0, 1].");
+        }
+        this->steal_ratio = ratio;
+    }
+
+    /**
+     * @return 每次任务窃取的比例
+    */
+    double getStealRatio() const {
+        return this->steal_ratio;
+    }
+
+private:
+    void worker(int index) {
+        Thread & self = this->threads[index];
+        this->bindCurrentWorker(index);
+
+        while (!this->is_stop) {
+            if (self.notTask()) {
+                if (self.isWaiting()) {
+                    self.notifyTaskDone();
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                if (this->enable_steal_tasks) {
+                    int victim = this->trySteal(index, [this, &self] (int i) -> bool {
+                        return this->threads[i].tryGiveTasksToAnother(self, this->steal_ratio);
+                    });
+                    if (victim >= 0) {
+                        self.markBusy();
+                        self.markWorking();
+                        self.traceEvent(util::TraceEvent::Steal, victim, self.getTasksNumb());
+                        self.runTask();
+                    }
+                    if (!self.notTask() || self.isWaiting()) {
+                        continue;
+                    }
+                }
+                self.markIdle();
+                this->reclaimIdle(self);
+                std::this_thread::yield();
+            }
+            else {
+                if (self.tryLoadTask()) {
+                    self.markBusy();
+                    self.markWorking();
+                    self.runTask();
+                }
+            }
+        }
+    }
+
+private:
+    double steal_ratio{0.5};        // 每次窃取任务的比例
+};
+
+}  // !! end namespace myHipe
+
+#endif // !! MYHIPE_INCLUDE_THREAD_POND_TYPED_POND_H__
@@ -0,0 +1,222 @@
+#ifndef MYHIPE_INCLUDE_TOPOLOGY_H__
+#define MYHIPE_INCLUDE_TOPOLOGY_H__
+
+//===-- topology.h - cpu 拓扑 -------*- C++ -*-----------===//
+//
+//     任务窃取时优先从距离近的线程窃取：共享同一个 L3 缓存的线程最近，同一个
+// NUMA 节点上的线程次之，跨节点（跨 socket）的线程最远。CpuTopology 在第一次使用
+// 时从 sysfs 读取每个 cpu 所在的 L3 缓存和 NUMA 节点：
+//
+//     /sys/devices/system/cpu/cpuN/cache/indexK/{level, shared_cpu_list}
+//     /sys/devices/system/node/nodeN/cpulist
+//
+//     读取不到拓扑（非 Linux、容器中没有挂载 sysfs 等）时，所有 cpu 之间的距离都
+// 相同，窃取顺序退化为随机顺序。工作线程没有绑定 cpu，线程所在的 cpu 只在它开始
+// 窃取时更新，所以距离只是一个尽力而为的估计。
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace myHipe
+{
+
+namespace util
+{
+
+/**
+ * @brief 解析 sysfs 中的 cpu 列表，例如 "0-3,8,10-11"
+*/
+inline std::vector<int> parseCpuList(const std::string & text)
+{
+    std::vector<int> result;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        size_t dash = item.find('-');
+        try {
+            int first = std::stoi(item.substr(0, dash));
+            int last = (dash == std::string::npos) ? first : std::stoi(item.substr(dash + 1));
+            for (int cpu = first; cpu <= last; cpu++) {
+                result.push_back(cpu);
+            }
+        }
+        catch (const std::exception &) {
+            // 空行或者无法解析的片段，忽略
+        }
+    }
+    return result;
+}
+
+// ======================
+//   cpu 之间的距离
+// ======================
+static const int cpu_distance_cache = 0;       // 共享 L3 缓存（或者拓扑未知）
+static const int cpu_distance_node = 1;        // 同一个 NUMA 节点
+static const int cpu_distance_remote = 2;      // 跨 NUMA 节点
+
+class CpuTopology
+{
+public:
+    // 进程中只读取一次
+    static const CpuTopology & get() {
+        static CpuTopology topology;
+        return topology;
+    }
+
+    /**
+     * @return 是否读取到了拓扑
+    */
+    bool known() const {
+        return !this->l3_of.empty() || !this->node_of.empty();
+    }
+
+    /**
+     * @return cpu 所在的 L3 缓存编号，未知时返回 -1
+    */
+    int l3Of(int cpu) const {
+        return lookup(this->l3_of, cpu);
+    }
+
+    /**
+     * @return cpu 所在的 NUMA 节点编号，未知时返回 -1
+    */
+    int nodeOf(int cpu) const {
+        return lookup(this->node_of, cpu);
+    }
+
+    /**
+     * @return 两个 cpu 之间的距离：cpu_distance_cache / cpu_distance_node / cpu_distance_remote
+    */
+    int distance(int a, int b) const {
+        if (a < 0 || b < 0 || a == b) {
+            return cpu_distance_cache;
+        }
+        int l3_a = this->l3Of(a);
+        if (l3_a >= 0 && l3_a == this->l3Of(b)) {
+            return cpu_distance_cache;
+        }
+        int node_a = this->nodeOf(a);
+        int node_b = this->nodeOf(b);
+        if (node_a < 0 || node_b < 0) {
+            // 没有 NUMA 信息时，只能区分是否共享 L3
+            return (l3_a >= 0) ? cpu_distance_node : cpu_distance_cache;
+        }
+        return (node_a == node_b) ? cpu_distance_node : cpu_distance_remote;
+    }
+
+private:
+    CpuTopology() {
+#ifdef __linux__
+        this->loadCaches();
+        this->loadNodes();
+#endif
+    }
+
+    static int lookup(const std::vector<int> & table, int cpu) {
+        return (cpu >= 0 && cpu < static_cast<int>(table.size())) ? table[cpu] : -1;
+    }
+
+    static bool readLine(const std::string & path, std::string & line) {
+        std::ifstream file(path.c_str());
+        return file && std::getline(file, line);
+    }
+
+    static void assign(std::vector<int> & table, int cpu, int id) {
+        if (cpu >= static_cast<int>(table.size())) {
+            table.resize(static_cast<size_t>(cpu) + 1, -1);
+        }
+        table[cpu] = id;
+    }
+
+    // 共享同一个 shared_cpu_list 的 cpu 属于同一个 L3 缓存
+    void loadCaches() {
+        std::map<std::string, int> ids;
+        for (int cpu = 0; ; cpu++) {
+            std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+            std::string line;
+            if (!readLine(base + "/online", line) && !readLine(base + "/cache/index0/level", line)) {
+                break;
+            }
+            for (int index = 0; index < 8; index++) {
+                std::string cache = base + "/cache/index" + std::to_string(index);
+                std::string level;
+                if (!readLine(cache + "/level", level)) {
+                    break;
+                }
+                std::string shared;
+                if (level == "3" && readLine(cache + "/shared_cpu_list", shared)) {
+                    auto found = ids.insert(std::make_pair(shared, static_cast<int>(ids.size())));
+                    assign(this->l3_of, cpu, found.first->second);
+                    break;
+                }
+            }
+        }
+    }
+
+    void loadNodes() {
+        for (int node = 0; ; node++) {
+            std::string line;
+            if (!readLine("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist", line)) {
+                break;
+            }
+            std::vector<int> cpus = parseCpuList(line);
+            for (size_t i = 0; i < cpus.size(); i++) {
+                assign(this->node_of, cpus[i], node);
+            }
+        }
+    }
+
+private:
+    std::vector<int> l3_of;         // 下标是 cpu 编号
+    std::vector<int> node_of;
+};
+
+/**
+ * @return 当前线程所在的 cpu，未知时返回 -1
+*/
+inline int currentCpu()
+{
+#ifdef __linux__
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
+
+// =====================================================
+//  xorshift 随机数，每个工作线程一个，用来打乱窃取的顺序
+// =====================================================
+class FastRand
+{
+public:
+    explicit FastRand(uint32_t seed = 2463534242u) : state(seed ? seed : 2463534242u) {}
+
+    void seed(uint32_t value) {
+        this->state = value ? value : 2463534242u;
+    }
+
+    uint32_t next() {
+        this->state ^= this->state << 13;
+        this->state ^= this->state >> 17;
+        this->state ^= this->state << 5;
+        return this->state;
+    }
+
+private:
+    uint32_t state;
+};
+
+}   // !! namespace util
+}   // !! namespace myHipe
+
+#endif  // !! MYHIPE_INCLUDE_TOPOLOGY_H__
@@ -0,0 +1,285 @@
+#ifndef MYHIPE_INCLUDE_TRACER_H__
+#define MYHIPE_INCLUDE_TRACER_H__
+
+//===-- tracer.h - 线程池的活动追踪 -------*- C++ -*-----------===//
+//
+//     为线程池中的每个线程（以及提交任务的线程）准备一个固定容量的环形缓冲区，
+// 记录 入队、出队、窃取、任务开始/结束、挂起/唤醒、线程数量调整 等事件，写满之后
+// 覆盖最旧的事件。记录一个事件只需要一次 fetch_add、一次槽位序号的 CAS 和一次读时钟，没有
+// 开启追踪时只多一次指针判断。每个槽位带有序号，导出时跳过正在写入的事件，所以在
+// 线程池运行时导出也不会读到写了一半的事件。
+//     导出的格式是 Chrome trace JSON，可以直接在 chrome://tracing 或 Perfetto
+// (ui.perfetto.dev) 中打开查看每个线程在什么时候执行了什么、执行了多久。
+//     注意：导出过程中仍在写入的事件会被跳过，想要完整的记录要先 waitForTasks()。
+//
+//===----------------------------------------------------------------------===//
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace myHipe
+{
+
+namespace util
+{
+
+// ======================
+//      追踪事件的类型
+// ======================
+enum class TraceEvent : uint8_t
+{
+    Enqueue,        // 提交任务，arg0 = 目标线程，arg1 = 任务数量
+    Dequeue,        // 从自己的队列中加载任务，arg1 = 任务数量
+    Steal,          // 窃取任务，arg0 = 被窃取的线程，arg1 = 任务数量
+    RunBegin,       // 开始执行一个任务
+    RunEnd,         // 一个任务执行结束
+    Park,           // 没有任务，开始空闲 / 挂起
+    Unpark,         // 结束空闲 / 被唤醒
+    Resize          // 线程数量调整，arg1 = 调整后的线程数量
+};
+
+struct TraceRecord
+{
+    int64_t ts{0};          // 相对于追踪开始的时间（纳秒）
+    int32_t arg0{0};
+    int32_t arg1{0};
+    TraceEvent type{TraceEvent::Enqueue};
+};
+
+// =====================================================
+//  一个线程的环形事件缓冲区
+//  写入位置由 fetch_add 分配，每个槽位有一个序号：写入时先把序号改为奇数（写入中），
+//  写完后改为 2 * 位置 + 2。多个线程写同一条缓冲区（提交任务的线程共用一条缓冲区）
+//  时，落后整整一圈的写入者会放弃自己的事件，不会覆盖更新的事件；读取时只接受序号
+//  和位置一致、并且读取前后序号没有变化的事件。
+//  注意：成对的事件（run、idle）只能由一个线程写入，否则导出后无法配对
+// =====================================================
+class TraceRing
+{
+public:
+    TraceRing(size_t capacity, std::chrono::steady_clock::time_point epoch) : epoch(epoch) {
+        size_t cap = 1;
+        while (cap < capacity) {
+            cap <<= 1;
+        }
+        this->mask = cap - 1;
+        this->slots.reset(new Slot[cap]);
+    }
+
+    void record(TraceEvent type, int32_t arg0 = 0, int32_t arg1 = 0) {
+        uint64_t idx = this->head.fetch_add(1, std::memory_order_relaxed);
+        Slot & slot = this->slots[idx & this->mask];
+
+        // 槽位正在被写入，或者已经被更新的事件占用时，放弃这个事件
+        uint64_t current = slot.seq.load(std::memory_order_relaxed);
+        if ((current & 1) != 0 || current > 2 * idx
+            || !slot.seq.compare_exchange_strong(current, 2 * idx + 1, std::memory_order_relaxed)) {
+            return;
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        int64_t ts = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - this->epoch).count();
+        slot.ts.store(ts, std::memory_order_relaxed);
+        slot.arg0.store(arg0, std::memory_order_relaxed);
+        slot.arg1.store(arg1, std::memory_order_relaxed);
+        slot.type.store(static_cast<uint8_t>(type), std::memory_order_relaxed);
+        slot.seq.store(2 * idx + 2, std::memory_order_release);
+    }
+
+    // 按照写入顺序取出缓冲区中还保留着的事件
+    std::vector<TraceRecord> collect() const {
+        uint64_t end = this->head.load(std::memory_order_acquire);
+        uint64_t cap = this->mask + 1;
+        uint64_t begin = (end > cap) ? end - cap : 0;
+
+        std::vector<TraceRecord> result;
+        result.reserve(static_cast<size_t>(end - begin));
+        for (uint64_t i = begin; i < end; i++) {
+            const Slot & slot = this->slots[i & this->mask];
+            uint64_t seq = slot.seq.load(std::memory_order_acquire);
+            if (seq != 2 * i + 2) {
+                continue;       // 还没有写完，或者已经被覆盖
+            }
+            TraceRecord r;
+            r.ts = slot.ts.load(std::memory_order_relaxed);
+            r.arg0 = slot.arg0.load(std::memory_order_relaxed);
+            r.arg1 = slot.arg1.load(std::memory_order_relaxed);
+            r.type = static_cast<TraceEvent>(slot.type.load(std::memory_order_relaxed));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) == seq) {
+                result.push_back(r);
+            }
+        }
+        return result;
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> seq{0};
+        std::atomic<int64_t> ts{0};
+        std::atomic<int32_t> arg0{0};
+        std::atomic<int32_t> arg1{0};
+        std::atomic<uint8_t> type{0};
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    size_t mask{0};
+    std::atomic<uint64_t> head{0};
+    std::chrono::steady_clock::time_point epoch;
+};
+
+// =====================================================
+//  一个线程池的追踪器，每个 lane 对应 Chrome trace 中的一行
+//  线程数量会变化的线程池（DynamicThreadPond）可以通过 addLane 为新的线程添加一行，
+//  已经添加的缓冲区在追踪器析构之前一直有效
+// =====================================================
+class PondTracer
+{
+public:
+    /**
+     * @param lane_names 每一行的名字，例如 "worker 0"、"submitter"
+     * @param events_per_lane 每一行最多保留的事件数量
+    */
+    PondTracer(const std::vector<std::string> & lane_names, size_t events_per_lane)
+        : PondTracer(lane_names, events_per_lane, std::chrono::steady_clock::now()) {}
+
+    PondTracer(const std::vector<std::string> & lane_names, size_t events_per_lane, std::chrono::steady_clock::time_point epoch)
+        : names(lane_names), epoch(epoch), events_per_lane(events_per_lane) {
+        for (size_t i = 0; i < lane_names.size(); i++) {
+            this->lanes.emplace_back(new TraceRing(events_per_lane, epoch));
+        }
+    }
+
+    TraceRing * lane(int index) {
+        std::lock_guard<std::mutex> lock(this->locker);
+        return this->lanes[index].get();
+    }
+
+    int laneNumb() const {
+        std::lock_guard<std::mutex> lock(this->locker);
+        return static_cast<int>(this->lanes.size());
+    }
+
+    /**
+     * @brief 添加一行，返回它的缓冲区
+    */
+    TraceRing * addLane(const std::string & name) {
+        std::lock_guard<std::mutex> lock(this->locker);
+        this->names.push_back(name);
+        this->lanes.emplace_back(new TraceRing(this->events_per_lane, this->epoch));
+        return this->lanes.back().get();
+    }
+
+    /**
+     * @brief 导出为 Chrome trace JSON
+     * @param pond_name 线程池的名字，显示为进程名
+    */
+    std::string toChromeJson(const std::string & pond_name = "myHipe") const {
+        std::ostringstream out;
+        out << "{\"traceEvents\":[\n";
+        out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"" << escape(pond_name) << "\"}}";
+
+        std::lock_guard<std::mutex> lock(this->locker);
+        for (size_t tid = 0; tid < this->lanes.size(); tid++) {
+            out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+                << ",\"args\":{\"name\":\"" << escape(this->names[tid]) << "\"}}";
+
+            std::vector<TraceRecord> records = this->lanes[tid]->collect();
+            for (size_t i = 0; i < records.size(); i++) {
+                out << ",\n";
+                writeEvent(out, records[i], static_cast<int>(tid));
+            }
+        }
+        out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+        return out.str();
+    }
+
+    /**
+     * @brief 导出到文件
+     * @return 若写入成功 -- true，反之
+    */
+    bool dump(const std::string & path, const std::string & pond_name = "myHipe") const {
+        std::ofstream file(path.c_str(), std::ios::out | std::ios::trunc);
+        if (!file) {
+            return false;
+        }
+        file << this->toChromeJson(pond_name);
+        return static_cast<bool>(file);
+    }
+
+private:
+    // JSON 字符串中的 '"'、'\\' 和控制字符需要转义
+    static std::string escape(const std::string & text) {
+        std::string result;
+        result.reserve(text.size());
+        for (size_t i = 0; i < text.size(); i++) {
+            char c = text[i];
+            if (c == '"' || c == '\\') {
+                result += '\\';
+                result += c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(static_cast<unsigned char>(c)));
+                result += buf;
+            }
+            else {
+                result += c;
+            }
+        }
+        return result;
+    }
+
+    static void writeEvent(std::ostringstream & out, const TraceRecord & r, int tid) {
+        char ts[32];
+        std::snprintf(ts, sizeof(ts), "%.3f", static_cast<double>(r.ts) / 1000.0);     // Chrome trace 的时间单位是微秒
+
+        out << "{\"pid\":1,\"tid\":" << tid << ",\"ts\":" << ts << ",";
+        switch (r.type) {
+        case TraceEvent::Enqueue:
+            out << "\"name\":\"enqueue\",\"ph\":\"i\",\"s\":\"t\",\"args\":{\"target\":" << r.arg0 << ",\"tasks\":" << r.arg1 << "}}";
+            break;
+        case TraceEvent::Dequeue:
+            out << "\"name\":\"dequeue\",\"ph\":\"i\",\"s\":\"t\",\"args\":{\"tasks\":" << r.arg1 << "}}";
+            break;
+        case TraceEvent::Steal:
+            out << "\"name\":\"steal\",\"ph\":\"i\",\"s\":\"t\",\"args\":{\"victim\":" << r.arg0 << ",\"tasks\":" << r.arg1 << "}}";
+            break;
+        case TraceEvent::RunBegin:
+            out << "\"name\":\"run\",\"ph\":\"B\"}";
+            break;
+        case TraceEvent::RunEnd:
+            out << "\"name\":\"run\",\"ph\":\"E\"}";
+            break;
+        case TraceEvent::Park:
+            out << "\"name\":\"idle\",\"ph\":\"B\"}";
+            break;
+        case TraceEvent::Unpark:
+            out << "\"name\":\"idle\",\"ph\":\"E\"}";
+            break;
+        case TraceEvent::Resize:
+            out << "\"name\":\"threads\",\"ph\":\"C\",\"args\":{\"threads\":" << r.arg1 << "}}";
+            break;
+        }
+    }
+
+private:
+    mutable std::mutex locker;                      // 保护 names 和 lanes，addLane 时会修改它们
+    std::vector<std::string> names;
+    std::vector<std::unique_ptr<TraceRing>> lanes;
+    std::chrono::steady_clock::time_point epoch;
+    size_t events_per_lane{0};
+};
+
+}   // !! namespace util
+}   // !! namespace myHipe
+
+#endif  // !! MYHIPE_INCLUDE_TRACER_H__
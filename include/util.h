@@ -2,11 +2,15 @@
 #define MYHIPE_INCLUDE_UTIL_H__
 
 #include <atomic>
+#include <cassert>
+#include <cstdint>
 #include <future>
 #include <functional>
 #include <ostream>
 #include <iostream>
 #include <chrono>
+#include <cstddef>
+#include <memory>
 #include <mutex>
 #include <ostream>
 #include <ratio>
@@ -17,6 +21,10 @@
 #include <vector>
 #include <algorithm>
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 namespace myHipe 
 {
 
@@ -272,6 +280,37 @@ private:
     std::vector<T> results;
 };
 
+// ======================================
+//  自旋等待时让出流水线（x86 的 pause 指令）
+//  减少自旋对同一物理核心上另一个超线程的影响
+// ======================================
+inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#elif defined(_MSC_VER)
+    _mm_pause();
+#endif
+}
+
+// ======================================
+//  自旋等待的第 spins 次：先自旋，自旋太久后让出 cpu
+//  避免持有锁的线程或下一个排队的线程被抢占时，等待者空转整个时间片
+// ======================================
+static const uint64_t max_spins_before_yield = 64;
+
+inline void spinWait(uint64_t spins)
+{
+    if (spins < max_spins_before_yield) {
+        cpuRelax();
+    }
+    else {
+        std::this_thread::yield();
+    }
+}
+
 // ======================================
 //  基于C++11 std::atomic_flag 的 自旋锁
 // ======================================
@@ -279,7 +318,9 @@ class SpinLock
 {
 public:
     void lock() {
-        while (this->flag.test_and_set(std::memory_order_acquire)) {}
+        for (uint64_t spins = 0; this->flag.test_and_set(std::memory_order_acquire); spins++) {
+            spinWait(spins);
+        }
     }
 
     void unlock() {
@@ -287,13 +328,292 @@ public:
     }
 
     bool try_lock() {
-        return !flag.test_and_set();
+        return !flag.test_and_set(std::memory_order_acquire);
     }
 
 private:
     std::atomic_flag flag = ATOMIC_FLAG_INIT;
 };
 
+// ======================================
+//  锁的统计策略：不做任何统计（默认）
+//  所有方法都是空的内联函数，不会带来额外的开销
+// ======================================
+struct NoLockStats
+{
+    void onAcquire() {}
+    int64_t beginWait() { return 0; }
+    void endWait(int64_t, uint64_t) {}
+};
+
+// ======================================
+//  锁的统计策略：记录锁的竞争情况
+//  只在持有锁的时候更新，所以只需要 relaxed 的读写
+// ======================================
+class LockStats
+{
+public:
+    void onAcquire() {
+        this->acquisitions.store(this->acquisitions.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // 第一次尝试上锁失败，开始等待
+    int64_t beginWait() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // 等待结束并成功上锁
+    void endWait(int64_t begin, uint64_t spins_) {
+        int64_t wait = this->beginWait() - begin;
+        this->contentions.store(this->contentions.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        this->spins.store(this->spins.load(std::memory_order_relaxed) + spins_, std::memory_order_relaxed);
+        if (wait > this->max_wait_ns.load(std::memory_order_relaxed)) {
+            this->max_wait_ns.store(wait, std::memory_order_relaxed);
+        }
+    }
+
+    // 上锁的次数
+    uint64_t getAcquisitions() const {
+        return this->acquisitions.load(std::memory_order_relaxed);
+    }
+
+    // 第一次尝试上锁失败的次数
+    uint64_t getContentions() const {
+        return this->contentions.load(std::memory_order_relaxed);
+    }
+
+    // 自旋的总次数
+    uint64_t getSpins() const {
+        return this->spins.load(std::memory_order_relaxed);
+    }
+
+    // 最长的等待时间（纳秒）
+    int64_t getMaxWaitNs() const {
+        return this->max_wait_ns.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> acquisitions{0};
+    std::atomic<uint64_t> contentions{0};
+    std::atomic<uint64_t> spins{0};
+    std::atomic<int64_t> max_wait_ns{0};
+};
+
+static const int max_backoff_delay = 1024;      // 最大的退避次数
+
+// =====================================================
+//  test-and-test-and-set 自旋锁，失败后指数退避，退避到上限后让出 cpu
+//  等待时只读取标志位，不会反复写缓存行
+// =====================================================
+template <typename Stats = NoLockStats>
+class TTASLock
+{
+public:
+    void lock() {
+        if (this->try_lock()) {
+            return;
+        }
+        int64_t begin = this->stats.beginWait();
+        uint64_t spins = 0;
+        int delay = 1;
+        do {
+            while (this->locked.load(std::memory_order_relaxed)) {
+                if (delay < max_backoff_delay) {
+                    for (int i = 0; i < delay; i++) {
+                        cpuRelax();
+                    }
+                    delay *= 2;
+                }
+                else {
+                    std::this_thread::yield();
+                }
+                spins += 1;
+            }
+        } while (this->locked.exchange(true, std::memory_order_acquire));
+        this->stats.onAcquire();
+        this->stats.endWait(begin, spins);
+    }
+
+    void unlock() {
+        this->locked.store(false, std::memory_order_release);
+    }
+
+    bool try_lock() {
+        if (!this->locked.load(std::memory_order_relaxed) && !this->locked.exchange(true, std::memory_order_acquire)) {
+            this->stats.onAcquire();
+            return true;
+        }
+        return false;
+    }
+
+    const Stats & getStats() const {
+        return this->stats;
+    }
+
+private:
+    std::atomic<bool> locked{false};
+    Stats stats;
+};
+
+// =====================================================
+//  排号自旋锁，先来先得，等待者之间是公平的
+//  按照前面还有多少人排队成比例地退避，等待太久后让出 cpu
+// =====================================================
+template <typename Stats = NoLockStats>
+class TicketLock
+{
+public:
+    void lock() {
+        uint32_t ticket = this->next_ticket.fetch_add(1, std::memory_order_relaxed);
+        uint32_t serving = this->now_serving.load(std::memory_order_acquire);
+        if (serving == ticket) {
+            this->stats.onAcquire();
+            return;
+        }
+        int64_t begin = this->stats.beginWait();
+        uint64_t spins = 0;
+        while (serving != ticket) {
+            if (spins < max_spins_before_yield) {
+                for (uint32_t i = 0, n = (ticket - serving) * 16; i < n; i++) {
+                    cpuRelax();
+                }
+            }
+            else {
+                std::this_thread::yield();
+            }
+            spins += 1;
+            serving = this->now_serving.load(std::memory_order_acquire);
+        }
+        this->stats.onAcquire();
+        this->stats.endWait(begin, spins);
+    }
+
+    void unlock() {
+        this->now_serving.store(this->now_serving.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool try_lock() {
+        uint32_t serving = this->now_serving.load(std::memory_order_relaxed);
+        uint32_t ticket = serving;
+        if (this->next_ticket.compare_exchange_strong(ticket, serving + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+            this->stats.onAcquire();
+            return true;
+        }
+        return false;
+    }
+
+    const Stats & getStats() const {
+        return this->stats;
+    }
+
+private:
+    std::atomic<uint32_t> next_ticket{0};
+    std::atomic<uint32_t> now_serving{0};
+    Stats stats;
+};
+
+// =====================================================
+//  MCS 队列锁使用的节点，每个等待者只在自己的节点上自旋
+//  节点保存在线程本地的栈中，因此同一个线程最多同时持有 max_mcs_nesting 把 McsLock，
+//  并且要按照上锁的相反顺序解锁
+// =====================================================
+struct McsNode
+{
+    std::atomic<McsNode *> next{nullptr};
+    std::atomic<bool> locked{false};
+};
+
+static const int max_mcs_nesting = 8;
+
+struct McsNodeStack
+{
+    McsNode nodes[max_mcs_nesting];
+    int depth{0};
+};
+
+inline McsNodeStack & mcsNodeStack()
+{
+    static thread_local McsNodeStack stack;
+    return stack;
+}
+
+template <typename Stats = NoLockStats>
+class McsLock
+{
+public:
+    void lock() {
+        McsNode * node = this->pushNode();
+        McsNode * prev = this->tail.exchange(node, std::memory_order_acq_rel);
+        if (prev != nullptr) {
+            int64_t begin = this->stats.beginWait();
+            uint64_t spins = 0;
+            prev->next.store(node, std::memory_order_release);
+            while (node->locked.load(std::memory_order_acquire)) {
+                spinWait(spins++);
+            }
+            this->holder = node;
+            this->stats.onAcquire();
+            this->stats.endWait(begin, spins);
+            return;
+        }
+        this->holder = node;
+        this->stats.onAcquire();
+    }
+
+    void unlock() {
+        McsNode * node = this->holder;
+        McsNode * succ = node->next.load(std::memory_order_acquire);
+        if (succ == nullptr) {
+            McsNode * expected = node;
+            if (this->tail.compare_exchange_strong(expected, nullptr, std::memory_order_release, std::memory_order_relaxed)) {
+                this->popNode();
+                return;
+            }
+            // 有新的等待者正在排队，等它把自己挂到 node->next 上
+            for (uint64_t spins = 0; (succ = node->next.load(std::memory_order_acquire)) == nullptr; spins++) {
+                spinWait(spins);
+            }
+        }
+        succ->locked.store(false, std::memory_order_release);
+        this->popNode();
+    }
+
+    bool try_lock() {
+        McsNode * node = this->pushNode();
+        McsNode * expected = nullptr;
+        if (this->tail.compare_exchange_strong(expected, node, std::memory_order_acquire, std::memory_order_relaxed)) {
+            this->holder = node;
+            this->stats.onAcquire();
+            return true;
+        }
+        this->popNode();
+        return false;
+    }
+
+    const Stats & getStats() const {
+        return this->stats;
+    }
+
+private:
+    McsNode * pushNode() {
+        McsNodeStack & stack = mcsNodeStack();
+        assert(stack.depth < max_mcs_nesting);
+        McsNode * node = &stack.nodes[stack.depth++];
+        node->next.store(nullptr, std::memory_order_relaxed);
+        node->locked.store(true, std::memory_order_relaxed);
+        return node;
+    }
+
+    void popNode() {
+        mcsNodeStack().depth -= 1;
+    }
+
+private:
+    std::atomic<McsNode *> tail{nullptr};
+    McsNode * holder{nullptr};      // 当前持有锁的节点，只会被持有者读写
+    Stats stats;
+};
+
 // =====================================================
 //  使用上面的自旋锁，构建一个类似于 std::lock_guard 的类
 // =====================================================
@@ -316,13 +636,23 @@ private:
 // =====================================================
 //  它是一种安全的任务类型，支持保存不同类型的可运行对象。
 //  它允许用户通过引用(左值或右值)构造一个新的可运行对象。
+//  不超过 safe_task_inline_size 字节、并且移动构造不会抛出异常的可运行对象直接
+//  保存在 SafeTask 内部，不需要分配内存；更大的对象才会在堆上创建
 // =====================================================
+static const size_t safe_task_inline_size = 48;
+
 class SafeTask
 {
 public:
     SafeTask() = default;
-    SafeTask(SafeTask && ohter) = default;
-    ~SafeTask() = default;
+
+    SafeTask(SafeTask && other) noexcept {
+        this->moveFrom(other);
+    }
+
+    ~SafeTask() {
+        this->clear();
+    }
 
     SafeTask(SafeTask & other) = delete;
     SafeTask(const SafeTask &) = delete;
@@ -330,57 +660,123 @@ public:
 
     // 构造一个任务
     template <typename Func, typename = typename std::enable_if<isRunning<Func>::value>::type> 
-    SafeTask(Func && foo) : exe(new GenericExec<Func>(std::forward<Func>(foo))) {}
+    SafeTask(Func && foo) {
+        this->emplace(std::forward<Func>(foo));
+    }
 
     // 重新设置任务
     template <typename Func, typename = typename std::enable_if<isRunning<Func>::value>::type>
     void reset(Func && func) {
-        // unique_ptr::result(new) -- 指向一个新的内存，释放原先的
-        this->exe.reset(new GenericExec<Func>(std::forward<Func>(func)));
+        this->clear();
+        this->emplace(std::forward<Func>(func));
     }
 
     // 是否设置了任务
     bool isSet() {
-        return static_cast<bool>(this->exe);
+        return this->ops != nullptr;
     }
 
     // 重载 ‘=’
-    SafeTask & operator = (SafeTask && other) {
-        this->exe.reset(other.exe.release());
+    SafeTask & operator = (SafeTask && other) noexcept {
+        if (this != &other) {
+            this->clear();
+            this->moveFrom(other);
+        }
         return *this;
     }
 
     // runnable
     void operator () () {
-        this->exe->call();
+        this->ops->call(&this->storage);
     }
 
 private:
-    struct BaseExec {
-        virtual void call() = 0;
-        virtual ~BaseExec() = default;
+    // 手写的虚函数表，每种可运行对象类型一份
+    struct Ops {
+        void (*call)(void *);
+        void (*move)(void * dst, void * src);     // 移动到 dst，并析构 src
+        void (*destroy)(void *);
     };
 
-    template <typename Func, typename T = typename std::decay<Func>::type>
-    struct GenericExec : BaseExec {
-        T foo;
-        
-        GenericExec(Func && func) : foo(std::forward<Func>(func)) {
-            static_assert(!is_reference_wrapper<Func>::value, "[HipeError]: Use 'reference_wrapper' to save temporary variable is dangerous.");
-        }
+    using Storage = typename std::aligned_storage<safe_task_inline_size, alignof(std::max_align_t)>::type;
 
-        ~GenericExec() override = default;
+    template <typename T>
+    struct isInline {
+        static const bool value = sizeof(T) <= sizeof(Storage) && alignof(std::max_align_t) % alignof(T) == 0
+                                  && std::is_nothrow_move_constructible<T>::value;
+    };
 
-        void call() override {
-            foo();
+    // 保存在 storage 中的可运行对象
+    template <typename T>
+    struct InlineExec {
+        static void call(void * p) {
+            (*static_cast<T *>(p))();
+        }
+        static void move(void * dst, void * src) {
+            ::new (dst) T(std::move(*static_cast<T *>(src)));
+            static_cast<T *>(src)->~T();
         }
+        static void destroy(void * p) {
+            static_cast<T *>(p)->~T();
+        }
+        static const Ops ops;
     };
 
+    // 在堆上创建的可运行对象，storage 中保存它的指针
+    template <typename T>
+    struct HeapExec {
+        static void call(void * p) {
+            (**static_cast<T **>(p))();
+        }
+        static void move(void * dst, void * src) {
+            *static_cast<T **>(dst) = *static_cast<T **>(src);
+        }
+        static void destroy(void * p) {
+            delete *static_cast<T **>(p);
+        }
+        static const Ops ops;
+    };
+
+    template <typename Func, typename T = typename std::decay<Func>::type>
+    typename std::enable_if<isInline<T>::value>::type emplace(Func && func) {
+        static_assert(!is_reference_wrapper<Func>::value, "[HipeError]: Use 'reference_wrapper' to save temporary variable is dangerous.");
+        ::new (static_cast<void *>(&this->storage)) T(std::forward<Func>(func));
+        this->ops = &InlineExec<T>::ops;
+    }
+
+    template <typename Func, typename T = typename std::decay<Func>::type>
+    typename std::enable_if<!isInline<T>::value>::type emplace(Func && func) {
+        static_assert(!is_reference_wrapper<Func>::value, "[HipeError]: Use 'reference_wrapper' to save temporary variable is dangerous.");
+        *reinterpret_cast<T **>(&this->storage) = new T(std::forward<Func>(func));
+        this->ops = &HeapExec<T>::ops;
+    }
+
+    void moveFrom(SafeTask & other) {
+        if (other.ops != nullptr) {
+            other.ops->move(&this->storage, &other.storage);
+            this->ops = other.ops;
+            other.ops = nullptr;
+        }
+    }
+
+    void clear() {
+        if (this->ops != nullptr) {
+            this->ops->destroy(&this->storage);
+            this->ops = nullptr;
+        }
+    }
+
 private:
-    // 动态创建，若使用 new GenericExec<Func> 则 exe 指向 GenericExec对象，但是智能调用 BaseExec 的方法
-    std::unique_ptr<BaseExec> exe{nullptr};
+    const Ops * ops{nullptr};
+    Storage storage;
 };
 
+template <typename T>
+const SafeTask::Ops SafeTask::InlineExec<T>::ops = {&SafeTask::InlineExec<T>::call, &SafeTask::InlineExec<T>::move, &SafeTask::InlineExec<T>::destroy};
+
+template <typename T>
+const SafeTask::Ops SafeTask::HeapExec<T>::ops = {&SafeTask::HeapExec<T>::call, &SafeTask::HeapExec<T>::move, &SafeTask::HeapExec<T>::destroy};
+
 // =====================================================
 // 它是一个快速任务，支持保存不同类型的可运行对象。
 // 它允许用户通过引用(左值或右值)来构造它。
@@ -445,6 +841,408 @@ private:
     std::unique_ptr<BaseExec> exe{nullptr};
 };
 
+// =====================================================
+//  环形缓冲区实现的 FIFO 队列，接口和 std::queue 相同
+//  容量是 2 的幂，写满时容量翻倍；提前 reserve() 之后入队出队都不会再分配内存，
+//  swap() 只交换内部的指针
+// =====================================================
+template <typename T>
+class RingBuffer
+{
+public:
+    RingBuffer() = default;
+
+    explicit RingBuffer(size_t capacity) {
+        this->reserve(capacity);
+    }
+
+    RingBuffer(RingBuffer && other) noexcept {
+        this->swap(other);
+    }
+
+    RingBuffer & operator = (RingBuffer && other) noexcept {
+        if (this != &other) {
+            this->release();
+            this->swap(other);
+        }
+        return *this;
+    }
+
+    RingBuffer(const RingBuffer &) = delete;
+    RingBuffer & operator = (const RingBuffer &) = delete;
+
+    ~RingBuffer() {
+        this->release();
+    }
+
+    // 保证至少可以容纳 capacity 个元素
+    void reserve(size_t capacity) {
+        if (capacity > this->capacity()) {
+            size_t cap = 1;
+            while (cap < capacity) {
+                cap <<= 1;
+            }
+            this->relocate(cap);
+        }
+    }
+
+    /**
+     * @brief 释放多余的内存，至少保留 keep 个元素的容量（向上取 2 的幂）
+     * 队列为空并且 keep 为 0 时释放全部内存
+    */
+    void shrinkToFit(size_t keep = 0) {
+        size_t need = std::max(this->count, keep);
+        if (need == 0) {
+            this->release();
+            return;
+        }
+        size_t cap = 1;
+        while (cap < need) {
+            cap <<= 1;
+        }
+        if (cap < this->capacity()) {
+            this->relocate(cap);
+        }
+    }
+
+    size_t capacity() const {
+        return (this->buffer == nullptr) ? 0 : this->mask + 1;
+    }
+
+    // 占用的堆内存
+    size_t memoryBytes() const {
+        return this->capacity() * sizeof(T);
+    }
+
+    template <typename... Args>
+    void emplace(Args&&... args) {
+        if (this->count == this->capacity()) {
+            this->relocate((this->count == 0) ? 8 : this->count * 2);
+        }
+        ::new (static_cast<void *>(this->buffer + ((this->head + this->count) & this->mask))) T(std::forward<Args>(args)...);
+        this->count += 1;
+    }
+
+    void push(T && value) {
+        this->emplace(std::move(value));
+    }
+
+    T & front() {
+        return this->buffer[this->head];
+    }
+
+    T & back() {
+        return this->buffer[(this->head + this->count - 1) & this->mask];
+    }
+
+    void pop() {
+        this->buffer[this->head].~T();
+        this->head = (this->head + 1) & this->mask;
+        this->count -= 1;
+    }
+
+    // 移除队尾元素
+    void popBack() {
+        this->back().~T();
+        this->count -= 1;
+    }
+
+    size_t size() const {
+        return this->count;
+    }
+
+    bool empty() const {
+        return this->count == 0;
+    }
+
+    // 清空队列，保留容量
+    void clear() {
+        while (this->count != 0) {
+            this->pop();
+        }
+        this->head = 0;
+    }
+
+    void swap(RingBuffer & other) noexcept {
+        std::swap(this->buffer, other.buffer);
+        std::swap(this->mask, other.mask);
+        std::swap(this->head, other.head);
+        std::swap(this->count, other.count);
+    }
+
+private:
+    // 把元素移动到容量为 cap 的新内存中，cap 不小于元素的数量
+    void relocate(size_t cap) {
+        T * temp = static_cast<T *>(::operator new(cap * sizeof(T)));
+        for (size_t i = 0; i < this->count; i++) {
+            T & item = this->buffer[(this->head + i) & this->mask];
+            ::new (static_cast<void *>(temp + i)) T(std::move(item));
+            item.~T();
+        }
+        ::operator delete(this->buffer);
+        this->buffer = temp;
+        this->mask = cap - 1;
+        this->head = 0;
+    }
+
+    void release() {
+        this->clear();
+        ::operator delete(this->buffer);
+        this->buffer = nullptr;
+        this->mask = 0;
+        this->head = 0;
+    }
+
+private:
+    T * buffer{nullptr};
+    size_t mask{0};
+    size_t head{0};         // 队首元素的下标
+    size_t count{0};        // 元素的数量
+};
+
+// =====================================================
+//  带截止时间的元素，放入 DeadlineHeap 时按照 deadline 排序
+// =====================================================
+template <typename T>
+struct Deadlined
+{
+    std::chrono::steady_clock::time_point deadline;
+    T value;
+};
+
+// =====================================================
+//  按截止时间排序的队列（最早截止优先，EDF），接口和 std::queue 相同
+//  emplace(Deadlined<T>) 放入带截止时间的元素，其他元素没有截止时间，排在所有
+//  带截止时间的元素之后；截止时间相同的元素按照入队的顺序出队
+// =====================================================
+template <typename T>
+class DeadlineHeap
+{
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    struct Item {
+        TimePoint deadline;
+        uint64_t seq;
+        T value;
+
+        Item(TimePoint deadline, uint64_t seq, T && value) : deadline(deadline), seq(seq), value(std::move(value)) {}
+    };
+
+    // std::push_heap 是大顶堆，截止时间早的元素要排在堆顶
+    struct Later {
+        bool operator () (const Item & a, const Item & b) const {
+            return (a.deadline != b.deadline) ? (a.deadline > b.deadline) : (a.seq > b.seq);
+        }
+    };
+
+public:
+    void reserve(size_t capacity) {
+        this->items.reserve(capacity);
+    }
+
+    size_t capacity() const {
+        return this->items.capacity();
+    }
+
+    /**
+     * @brief 释放多余的内存，至少保留 keep 个元素的容量，堆中元素的顺序不变
+    */
+    void shrinkToFit(size_t keep = 0) {
+        size_t need = std::max(this->items.size(), keep);
+        if (need < this->items.capacity()) {
+            std::vector<Item> temp;
+            temp.reserve(need);
+            for (size_t i = 0; i < this->items.size(); i++) {
+                temp.emplace_back(std::move(this->items[i]));
+            }
+            this->items.swap(temp);
+        }
+    }
+
+    // 占用的堆内存
+    size_t memoryBytes() const {
+        return this->items.capacity() * sizeof(Item);
+    }
+
+    void emplace(Deadlined<T> && item) {
+        this->pushItem(item.deadline, std::move(item.value));
+    }
+
+    template <typename... Args>
+    void emplace(Args&&... args) {
+        this->pushItem(TimePoint::max(), T(std::forward<Args>(args)...));
+    }
+
+    void push(T && value) {
+        this->pushItem(TimePoint::max(), std::move(value));
+    }
+
+    // 截止时间最早的元素
+    T & front() {
+        return this->items.front().value;
+    }
+
+    TimePoint frontDeadline() const {
+        return this->items.front().deadline;
+    }
+
+    void pop() {
+        std::pop_heap(this->items.begin(), this->items.end(), Later());
+        this->items.pop_back();
+    }
+
+    // 把截止时间最早的元素连同它的截止时间一起移动到 other 中
+    void moveFrontTo(DeadlineHeap & other) {
+        other.pushItem(this->frontDeadline(), std::move(this->front()));
+        this->pop();
+    }
+
+    size_t size() const {
+        return this->items.size();
+    }
+
+    bool empty() const {
+        return this->items.empty();
+    }
+
+    // 清空队列，保留容量
+    void clear() {
+        this->items.clear();
+    }
+
+    void swap(DeadlineHeap & other) noexcept {
+        this->items.swap(other.items);
+        std::swap(this->next_seq, other.next_seq);
+    }
+
+private:
+    void pushItem(TimePoint deadline, T && value) {
+        this->items.emplace_back(deadline, this->next_seq++, std::move(value));
+        std::push_heap(this->items.begin(), this->items.end(), Later());
+    }
+
+private:
+    std::vector<Item> items;
+    uint64_t next_seq{0};       // 入队的序号，截止时间相同时先入队的先出队
+};
+
+// =====================================================
+//  有界的多生产者多消费者无锁队列（Dmitry Vyukov 的实现）
+//  每个槽位有一个序号：序号等于入队位置时可以写入，等于入队位置 + 1 时可以读取，
+//  生产者和消费者只在各自的游标上 CAS，不会互相阻塞；队列满 / 空时立刻返回 false
+// =====================================================
+template <typename T>
+class MpmcQueue
+{
+public:
+    explicit MpmcQueue(size_t capacity) {
+        size_t cap = 2;
+        while (cap < capacity) {
+            cap <<= 1;
+        }
+        this->mask = cap - 1;
+        this->cells.reset(new Cell[cap]);
+        for (size_t i = 0; i < cap; i++) {
+            this->cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // 析构时不能再有并发的读写
+    ~MpmcQueue() {
+        size_t tail = this->enqueue_pos.load(std::memory_order_relaxed);
+        for (size_t pos = this->dequeue_pos.load(std::memory_order_relaxed); pos != tail; pos++) {
+            Cell & cell = this->cells[pos & this->mask];
+            if (cell.sequence.load(std::memory_order_relaxed) == pos + 1) {
+                reinterpret_cast<T *>(&cell.storage)->~T();
+            }
+        }
+    }
+
+    MpmcQueue(const MpmcQueue &) = delete;
+    MpmcQueue & operator = (const MpmcQueue &) = delete;
+
+    /**
+     * @return 队列满时返回 false，value 不会被移动
+    */
+    bool tryPush(T && value) {
+        size_t pos = this->enqueue_pos.load(std::memory_order_relaxed);
+        Cell * cell;
+        while (true) {
+            cell = &this->cells[pos & this->mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (this->enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                pos = this->enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        ::new (static_cast<void *>(&cell->storage)) T(std::move(value));
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @return 队列空时返回 false
+    */
+    bool tryPop(T & out) {
+        size_t pos = this->dequeue_pos.load(std::memory_order_relaxed);
+        Cell * cell;
+        while (true) {
+            cell = &this->cells[pos & this->mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (this->dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                pos = this->dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        T * item = reinterpret_cast<T *>(&cell->storage);
+        out = std::move(*item);
+        item->~T();
+        cell->sequence.store(pos + this->mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const {
+        return this->mask + 1;
+    }
+
+    // 并发修改时只是一个近似值
+    size_t sizeApprox() const {
+        size_t tail = this->enqueue_pos.load(std::memory_order_relaxed);
+        size_t head = this->dequeue_pos.load(std::memory_order_relaxed);
+        return (tail > head) ? tail - head : 0;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask{0};
+    char padding0[64];
+    std::atomic<size_t> enqueue_pos{0};
+    char padding1[64];
+    std::atomic<size_t> dequeue_pos{0};
+    char padding2[64];
+};
+
 }   // !! namespace util
 }   // !! namespace myHipe
 
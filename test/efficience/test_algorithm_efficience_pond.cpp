@@ -0,0 +1,100 @@
+#include <iostream>
+#include <numeric>
+#include <random>
+#include "../../include/thread_pond/steady_pond.h"
+#include "../../include/thread_pond/balanced_pond.h"
+#include "../../include/algorithm.h"
+
+using namespace myHipe;
+
+// ==========================================================
+//   对比顺序的 STL 和 algorithm.h 中的并行算法：
+//   排序、前缀和、transform_reduce，以及原来用 submitForReturn + Futures 的写法
+// ==========================================================
+int thread_numb = static_cast<int>(std::max(4u, std::thread::hardware_concurrency()));
+size_t data_size = 10000000;
+
+std::vector<int> makeData() {
+    std::mt19937 rng(2024);
+    std::vector<int> data(data_size);
+    for (size_t i = 0; i < data_size; i++) {
+        data[i] = static_cast<int>(rng() % 1000000);
+    }
+    return data;
+}
+
+void report(const char * name, const char * algo, double seq, double par) {
+    printf("%-9s | %-16s | threads: %-2d | size: %zu | stl: %.5f(s) | parallel: %.5f(s) | speedup: %.2f\n",
+           name, algo, thread_numb, data_size, seq, par, seq / par);
+}
+
+template <typename Pond>
+void test_algorithms(Pond & pond, const char * name, const std::vector<int> & origin) {
+    // 排序
+    std::vector<int> a = origin;
+    std::vector<int> b = origin;
+    double seq = util::timeWait([&] { std::sort(a.begin(), a.end()); });
+    double par = util::timeWait([&] { parallelSort(pond, b.begin(), b.end()); });
+    report(name, "sort", seq, par);
+
+    // 前缀和
+    std::vector<long long> wide(origin.begin(), origin.end());
+    std::vector<long long> out(data_size);
+    seq = util::timeWait([&] { std::partial_sum(wide.begin(), wide.end(), out.begin()); });
+    par = util::timeWait([&] { inclusiveScan(pond, wide.begin(), wide.end(), out.begin()); });
+    report(name, "inclusive scan", seq, par);
+
+    // transform_reduce：平方和
+    auto square = [] (int x) -> long long { return static_cast<long long>(x) * x; };
+    long long r1 = 0;
+    long long r2 = 0;
+    seq = util::timeWait([&] {
+        for (size_t i = 0; i < data_size; i++) {
+            r1 += square(origin[i]);
+        }
+    });
+    par = util::timeWait([&] { r2 = transformReduce(pond, origin.begin(), origin.end(), 0LL, std::plus<long long>(), square); });
+    report(name, "transform reduce", seq, par);
+
+    // 原来的写法：每块一个 submitForReturn，再通过 Futures 取回
+    long long r3 = 0;
+    double futures = util::timeWait([&] {
+        util::Futures<long long> results;
+        size_t block = data_size / (thread_numb * 4);
+        for (size_t begin = 0; begin < data_size; begin += block) {
+            size_t end = std::min(begin + block, data_size);
+            results.push_back(pond.submitForReturn([&origin, &square, begin, end] {
+                long long local = 0;
+                for (size_t i = begin; i < end; i++) {
+                    local += square(origin[i]);
+                }
+                return local;
+            }));
+        }
+        for (long long v : results.get()) {
+            r3 += v;
+        }
+    });
+    report(name, "futures reduce", seq, futures);
+    if (r1 != r2 || r1 != r3 || a != b) {
+        printf("result mismatch!\n");
+    }
+}
+
+int main()
+{
+    util::print("\n", util::title("Test C++(11) Thread Pool Hipe Parallel Algorithms"));
+
+    std::vector<int> origin = makeData();
+    {
+        SteadyThreadPond pond(thread_numb);
+        pond.enableStealTasks(thread_numb - 1);
+        test_algorithms(pond, "steady", origin);
+    }
+    {
+        BalancedThreadPond pond(thread_numb);
+        pond.enableStealTasks(thread_numb - 1);
+        test_algorithms(pond, "balanced", origin);
+    }
+    return 0;
+}
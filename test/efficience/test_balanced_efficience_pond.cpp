@@ -10,11 +10,14 @@ int thread_numb = 4;
 int batch_size = 10;
 int min_task_numb = 100;
 int max_task_numb = 100000000;
-void test_Hipe_Balance_batch_submit() {
+
+// load_batch: 线程每次加锁最多加载的任务数量，1 表示每次只加载一个任务（原来的行为）
+void test_Hipe_Balance_batch_submit(int load_batch) {
     util::print("\n", util::title("Test C++(11) Thread Pool Hipe-Balance-Batch-Submit(10)"));
 
 //   BalancedThreadPond pond(thread_numb, thread_numb * 1000);
     BalancedThreadPond pond(thread_numb);
+    pond.setLoadBatch(load_batch);
     std::vector<util::SafeTask> tasks;
     tasks.reserve(batch_size);
 
@@ -31,12 +34,66 @@ void test_Hipe_Balance_batch_submit() {
 
     for (int nums = min_task_numb; nums <= max_task_numb; nums *= 10) {
         double time_cost = util::timeWait(foo, nums);
-        printf("threads: %-2d | task-type: empty task | task-numb: %-9d | time-cost: %.5f(s)\n", thread_numb, nums, time_cost);
+        printf("threads: %-2d | load-batch: %-2d | task-type: empty task | task-numb: %-9d | time-cost: %.5f(s)\n", thread_numb, load_batch, nums, time_cost);
     }
 }
+
+void test_Hipe_Balance_submit(int load_batch) {
+    util::print("\n", util::title("Test C++(11) Thread Pool Hipe-Balance-Submit"));
+
+    BalancedThreadPond pond(thread_numb);
+    pond.setLoadBatch(load_batch);
+
+    auto foo = [&](int task_numb) {
+        for (int i = 0; i < task_numb; i++) {
+            pond.submit([] {});
+        }
+        pond.waitForTasks();
+    };
+
+    for (int nums = min_task_numb; nums <= max_task_numb / 10; nums *= 10) {
+        double time_cost = util::timeWait(foo, nums);
+        printf("threads: %-2d | load-batch: %-2d | task-type: empty task | task-numb: %-9d | time-cost: %.5f(s)\n", thread_numb, load_batch, nums, time_cost);
+    }
+}
+
+// 倾斜的任务流：每次批量提交 64 个任务，第一个运行 2 毫秒，其余任务运行约 20 微秒，
+// 开启窃取。批量加载时长任务之后的任务在缓冲区中，空闲的线程要能从缓冲区的队尾取走它们
+void test_Hipe_Balance_skewed(int load_batch) {
+    util::print("\n", util::title("Test C++(11) Thread Pool Hipe-Balance-Skewed"));
+
+    BalancedThreadPond pond(thread_numb);
+    pond.setLoadBatch(load_batch);
+    pond.enableStealTasks(thread_numb - 1);
+    std::vector<util::SafeTask> tasks;
+    tasks.reserve(64);
+
+    auto foo = [&](int task_numb) {
+        for (int i = 0; i < task_numb; i += 64) {
+            tasks.emplace_back([] { util::sleep_for_microseconds(2000); });
+            for (int j = 1; j < 64; j++) {
+                tasks.emplace_back([] { util::sleep_for_microseconds(20); });
+            }
+            pond.submitInBatch(tasks, tasks.size());
+            tasks.clear();
+            pond.waitForTasks();
+        }
+    };
+
+    for (int nums = 640; nums <= 6400; nums *= 10) {
+        double time_cost = util::timeWait(foo, nums);
+        printf("threads: %-2d | load-batch: %-2d | task-type: skewed task | task-numb: %-9d | time-cost: %.5f(s)\n", thread_numb, load_batch, nums, time_cost);
+    }
+}
+
 int main() 
 {
-    test_Hipe_Balance_batch_submit();
+    test_Hipe_Balance_batch_submit(1);
+    test_Hipe_Balance_batch_submit(max_load_batch);
+    test_Hipe_Balance_submit(1);
+    test_Hipe_Balance_submit(max_load_batch);
+    test_Hipe_Balance_skewed(1);
+    test_Hipe_Balance_skewed(max_load_batch);
 
     return 0;
-}
\ No newline at end of file
+}
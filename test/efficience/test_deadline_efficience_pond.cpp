@@ -0,0 +1,84 @@
+#include <iostream>
+#include "../../include/thread_pond/steady_pond.h"
+#include "../../include/thread_pond/balanced_pond.h"
+
+using namespace myHipe;
+
+// ==========================================
+//   过载时的截止时间错过率：FIFO vs 最早截止优先（EDF）
+//   生产者每毫秒提交一轮任务：前 burst_rounds 轮的任务量是线程池处理能力的
+//   overload 倍，之后的轮次降到 calm 倍，让积压的任务慢慢消化。
+//   其中 tight_percent% 的任务截止时间很紧，其余的任务截止时间宽松
+// ==========================================
+int thread_numb = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+int work_us = 50;               // 每个任务忙等的时间
+int rounds = 200;               // 提交的轮数，每轮 1ms
+int burst_rounds = 100;         // 过载的轮数
+double overload = 1.3;          // 过载时提交的任务量 / 处理能力
+double calm = 0.5;              // 过载之后提交的任务量 / 处理能力
+int tight_percent = 30;
+int tight_ms = 2;               // 紧的截止时间
+int relaxed_ms = 50;            // 宽松的截止时间
+
+void busyWork(int micro) {
+    auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(micro);
+    while (std::chrono::steady_clock::now() < end) {}
+}
+
+template <typename Pond>
+void test_deadline(const char * name) {
+    Pond pond(thread_numb);
+    if (thread_numb > 1) {
+        pond.enableStealTasks(thread_numb - 1);
+    }
+
+    std::atomic<int> missed[2];
+    missed[0] = 0;
+    missed[1] = 0;
+    int total[2] = {0, 0};
+
+    int capacity = thread_numb * 1000 / work_us;        // 每毫秒可以处理的任务数量
+    uint32_t seed = 2024;
+    auto next = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        int per_round = static_cast<int>(capacity * ((r < burst_rounds) ? overload : calm));
+        for (int i = 0; i < per_round; i++) {
+            seed = seed * 1103515245u + 12345u;
+            int tight = ((seed >> 16) % 100 < static_cast<uint32_t>(tight_percent)) ? 1 : 0;
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(tight ? tight_ms : relaxed_ms);
+            total[tight] += 1;
+            std::atomic<int> * miss = &missed[tight];
+            pond.submitBefore(deadline, [deadline, miss] {
+                busyWork(work_us);
+                if (std::chrono::steady_clock::now() > deadline) {
+                    miss->fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+        }
+        next += std::chrono::milliseconds(1);
+        std::this_thread::sleep_until(next);
+    }
+    pond.waitForTasks();
+
+    auto rate = [] (int m, int t) -> double { return (t == 0) ? 0.0 : 100.0 * m / t; };
+    printf("%-22s | threads: %-2d | tasks: %-6d | miss-rate: %6.2f%% | tight: %6.2f%% | relaxed: %6.2f%%\n",
+           name, thread_numb, total[0] + total[1], rate(missed[0] + missed[1], total[0] + total[1]),
+           rate(missed[1], total[1]), rate(missed[0], total[0]));
+}
+
+int main()
+{
+    util::print("\n", util::title("Test C++(11) Thread Pool Hipe Deadline Miss Rate"));
+    printf("work: %dus | overload: %.2f x %dms, then %.2f | tight: %d%% within %dms | relaxed: within %dms\n",
+           work_us, overload, burst_rounds, calm, tight_percent, tight_ms, relaxed_ms);
+
+    using EdfPolicy = PondPolicy<util::SpinLock, util::DeadlineQueue>;
+    using EdfMutexPolicy = PondPolicy<std::mutex, util::DeadlineQueue>;
+
+    test_deadline<SteadyThreadPond>("steady   fifo");
+    test_deadline<BasicSteadyThreadPond<EdfPolicy>>("steady   edf");
+    test_deadline<BalancedThreadPond>("balanced fifo");
+    test_deadline<BasicBalancedThreadPond<EdfMutexPolicy>>("balanced edf");
+
+    return 0;
+}
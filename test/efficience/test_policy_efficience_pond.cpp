@@ -0,0 +1,66 @@
+#include "../../include/thread_pond/steady_pond.h"
+#include "../../include/thread_pond/balanced_pond.h"
+
+using namespace myHipe;
+
+// ==========================================
+//   测试不同策略组合下线程池的性能
+// ==========================================
+int thread_numb = 4;
+int batch_size = 10;
+int min_task_numb = 1000;
+int max_task_numb = 1000000;
+
+template <typename Pond>
+void test_policy(const char * name) {
+    Pond pond(thread_numb);
+    std::vector<util::SafeTask> tasks;
+    tasks.reserve(batch_size);
+
+    auto foo = [&](int task_numb) {
+        for (int i = 0; i < task_numb;) {
+            for (int j = 0; j < batch_size; ++j, ++i) {
+                tasks.emplace_back([] {});
+            }
+            pond.submitInBatch(tasks, batch_size);
+            tasks.clear();
+        }
+        pond.waitForTasks();
+    };
+
+    for (int nums = min_task_numb; nums <= max_task_numb; nums *= 10) {
+        double time_cost = util::timeWait(foo, nums);
+        printf("%-48s | threads: %-2d | task-numb: %-9d | time-cost: %.5f(s)\n", name, thread_numb, nums, time_cost);
+    }
+}
+
+int main()
+{
+    util::print("\n", util::title("Test C++(11) Thread Pool Hipe Policies"));
+
+    using util::SpinLock;
+    using util::DequeQueue;
+    using util::ListQueue;
+    using util::YieldIdle;
+    using util::SpinIdle;
+    using util::SleepIdle;
+    using util::CountWorkerStats;
+    using util::NoWorkerStats;
+
+    // 锁 x 空闲等待
+    test_policy<BasicSteadyThreadPond<PondPolicy<SpinLock, DequeQueue, YieldIdle>>>("steady  spinlock   deque  yield  count(default)");
+    test_policy<BasicSteadyThreadPond<PondPolicy<SpinLock, DequeQueue, SpinIdle>>>("steady  spinlock   deque  spin   count");
+    test_policy<BasicSteadyThreadPond<PondPolicy<SpinLock, DequeQueue, SleepIdle<50>>>>("steady  spinlock   deque  sleep  count");
+    test_policy<BasicSteadyThreadPond<PondPolicy<std::mutex, DequeQueue, YieldIdle>>>("steady  mutex      deque  yield  count");
+    test_policy<BasicSteadyThreadPond<PondPolicy<util::TicketLock<>, DequeQueue, YieldIdle>>>("steady  ticket     deque  yield  count");
+
+    // 队列 x 统计
+    test_policy<BasicSteadyThreadPond<PondPolicy<SpinLock, ListQueue, YieldIdle>>>("steady  spinlock   list   yield  count");
+    test_policy<BasicSteadyThreadPond<PondPolicy<SpinLock, DequeQueue, YieldIdle, NoWorkerStats>>>("steady  spinlock   deque  yield  none");
+
+    test_policy<BasicBalancedThreadPond<PondPolicy<std::mutex, DequeQueue, YieldIdle>>>("balanced mutex     deque  yield  count(default)");
+    test_policy<BasicBalancedThreadPond<PondPolicy<SpinLock, DequeQueue, YieldIdle>>>("balanced spinlock  deque  yield  count");
+    test_policy<BasicBalancedThreadPond<PondPolicy<SpinLock, DequeQueue, SpinIdle, NoWorkerStats>>>("balanced spinlock  deque  spin   none");
+
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include "../../include/thread_pond/steady_pond.h"
+#include "../../include/thread_pond/balanced_pond.h"
+#include "../../include/thread_pond/dynamic_pond.h"
+
+using namespace myHipe;
+
+// ==========================================================
+//   对比 submitInBatch(每个下标一个任务) 和 submitRange 的性能
+// ==========================================================
+int thread_numb = 4;
+int min_task_numb = 1000;
+int max_task_numb = 10000000;
+
+std::vector<int> data(max_task_numb, 1);
+
+template <typename Pond>
+void test_batch(Pond & pond, const char * name) {
+    std::vector<util::SafeTask> tasks;
+
+    auto foo = [&](int task_numb) {
+        tasks.reserve(task_numb);
+        for (int i = 0; i < task_numb; i++) {
+            tasks.emplace_back([i] { data[i] += 1; });
+        }
+        pond.submitInBatch(tasks, tasks.size());
+        tasks.clear();
+        pond.waitForTasks();
+    };
+
+    for (int nums = min_task_numb; nums <= max_task_numb; nums *= 10) {
+        double time_cost = util::timeWait(foo, nums);
+        printf("%-9s | submitInBatch | threads: %-2d | index-numb: %-9d | time-cost: %.5f(s)\n", name, thread_numb, nums, time_cost);
+    }
+}
+
+template <typename Pond>
+void test_range(Pond & pond, const char * name) {
+    auto foo = [&](int task_numb) {
+        pond.submitRange(static_cast<size_t>(task_numb), [] (size_t i) { data[i] += 1; });
+        pond.waitForTasks();
+    };
+
+    for (int nums = min_task_numb; nums <= max_task_numb; nums *= 10) {
+        double time_cost = util::timeWait(foo, nums);
+        printf("%-9s | submitRange   | threads: %-2d | index-numb: %-9d | time-cost: %.5f(s)\n", name, thread_numb, nums, time_cost);
+    }
+}
+
+int main()
+{
+    util::print("\n", util::title("Test C++(11) Thread Pool Hipe-SubmitRange"));
+
+    {
+        SteadyThreadPond pond(thread_numb);
+        pond.enableStealTasks(thread_numb - 1);
+        test_batch(pond, "steady");
+        test_range(pond, "steady");
+    }
+    {
+        BalancedThreadPond pond(thread_numb);
+        test_batch(pond, "balanced");
+        test_range(pond, "balanced");
+    }
+    {
+        DynamicThreadPond pond(thread_numb);
+        test_batch(pond, "dynamic");
+        test_range(pond, "dynamic");
+    }
+
+    return 0;
+}
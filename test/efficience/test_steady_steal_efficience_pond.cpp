@@ -0,0 +1,96 @@
+#include "../../include/thread_pond/steady_pond.h"
+
+using namespace myHipe;
+
+// ==========================================
+//   测试不均衡任务流下不同窃取比例、不同窃取顺序的性能
+// ==========================================
+int thread_numb = 4;
+int batch_size = 100;
+int min_task_numb = 1000;
+int max_task_numb = 100000;
+
+// 忙等 us 微秒，模拟计算任务
+void busyWork(int us) {
+    auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+    while (std::chrono::steady_clock::now() < end) {}
+}
+
+void test_Hipe_steady_steal_ratio(double ratio) {
+    SteadyThreadPond pond(thread_numb);
+    pond.enableStealTasks(thread_numb - 1);
+    pond.setStealRatio(ratio);
+
+    std::vector<util::SafeTask> tasks;
+    tasks.reserve(batch_size);
+
+    // 每一批任务都会交给同一个线程，且每 4 批中只有 1 批是重任务，造成线程之间负载不均衡
+    auto foo = [&](int task_numb) {
+        for (int i = 0, batch = 0; i < task_numb; batch++) {
+            int cost = (batch % 4 == 0) ? 20 : 1;
+            for (int j = 0; j < batch_size; ++j, ++i) {
+                tasks.emplace_back([cost] { busyWork(cost); });
+            }
+            pond.submitInBatch(tasks, batch_size);
+            tasks.clear();
+        }
+        pond.waitForTasks();
+    };
+
+    for (int nums = min_task_numb; nums <= max_task_numb; nums *= 10) {
+        double time_cost = util::timeWait(foo, nums);
+        printf("threads: %-2d | steal-ratio: %.2f | task-type: imbalanced | task-numb: %-9d | time-cost: %.5f(s)\n",
+               thread_numb, ratio, nums, time_cost);
+    }
+}
+
+// 每次只尝试一半的线程，比较不同窃取顺序的耗时和窃取的成功率
+void test_Hipe_steady_steal_order(StealOrder order, const char * name) {
+    SteadyThreadPond pond(thread_numb);
+    pond.enableStealTasks(std::max(thread_numb / 2, 1));
+    pond.setStealOrder(order);
+
+    std::vector<util::SafeTask> tasks;
+    tasks.reserve(batch_size);
+
+    auto foo = [&](int task_numb) {
+        for (int i = 0, batch = 0; i < task_numb; batch++) {
+            int cost = (batch % 4 == 0) ? 20 : 1;
+            for (int j = 0; j < batch_size; ++j, ++i) {
+                tasks.emplace_back([cost] { busyWork(cost); });
+            }
+            pond.submitInBatch(tasks, batch_size);
+            tasks.clear();
+        }
+        pond.waitForTasks();
+    };
+
+    double time_cost = util::timeWait(foo, max_task_numb);
+    util::PondStats stats = pond.stats();
+    uint64_t attempted = 0, succeeded = 0, remote = 0;
+    for (size_t i = 0; i < stats.workers.size(); i++) {
+        attempted += stats.workers[i].steals_attempted;
+        succeeded += stats.workers[i].steals_succeeded;
+        remote += stats.workers[i].steals_remote;
+    }
+    printf("threads: %-2d | steal-order: %-8s | task-numb: %-9d | time-cost: %.5f(s) | steals: %llu/%llu (%.2f%%) | remote: %llu\n",
+           thread_numb, name, max_task_numb, time_cost, (unsigned long long)succeeded, (unsigned long long)attempted,
+           (attempted == 0) ? 0.0 : 100.0 * static_cast<double>(succeeded) / static_cast<double>(attempted), (unsigned long long)remote);
+}
+
+int main()
+{
+    util::print("\n", util::title("Test C++(11) Thread Pool Hipe-Steady-Steal-Ratio"));
+
+    test_Hipe_steady_steal_ratio(1.0);      // 旧的行为：窃取全部任务
+    test_Hipe_steady_steal_ratio(0.5);
+    test_Hipe_steady_steal_ratio(0.25);
+
+    const util::CpuTopology & topology = util::CpuTopology::get();
+    printf("\ntopology: %s\n", topology.known() ? "read from sysfs" : "unknown, topology order falls back to random");
+    test_Hipe_steady_steal_order(StealOrder::Linear, "linear");
+    test_Hipe_steady_steal_order(StealOrder::Random, "random");
+    test_Hipe_steady_steal_order(StealOrder::Topology, "topology");
+
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include "../../include/thread_pond/steady_pond.h"
+#include "../../include/thread_pond/typed_pond.h"
+
+using namespace myHipe;
+
+// ================================================================
+//   对比同一种任务在 SteadyThreadPond(SafeTask) 和 TypedSteadyPond 中的性能
+// ================================================================
+int thread_numb = 4;
+int batch_size = 10;
+int min_task_numb = 100;
+int max_task_numb = 10000000;
+
+std::atomic<long long> sink(0);
+
+// 一个很小的任务，任务本身的开销越小，类型擦除的开销占比越大
+struct AddTask
+{
+    int value;
+    void operator()() const {
+        sink.fetch_add(this->value, std::memory_order_relaxed);
+    }
+};
+
+template <typename Pond, typename Task>
+void bench(const char * name) {
+    Pond pond(thread_numb);
+    std::vector<Task> tasks;
+    tasks.reserve(batch_size);
+
+    auto foo = [&](int task_numb) {
+        for (int i = 0; i < task_numb;) {
+            for (int j = 0; j < batch_size; ++j, ++i) {
+                tasks.emplace_back(AddTask{1});
+            }
+            pond.submitInBatch(tasks, batch_size);
+            tasks.clear();
+        }
+        pond.waitForTasks();
+    };
+
+    for (int nums = min_task_numb; nums <= max_task_numb; nums *= 10) {
+        double time_cost = util::timeWait(foo, nums);
+        printf("%-6s | threads: %-2d | task-type: small functor | task-numb: %-9d | time-cost: %.5f(s)\n",
+               name, thread_numb, nums, time_cost);
+    }
+}
+
+int main()
+{
+    util::print("\n", util::title("Test C++(11) Thread Pool Hipe-Steady vs Hipe-Typed"));
+
+    bench<SteadyThreadPond, util::SafeTask>("erased");
+    bench<TypedSteadyPond<AddTask>, AddTask>("typed");
+
+    return 0;
+}
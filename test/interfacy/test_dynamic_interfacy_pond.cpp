@@ -112,6 +112,28 @@ void test_motify_thread_numb(myHipe::DynamicThreadPond & pond)
     stream.print("thread-numb now: ", pond.getRunningThreadNumb());
 }
 
+void test_keep_alive(myHipe::DynamicThreadPond & pond)
+{
+    stream.print("\n", myHipe::util::boundary('=', 13), myHipe::util::strong("keep alive"), myHipe::util::boundary('=', 13));
+
+    // 保留 1 个核心线程，其余线程空闲 50ms 后自己退出
+    pond.setKeepAlive(1, std::chrono::milliseconds(50));
+    pond.adjustThreads(4);
+    pond.waitForThreads();
+    stream.print("thread-numb before idle = ", pond.getRunningThreadNumb());
+
+    for (int i = 0; i < 8; i++) {
+        pond.submit([] () -> void { myHipe::util::sleep_for_milliseconds(10); });
+    }
+    pond.waitForTasks();
+
+    // 退出的线程会被自动回收，不需要调用 joinDeadThreads()
+    myHipe::util::sleep_for_milliseconds(300);
+    stream.print("thread-numb after idle = ", pond.getRunningThreadNumb());
+    stream.print("core-thread-numb = ", pond.getCoreThreadNumb());
+    pond.setKeepAlive(0, std::chrono::milliseconds(0));
+}
+
 int main(int argc, char * args[])
 {
     stream.print(myHipe::util::title("Test DynamicThreadPond", 10));
@@ -135,5 +157,6 @@ int main(int argc, char * args[])
     // test_submit_task(pond);
     // test_submit_in_batch(pond);
     test_motify_thread_numb(pond);
+    test_keep_alive(pond);
     return 0;
 }
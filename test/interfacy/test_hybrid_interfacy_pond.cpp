@@ -0,0 +1,73 @@
+#include "../../include/thread_pond/hybrid_pond.h"
+
+using namespace myHipe;
+
+util::SyncStream stream;
+
+void test_submit(HybridPond & pond)
+{
+    stream.print("\n", util::boundary('=', 15), util::strong("submit"), util::boundary('=', 16));
+
+    std::atomic<int> var(0);
+
+    // 核心线程池的容量是 40，多出来的任务会溢出到溢出线程池
+    for (int i = 0; i < 100; i++) {
+        pond.submit([&] () -> void {
+            util::sleep_for_milliseconds(5);
+            var++;
+        });
+    }
+
+    // 若需要返回值
+    auto ret = pond.submitForReturn([] () -> int { return 2023; });
+    stream.print("return = ", ret.get());
+
+    pond.waitForTasks();
+    stream.print("task done = ", var.load());
+    stream.print("overflow thread numb = ", pond.getOverflowThreadNumb());
+}
+
+void test_submit_in_batch(HybridPond & pond)
+{
+    stream.print("\n", util::boundary('=', 11), util::strong("submit in batch"), util::boundary('=', 11));
+
+    std::atomic<int> var(0);
+    std::vector<util::SafeTask> vec;
+    for (int i = 0; i < 100; i++) {
+        vec.emplace_back([&] () -> void {
+            util::sleep_for_milliseconds(5);
+            var++;
+        });
+    }
+    pond.submitInBatch(vec, vec.size());
+    pond.waitForTasks();
+    stream.print("task done = ", var.load());
+}
+
+void test_spill_report(HybridPond & pond)
+{
+    stream.print("\n", util::boundary('=', 12), util::strong("spill report"), util::boundary('=', 12));
+
+    stream.print("submitted tasks = ", pond.getSubmittedTasks());
+    stream.print("spilled tasks = ", pond.getSpilledTasks());
+    stream.print("spill ratio = ", pond.getSpillRatio());
+
+    // 溢出线程池的线程空闲超过 keep alive 之后会自己退出
+    util::sleep_for_milliseconds(50);
+    pond.getOverflowPond().joinDeadThreads();
+    stream.print("overflow thread numb after idle = ", pond.getOverflowThreadNumb());
+}
+
+int main(int argc, char * argv[])
+{
+    // 4 个核心线程，核心任务容量 40，溢出线程池最多 8 个线程
+    HybridPond pond(4, 40, 8);
+    pond.setSpillTasksPerThread(8);
+    pond.setOverflowKeepAlive(std::chrono::milliseconds(10));
+
+    test_submit(pond);
+    test_submit_in_batch(pond);
+    test_spill_report(pond);
+
+    return 0;
+}
@@ -69,6 +69,23 @@ void test_submit_in_batch(SteadyThreadPond & pond)
     }, 10);
 }
 
+void test_submit_range(SteadyThreadPond & pond)
+{
+    stream.print("\n", util::boundary('=', 12), util::strong("submit range"), util::boundary('=', 12));
+
+    // 对 [0, n) 中的每个下标调用一次，只会提交 min(线程数量, 区间块数) 个任务
+    const size_t n = 100000;
+    std::vector<int> data(n, 0);
+    pond.submitRange(n, [&data] (size_t i) { data[i] = static_cast<int>(i % 10); });
+    pond.waitForTasks();
+
+    long long sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += data[i];
+    }
+    stream.print("sum = ", sum, " (expect ", 45 * static_cast<long long>(n / 10), ")");
+}
+
 void test_task_overflow() 
 {
     stream.print("\n", util::boundary('=', 11), util::strong("task overflow"), util::boundary('=', 13));
@@ -112,6 +129,8 @@ int main(int argc, char * argv[])
 
     test_submit(pond);
     test_submit_in_batch(pond);
+    pond.waitForTasks();
+    test_submit_range(pond);
     test_task_overflow();
     test_other_interface(pond, 8);
 
@@ -0,0 +1,121 @@
+#include <cstdlib>
+#include <new>
+#include "../include/thread_pond/steady_pond.h"
+#include "../include/thread_pond/balanced_pond.h"
+
+using namespace myHipe;
+
+// ==================================================
+//   统计全局的内存分配次数，验证有界线程池在预热之后
+//   提交和执行任务都不会再分配内存
+// ==================================================
+static std::atomic<long long> alloc_count(0);
+
+void * operator new(std::size_t size)
+{
+    alloc_count.fetch_add(1, std::memory_order_relaxed);
+    void * p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void * operator new[](std::size_t size)
+{
+    return ::operator new(size);
+}
+
+void operator delete(void * p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void * p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void * p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void * p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+std::atomic<long long> sum(0);
+const int capacity = 4000;
+const int rounds = 20;
+const int batch_size = 100;
+
+template <typename Pond>
+long long submitRounds(Pond & pond, std::vector<util::SafeTask> & batch)
+{
+    long long before = alloc_count.load();
+    for (int r = 0; r < rounds; r++) {
+        // 单个提交，任务捕获了 32 个字节，可以直接保存在 SafeTask 中
+        for (int i = 0; i < capacity / 4; i++) {
+            long long a = i, b = r, c = 1, d = 2;
+            pond.submit([a, b, c, d] () { sum.fetch_add(a + b + c + d, std::memory_order_relaxed); });
+        }
+        // 批量提交，batch 的容量在预热之前已经分配好了
+        for (int i = 0; i < batch_size; i++) {
+            batch.emplace_back([i] () { sum.fetch_add(i, std::memory_order_relaxed); });
+        }
+        pond.submitInBatch(batch, batch.size());
+        batch.clear();
+        pond.waitForTasks();
+    }
+    return alloc_count.load() - before;
+}
+
+template <typename Pond>
+bool checkPond(const char * name)
+{
+    Pond pond(4, capacity);
+    // 溢出的任务在提交任务的线程中直接执行
+    pond.setRefuseCallBack([&pond] () {
+        std::vector<util::SafeTask> & tasks = pond.pullOverFlowTasks();
+        for (size_t i = 0; i < tasks.size(); i++) {
+            tasks[i]();
+        }
+    });
+
+    std::vector<util::SafeTask> batch;
+    batch.reserve(batch_size);
+
+    long long warm = submitRounds(pond, batch);     // 预热
+    long long steady = submitRounds(pond, batch);
+
+    // 回收多余的内存之后仍然保留每个线程的任务容量
+    pond.shrinkToFit();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    long long shrunk = submitRounds(pond, batch);
+    printf("%-10s | allocations while warming up: %-6lld | allocations after warm-up: %-4lld | after shrinkToFit: %lld\n",
+           name, warm, steady, shrunk);
+    return steady == 0 && shrunk == 0;
+}
+
+int main()
+{
+    util::print(util::title("Test allocations of bounded ponds"));
+
+    bool ok = true;
+    ok = checkPond<SteadyThreadPond>("steady") && ok;
+    ok = checkPond<BalancedThreadPond>("balanced") && ok;
+
+    // 超过 safe_task_inline_size 的任务仍然会在堆上创建
+    long long before = alloc_count.load();
+    {
+        char big[128] = {0};
+        util::SafeTask task([big] () { (void)big; });
+        task();
+    }
+    printf("a task with 128 bytes of captures allocates %lld time(s)\n", alloc_count.load() - before);
+
+    util::print(ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,92 @@
+#include "../include/myHipe.h"
+
+using namespace myHipe;
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <fcntl.h>
+
+// ==================================================
+//   检查 AsyncIo（io_uring 和线程两种后端）：
+//   1. 并发写入多个块，fsync 之后读回的数据和写入的相同
+//   2. 回调都在线程池的工作线程中执行
+//   3. 错误通过 -errno 返回
+//   4. 超过 entries 的操作排队，在工作线程中提交大量操作不会阻塞
+// ==================================================
+const int block_numb = 64;
+const size_t block_size = 4096;
+
+bool checkBackend(IoBackend backend, const char * name)
+{
+    char path[] = "/tmp/hipe_async_io_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return false;
+    }
+    unlink(path);
+
+    SteadyThreadPond pond(4);
+    std::vector<std::vector<char>> blocks(block_numb, std::vector<char>(block_size));
+    std::vector<std::vector<char>> reads(block_numb, std::vector<char>(block_size, 0));
+    std::atomic<int> failures{0};
+    std::atomic<int> off_worker{0};
+    bool uring = false;
+    int bad_fd_result = 0;
+    {
+        AsyncIo<SteadyThreadPond> io(pond, 2, backend);
+        uring = io.usingUring();
+
+        for (int i = 0; i < block_numb; i++) {
+            std::fill(blocks[i].begin(), blocks[i].end(), static_cast<char>('a' + i % 26));
+            io.write(fd, blocks[i].data(), block_size, static_cast<off_t>(i * block_size), [&, i] (ssize_t n) {
+                failures += (n == static_cast<ssize_t>(block_size)) ? 0 : 1;
+                off_worker += pond.isWorkerThread() ? 0 : 1;
+            });
+        }
+        io.wait();
+        io.fsync(fd, [&] (ssize_t n) {
+            failures += (n == 0) ? 0 : 1;
+        });
+        io.wait();
+        pond.submit([&] {
+            for (int i = 0; i < block_numb; i++) {
+                io.read(fd, reads[i].data(), block_size, static_cast<off_t>(i * block_size), [&] (ssize_t n) {
+                    failures += (n == static_cast<ssize_t>(block_size)) ? 0 : 1;
+                    off_worker += pond.isWorkerThread() ? 0 : 1;
+                });
+            }
+        });
+        pond.waitForTasks();
+        io.read(-1, reads[0].data(), 1, 0, [&bad_fd_result] (ssize_t n) {
+            bad_fd_result = static_cast<int>(n);
+        });
+        io.wait();
+    }
+    close(fd);
+
+    bool same = (reads == blocks);
+    printf("%-8s | io_uring: %-3s | failures: %d | callbacks off the pond: %d | data matches: %s | bad fd: %s\n",
+           name, uring ? "yes" : "no", failures.load(), off_worker.load(), same ? "yes" : "no", std::strerror(-bad_fd_result));
+    return failures.load() == 0 && off_worker.load() == 0 && same && bad_fd_result == -EBADF;
+}
+
+int main()
+{
+    util::print(util::title("Test async io"));
+
+    bool ok = checkBackend(IoBackend::Auto, "auto");
+    ok = checkBackend(IoBackend::Threads, "threads") && ok;
+
+    util::print(ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+#else
+
+int main()
+{
+    util::print("AsyncIo is only available on POSIX systems");
+    return 0;
+}
+
+#endif
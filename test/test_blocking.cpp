@@ -0,0 +1,115 @@
+#include <chrono>
+#include <thread>
+#include "../include/myHipe.h"
+
+using namespace myHipe;
+
+// ==================================================
+//   阻塞的任务：BlockingScope 和看门狗创建的补偿线程
+//   执行被卡住的线程的任务，否则这些任务要等阻塞结束
+// ==================================================
+const int follow_tasks = 100;
+
+// 等待 count 达到 target，最多等 seconds 秒
+bool waitUntil(std::atomic<int> & count, int target, int seconds)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+    while (count.load() < target) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+// 0 号线程的第一个任务在 BlockingScope 中等待排在它后面的任务全部执行完
+template <typename Pond>
+bool testScope(const char * name)
+{
+    Pond pond(2);
+    std::atomic<int> count(0);
+    std::atomic<bool> done(false);
+
+    std::vector<util::SafeTask> tasks;
+    tasks.emplace_back([&] () {
+        done = blocking([&] () { return waitUntil(count, follow_tasks, 5); });
+    });
+    for (int i = 0; i < follow_tasks; i++) {
+        tasks.emplace_back([&count] () { count += 1; });
+    }
+    pond.submitInBatchTo(0, tasks, tasks.size());
+    pond.waitForTasks();
+
+    util::BlockingStats stats = pond.blockingStats();
+    printf("%-10s | scope: done = %d | scopes = %llu | compensations = %llu | blocked %.3f s\n", name, done.load(),
+           static_cast<unsigned long long>(stats.scopes), static_cast<unsigned long long>(stats.compensations), stats.blocked_seconds);
+    return done && count == follow_tasks && stats.scopes == 1 && stats.compensations >= 1 && stats.blocked_seconds > 0;
+}
+
+// 没有标记的阻塞：看门狗发现 0 号线程卡住之后创建补偿线程
+template <typename Pond>
+bool testWatchdog(const char * name)
+{
+    Pond pond(2);
+    pond.enableBlockingWatchdog(std::chrono::milliseconds(20));
+    std::atomic<int> count(0);
+    std::atomic<bool> started(false), done(false);
+
+    std::vector<util::SafeTask> first;
+    first.emplace_back([&] () {
+        started = true;
+        done = waitUntil(count, follow_tasks, 5);
+    });
+    pond.submitInBatchTo(0, first, 1);
+    while (!started) {
+        std::this_thread::yield();
+    }
+
+    std::vector<util::SafeTask> tasks;
+    for (int i = 0; i < follow_tasks; i++) {
+        tasks.emplace_back([&count] () { count += 1; });
+    }
+    pond.submitInBatchTo(0, tasks, tasks.size());
+    pond.waitForTasks();
+
+    util::BlockingStats stats = pond.blockingStats();
+    printf("%-10s | watchdog: done = %d | stalls = %llu | compensations = %llu | blocked %.3f s\n", name, done.load(),
+           static_cast<unsigned long long>(stats.stalls), static_cast<unsigned long long>(stats.compensations), stats.blocked_seconds);
+    return done && count == follow_tasks && stats.stalls >= 1 && stats.compensations >= 1;
+}
+
+// 只有一个运行很久的任务、没有其他任务在等待时，看门狗不补偿
+template <typename Pond>
+bool testLongTask(const char * name)
+{
+    Pond pond(2);
+    pond.enableBlockingWatchdog(std::chrono::milliseconds(20));
+    pond.submit([] () { std::this_thread::sleep_for(std::chrono::milliseconds(150)); });
+    pond.waitForTasks();
+
+    util::BlockingStats stats = pond.blockingStats();
+    printf("%-10s | long task: stalls = %llu | compensations = %llu\n", name,
+           static_cast<unsigned long long>(stats.stalls), static_cast<unsigned long long>(stats.compensations));
+    return stats.stalls == 0 && stats.compensations == 0;
+}
+
+int main()
+{
+    util::print(util::title("Test blocking tasks"));
+
+    bool ok = true;
+    ok = testScope<SteadyThreadPond>("steady") && ok;
+    ok = testScope<BalancedThreadPond>("balanced") && ok;
+    ok = testWatchdog<SteadyThreadPond>("steady") && ok;
+    ok = testWatchdog<BalancedThreadPond>("balanced") && ok;
+    ok = testLongTask<SteadyThreadPond>("steady") && ok;
+    ok = testLongTask<BalancedThreadPond>("balanced") && ok;
+
+    // 不在固定线程池的工作线程中时什么也不做
+    int answer = blocking([] () { return 42; });
+    ok = (answer == 42) && ok;
+
+    util::print(ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,71 @@
+#include "../include/myHipe.h"
+
+using namespace myHipe;
+
+// ==================================================
+//   检查 submitKeyed：同一个 key 的任务按顺序、串行执行，
+//   不同的 key 可以并行执行
+// ==================================================
+const int key_numb = 32;
+const int tasks_per_key = 2000;
+
+struct KeyState
+{
+    int next{0};                    // 下一个应该执行的序号，只在串行执行的任务中读写
+    std::atomic<int> running{0};    // 正在执行的任务数量
+    std::atomic<int> errors{0};
+};
+
+template <typename Pond>
+bool checkKeyed(Pond & pond, const char * name)
+{
+    std::vector<KeyState> states(key_numb);
+
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < tasks_per_key; i++) {
+        for (int key = 0; key < key_numb; key++) {
+            KeyState * state = &states[key];
+            pond.submitKeyed(static_cast<uint64_t>(key), [state, i] () {
+                if (state->running.fetch_add(1) != 0) {
+                    state->errors += 1;         // 同一个 key 的任务同时执行了
+                }
+                if (state->next != i) {
+                    state->errors += 1;         // 没有按提交顺序执行
+                }
+                state->next = i + 1;
+                state->running.fetch_sub(1);
+            });
+        }
+    }
+    pond.waitForTasks();
+    double cost = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    int errors = 0;
+    for (int key = 0; key < key_numb; key++) {
+        errors += states[key].errors.load();
+        errors += (states[key].next == tasks_per_key) ? 0 : 1;
+    }
+    printf("%-9s | keys: %-3d | tasks: %-6d | errors: %d | time-cost: %.5f(s)\n",
+           name, key_numb, key_numb * tasks_per_key, errors, cost);
+    return errors == 0;
+}
+
+int main()
+{
+    util::print(util::title("Test keyed submission"));
+
+    bool ok = true;
+    {
+        SteadyThreadPond pond(4);
+        pond.enableStealTasks(2);
+        ok = checkKeyed(pond, "steady") && ok;
+    }
+    {
+        BalancedThreadPond pond(4);
+        pond.enableStealTasks(2);
+        ok = checkKeyed(pond, "balanced") && ok;
+    }
+
+    util::print(ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
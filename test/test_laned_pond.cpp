@@ -0,0 +1,102 @@
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+#include "../include/myHipe.h"
+
+using namespace myHipe;
+
+// ==================================================
+//   LanedPond：计算任务和阻塞任务在同一个线程池的两条车道中
+// ==================================================
+
+// 阻塞任务各自占用一个 Blocking 车道的线程，不会挤占 Cpu 车道
+bool testLanes()
+{
+    LanedPond pond(2, 8);
+    std::atomic<int> cpu_done(0), blocking_done(0);
+    std::mutex locker;
+    std::set<std::thread::id> cpu_threads, blocking_threads;
+
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < 8; i++) {
+        pond.submitBlocking([&] () {
+            {
+                std::lock_guard<std::mutex> lock(locker);
+                blocking_threads.insert(std::this_thread::get_id());
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            blocking_done += 1;
+        });
+    }
+    for (int i = 0; i < 1000; i++) {
+        pond.submitCpu([&] () {
+            {
+                std::lock_guard<std::mutex> lock(locker);
+                cpu_threads.insert(std::this_thread::get_id());
+            }
+            cpu_done += 1;
+        });
+    }
+    pond.waitForTasks();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+    // 两条车道的线程不重叠，每个阻塞任务占用一个自己的线程
+    bool separated = cpu_threads.size() <= 2 && blocking_threads.size() == 8;
+    for (const std::thread::id & id : cpu_threads) {
+        separated = separated && blocking_threads.count(id) == 0;
+    }
+
+    util::PondStats stats = pond.stats();
+    printf("cpu tasks: %d on %zu threads | blocking tasks: %d on %zu threads | blocking threads: %d | %.1f ms | stats: %s, %d threads\n",
+           cpu_done.load(), cpu_threads.size(), blocking_done.load(), blocking_threads.size(), pond.getBlockingThreadNumb(), ms,
+           stats.pond_type.c_str(), stats.thread_numb);
+    return cpu_done == 1000 && blocking_done == 8 && pond.getBlockingThreadNumb() == 8 && separated
+        && stats.pond_type == "laned" && pond.getSubmittedTasks(Lane::Blocking) == 8;
+}
+
+// Cpu 车道的任务把阻塞的部分移到 Blocking 车道，等待的同时继续执行计算任务
+bool testMove()
+{
+    LanedPond pond(1, 2);
+    std::atomic<int> cpu_done(0);
+    std::atomic<int> seen(-1);
+    std::atomic<bool> started(false);
+    const int follow = 100;
+
+    pond.submitCpu([&] () {
+        started = true;
+        seen = pond.runBlocking([&] () {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            return cpu_done.load();
+        });
+    });
+    while (!started) {
+        std::this_thread::yield();
+    }
+    for (int i = 0; i < follow; i++) {
+        pond.submitCpu([&cpu_done] () { cpu_done += 1; });
+    }
+
+    // Blocking 车道的任务把后续的计算交回 Cpu 车道
+    std::atomic<int> chained(0);
+    pond.submitBlocking([&] () {
+        pond.submitCpu([&chained] () { chained += 1; });
+    });
+    pond.waitForTasks();
+
+    printf("cpu tasks run while waiting: %d | moved: %lld | chained: %d\n", seen.load(), pond.getMovedTasks(), chained.load());
+    return seen == follow && pond.getMovedTasks() == 1 && chained == 1;
+}
+
+int main()
+{
+    util::print(util::title("Test laned pond"));
+
+    bool ok = true;
+    ok = testLanes() && ok;
+    ok = testMove() && ok;
+
+    util::print(ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
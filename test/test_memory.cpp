@@ -0,0 +1,109 @@
+#include <chrono>
+#include <thread>
+#include "../include/myHipe.h"
+
+using namespace myHipe;
+
+// ==================================================
+//   一次突发的大量任务之后，任务队列会保留峰值时的容量，
+//   验证 shrinkToFit 和空闲回收能把这些内存还回去
+// ==================================================
+const int burst = 1000000;
+
+std::atomic<long long> sum(0);
+
+struct AddTask
+{
+    int value;
+    void operator()() { sum.fetch_add(this->value, std::memory_order_relaxed); }
+};
+
+template <typename Pond>
+void submitBurst(Pond & pond)
+{
+    for (int i = 0; i < burst; i++) {
+        pond.submit([i] () { sum.fetch_add(i, std::memory_order_relaxed); });
+    }
+    pond.waitForTasks();
+}
+
+void submitBurst(TypedSteadyPond<AddTask> & pond)
+{
+    for (int i = 0; i < burst; i++) {
+        pond.submit(AddTask{i});
+    }
+    pond.waitForTasks();
+}
+
+// 等待所有工作线程进入空闲并处理回收
+template <typename Pond>
+size_t settle(Pond & pond)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    return pond.memoryFootprint();
+}
+
+template <typename Pond>
+bool checkPond(const char * name)
+{
+    Pond pond(4);
+    size_t empty = pond.memoryFootprint();
+
+    // shrinkToFit：公开队列立刻释放，私有队列在线程空闲时释放
+    submitBurst(pond);
+    size_t peak = pond.memoryFootprint();
+    pond.shrinkToFit();
+    size_t shrunk = settle(pond);
+
+    // 空闲回收：不调用 shrinkToFit
+    pond.setIdleReclaim(std::chrono::milliseconds(20));
+    submitBurst(pond);
+    size_t peak2 = pond.memoryFootprint();
+    size_t reclaimed = settle(pond);
+
+    util::PondStats stats = pond.stats();
+    size_t queues = 0;
+    for (size_t i = 0; i < stats.workers.size(); i++) {
+        queues += stats.workers[i].queue_bytes;
+    }
+
+    printf("%-10s | empty: %-8zu | after burst: %-10zu | shrinkToFit: %-8zu | after burst: %-10zu | idle reclaim: %zu\n",
+           name, empty, peak, shrunk, peak2, reclaimed);
+
+    bool ok = true;
+    ok = ok && peak > empty * 16;
+    ok = ok && shrunk <= empty && reclaimed <= empty;
+    ok = ok && peak2 > reclaimed;
+    ok = ok && stats.memory_bytes == reclaimed && queues <= reclaimed;
+    return ok;
+}
+
+// 有界的线程池回收之后仍然保留每个线程的任务容量
+bool checkBounded()
+{
+    const int capacity = 4000;
+    SteadyThreadPond pond(4, capacity);
+    size_t reserved = pond.memoryFootprint();
+    for (int i = 0; i < capacity; i++) {
+        pond.submit([] () { sum.fetch_add(1, std::memory_order_relaxed); });
+    }
+    pond.waitForTasks();
+    pond.shrinkToFit();
+    size_t shrunk = settle(pond);
+    printf("bounded    | reserved: %-8zu | shrinkToFit: %zu\n", reserved, shrunk);
+    return shrunk == reserved;
+}
+
+int main()
+{
+    util::print(util::title("Test memory reclamation of ponds"));
+
+    bool ok = true;
+    ok = checkPond<SteadyThreadPond>("steady") && ok;
+    ok = checkPond<BalancedThreadPond>("balanced") && ok;
+    ok = checkPond<TypedSteadyPond<AddTask>>("typed") && ok;
+    ok = checkBounded() && ok;
+
+    util::print(ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,88 @@
+#include "../include/myHipe.h"
+
+using namespace myHipe;
+
+// ==================================================
+//   检查 orderedMap：
+//   1. 每个任务的耗时不同，结果仍然按照读取的顺序输出
+//   2. 已经读取但还没有输出的数据不超过 max_in_flight
+//   3. func 抛出的异常会被抛给调用者
+// ==================================================
+const int item_numb = 20000;
+const size_t max_in_flight = 32;
+
+bool checkOrder()
+{
+    BalancedThreadPond pond(4);
+    pond.enableStealTasks(3);
+
+    int read = 0;
+    int emitted = 0;
+    int max_seen = 0;
+    bool in_order = true;
+
+    auto source = [&] (std::string & line) -> bool {
+        if (read == item_numb) {
+            return false;
+        }
+        line = std::to_string(read++);
+        max_seen = std::max(max_seen, read - emitted);
+        return true;
+    };
+    auto parse = [] (std::string line) -> int {
+        int value = std::stoi(line);
+        if (value % 7 == 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));     // 打乱结束的顺序
+        }
+        return value;
+    };
+    auto sink = [&] (int value) {
+        in_order = in_order && (value == emitted);
+        emitted++;
+    };
+
+    auto begin = std::chrono::steady_clock::now();
+    uint64_t numb = orderedMap(pond, source, parse, sink, max_in_flight);
+    double cost = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    printf("items: %d | emitted: %llu | in order: %s | max in flight: %d (limit %zu) | time-cost: %.5f(s)\n",
+           item_numb, (unsigned long long)numb, in_order ? "yes" : "no", max_seen, max_in_flight, cost);
+    return numb == static_cast<uint64_t>(item_numb) && in_order && max_seen <= static_cast<int>(max_in_flight);
+}
+
+bool checkException()
+{
+    SteadyThreadPond pond(2);
+    int read = 0;
+    int emitted = 0;
+    bool caught = false;
+    try {
+        orderedMap(pond, [&read] (int & item) -> bool {
+            item = read++;
+            return read <= 1000;
+        }, [] (int item) -> int {
+            if (item == 500) {
+                throw std::runtime_error("bad item");
+            }
+            return item;
+        }, [&emitted] (int) {
+            emitted++;
+        }, 16);
+    }
+    catch (const std::runtime_error &) {
+        caught = true;
+    }
+    printf("exception caught: %s | emitted before the failed item: %d\n", caught ? "yes" : "no", emitted);
+    return caught && emitted == 500;
+}
+
+int main()
+{
+    util::print(util::title("Test orderedMap"));
+
+    bool ok = checkOrder();
+    ok = checkException() && ok;
+
+    util::print(ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
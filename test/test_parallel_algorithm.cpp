@@ -0,0 +1,118 @@
+#include "../include/myHipe.h"
+#include <numeric>
+#include <random>
+
+using namespace myHipe;
+
+// ==================================================
+//   检查 algorithm.h 中的并行算法和顺序的 STL 结果相同：
+//   不同的长度（空、比 grain 小、不是 grain 的整数倍）和不同的 grain
+// ==================================================
+
+template <typename Pond>
+bool checkPond(Pond & pond, const char * name)
+{
+    std::mt19937 rng(2024);
+    const size_t sizes[] = {0, 1, 7, 1000, 100003, 1000000};
+    const size_t grains[] = {0, 1000, 4096};
+    bool ok = true;
+
+    for (size_t size : sizes) {
+        std::vector<int> data(size);
+        for (size_t i = 0; i < size; i++) {
+            data[i] = static_cast<int>(rng() % 100000) - 50000;
+        }
+        for (size_t grain : grains) {
+            // 排序，降序
+            std::vector<int> sorted = data;
+            std::vector<int> expect = data;
+            parallelSort(pond, sorted.begin(), sorted.end(), std::greater<int>(), grain);
+            std::sort(expect.begin(), expect.end(), std::greater<int>());
+            bool sort_ok = (sorted == expect);
+
+            // 前缀和，包含当前元素 / 不包含当前元素 / 原地
+            std::vector<long long> wide(data.begin(), data.end());
+            std::vector<long long> scan(size);
+            std::vector<long long> scan_expect(size);
+            inclusiveScan(pond, wide.begin(), wide.end(), scan.begin(), std::plus<long long>(), grain);
+            std::partial_sum(wide.begin(), wide.end(), scan_expect.begin());
+            bool scan_ok = (scan == scan_expect);
+
+            std::vector<long long> exclusive(size);
+            exclusiveScan(pond, wide.begin(), wide.end(), exclusive.begin(), 10LL, std::plus<long long>(), grain);
+            long long running = 10;
+            for (size_t i = 0; i < size; i++) {
+                scan_ok = scan_ok && exclusive[i] == running;
+                running += wide[i];
+            }
+            inclusiveScan(pond, wide.begin(), wide.end(), wide.begin(), std::plus<long long>(), grain);
+            scan_ok = scan_ok && (wide == scan_expect);
+
+            // transform_reduce：平方和；字符串拼接（不满足交换律）
+            long long squares = transformReduce(pond, data.begin(), data.end(), 0LL, std::plus<long long>(),
+                                                [] (int x) -> long long { return static_cast<long long>(x) * x; }, grain);
+            long long squares_expect = 0;
+            for (size_t i = 0; i < size; i++) {
+                squares_expect += static_cast<long long>(data[i]) * data[i];
+            }
+            bool reduce_ok = (squares == squares_expect);
+            reduce_ok = reduce_ok && parallelReduce(pond, data.begin(), data.end(), 0LL, std::plus<long long>(), grain) ==
+                                     std::accumulate(data.begin(), data.end(), 0LL);
+            if (size <= 1000) {
+                std::string text = transformReduce(pond, data.begin(), data.end(), std::string(">"),
+                                                   std::plus<std::string>(), [] (int x) { return std::to_string(x % 10); }, grain == 0 ? 0 : 16);
+                std::string text_expect(">");
+                for (size_t i = 0; i < size; i++) {
+                    text_expect += std::to_string(data[i] % 10);
+                }
+                reduce_ok = reduce_ok && (text == text_expect);
+            }
+
+            if (!(sort_ok && scan_ok && reduce_ok)) {
+                printf("%-8s | size: %-7zu | grain: %-4zu | sort: %d | scan: %d | reduce: %d\n",
+                       name, size, grain, sort_ok, scan_ok, reduce_ok);
+                ok = false;
+            }
+        }
+    }
+    printf("%-8s | all sizes and grains: %s\n", name, ok ? "ok" : "mismatch");
+    return ok;
+}
+
+// 在线程池的任务中调用并行算法，等待时帮助执行任务而不是阻塞
+bool checkNested()
+{
+    SteadyThreadPond pond(2);
+    std::vector<int> data(200000);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = static_cast<int>((i * 7919) % 100003);
+    }
+    std::vector<int> expect = data;
+    std::sort(expect.begin(), expect.end());
+
+    std::atomic<bool> ok{false};
+    pond.submit([&] {
+        parallelSort(pond, data.begin(), data.end());
+        ok = (data == expect);
+    });
+    pond.waitForTasks();
+    printf("nested sort inside a pond task: %s\n", ok.load() ? "ok" : "mismatch");
+    return ok.load();
+}
+
+int main()
+{
+    util::print(util::title("Test parallel algorithms"));
+
+    SteadyThreadPond steady(4);
+    steady.enableStealTasks(3);
+    BalancedThreadPond balanced(4);
+    balanced.enableStealTasks(3);
+
+    bool ok = checkPond(steady, "steady");
+    ok = checkPond(balanced, "balanced") && ok;
+    ok = checkNested() && ok;
+
+    util::print(ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+#include "../include/myHipe.h"
+
+using namespace myHipe;
+
+// ==================================================
+//   检查 Pipeline：
+//   1. 每个数据都经过了所有阶段
+//   2. 最后一个阶段很慢时，各个阶段队列中的数据数量不超过容量（反压）
+//   3. 阶段的函数抛出异常时数据被丢弃，wait() 重新抛出异常，流水线可以继续使用和析构
+// ==================================================
+const int item_numb = 20000;
+
+bool checkThrowingStage(BalancedThreadPond & pond)
+{
+    std::atomic<long long> sum{0};
+    auto pipe = Pipeline<int>::build()
+                    .then(pond, [] (int value) -> int {
+                        if (value % 100 == 0) {
+                            throw std::runtime_error("bad item");
+                        }
+                        return value;
+                    }, 2, 16)
+                    .sink(pond, [&sum] (int value) {
+                        if (value % 100 == 1) {
+                            throw std::runtime_error("bad sink");
+                        }
+                        sum += value;
+                    }, 2, 16);
+
+    long long expect = 0;
+    for (int i = 0; i < item_numb; i++) {
+        pipe.push(i);
+        expect += (i % 100 == 0 || i % 100 == 1) ? 0 : i;
+    }
+    std::string message;
+    try {
+        pipe.wait();
+    }
+    catch (const std::runtime_error & e) {
+        message = e.what();
+    }
+    bool rethrown = (message == "bad item" || message == "bad sink");
+
+    // 异常只抛出一次，之后流水线可以继续使用
+    bool reusable = true;
+    pipe.push(7);
+    try {
+        pipe.wait();
+    }
+    catch (...) {
+        reusable = false;
+    }
+    expect += 7;
+    printf("throwing stage | rethrown: %s | reusable: %s | sum: %lld (expect %lld) | in-flight: %lld\n",
+           rethrown ? "yes" : "no", reusable ? "yes" : "no", sum.load(), expect, (long long)pipe.getInFlight());
+    return rethrown && reusable && sum.load() == expect && pipe.getInFlight() == 0;
+}
+
+int main()
+{
+    util::print(util::title("Test pipeline"));
+
+    BalancedThreadPond pond(4);
+    SteadyThreadPond sink_pond(1);
+    std::atomic<long long> sum{0};
+
+    const size_t capacity = 16;
+    auto pipe = Pipeline<std::string>::build()
+                    .then(pond, [] (std::string line) -> int {
+                        return std::stoi(line);
+                    }, 2, capacity)
+                    .then(pond, [] (int value) -> long long {
+                        return static_cast<long long>(value) * 2;
+                    }, 4, capacity)
+                    .sink(sink_pond, [&sum] (long long value) {
+                        std::this_thread::sleep_for(std::chrono::microseconds(20));     // 很慢的最后一个阶段
+                        sum += value;
+                    }, 1, capacity);
+
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < item_numb; i++) {
+        pipe.push(std::to_string(i));
+    }
+    pipe.wait();
+    double cost = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    bool ok = (sum.load() == static_cast<long long>(item_numb) * (item_numb - 1)) && pipe.getInFlight() == 0;
+    std::vector<util::StageStats> stats = pipe.stats();
+    for (size_t i = 0; i < stats.size(); i++) {
+        const util::StageStats & ss = stats[i];
+        printf("stage: %d | parallelism: %d | capacity: %-3zu | max-occupancy: %-3zu | processed: %-6llu | stalls: %-6llu | throughput: %.0f/s\n",
+               ss.index, ss.parallelism, ss.capacity, ss.max_occupancy, (unsigned long long)ss.processed,
+               (unsigned long long)ss.stalls, ss.throughput);
+        ok = ok && ss.max_occupancy <= ss.capacity && ss.processed == static_cast<uint64_t>(item_numb);
+    }
+    printf("items: %d | sum: %lld | time-cost: %.5f(s)\n", item_numb, sum.load(), cost);
+
+    ok = checkThrowingStage(pond) && ok;
+
+    util::print(ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,202 @@
+#include "../include/myHipe.h"
+
+using namespace myHipe;
+
+#ifdef __linux__
+
+#include <fcntl.h>
+#include <sys/socket.h>
+
+// ==================================================
+//   检查 Reactor：
+//   1. 多个 pipe 同时写入，每个 fd 的数据按顺序读到，同一个 fd 的回调不会同时执行
+//   2. socketpair 的回显：回调读出请求并写回
+//   3. remove 之后不会再分发回调
+// ==================================================
+const int pipe_numb = 16;
+const int message_numb = 5000;          // 每个 pipe 写入的整数数量
+
+void setNonBlocking(int fd)
+{
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+struct PipeState
+{
+    int fds[2];
+    std::atomic<int> expect{0};         // 下一个应该读到的整数
+    bool in_order{true};
+    std::atomic<int> inside{0};         // 正在执行的回调数量
+    std::atomic<bool> overlapped{false};
+};
+
+bool checkPipes()
+{
+    SteadyThreadPond pond(4);
+    pond.enableStealTasks(3);
+    std::vector<std::unique_ptr<PipeState>> pipes;
+    {
+        Reactor<SteadyThreadPond> reactor(pond);
+        for (int i = 0; i < pipe_numb; i++) {
+            pipes.emplace_back(new PipeState);
+            PipeState * ps = pipes.back().get();
+            if (pipe(ps->fds) != 0) {
+                return false;
+            }
+            setNonBlocking(ps->fds[0]);
+            reactor.add(ps->fds[0], EPOLLIN, [ps] (uint32_t) {
+                if (ps->inside.fetch_add(1) != 0) {
+                    ps->overlapped = true;
+                }
+                int buffer[256];
+                ssize_t n;
+                size_t carry = 0;
+                char * bytes = reinterpret_cast<char *>(buffer);
+                while ((n = read(ps->fds[0], bytes + carry, sizeof(buffer) - carry)) > 0) {
+                    size_t total = carry + static_cast<size_t>(n);
+                    size_t values = total / sizeof(int);
+                    for (size_t k = 0; k < values; k++) {
+                        ps->in_order = ps->in_order && (buffer[k] == ps->expect);
+                        ps->expect++;
+                    }
+                    carry = total % sizeof(int);
+                    std::memmove(bytes, bytes + values * sizeof(int), carry);
+                }
+                ps->inside.fetch_sub(1);
+            });
+        }
+
+        // 每个 pipe 由一个线程写入，单次写入小于 PIPE_BUF，不会被拆开
+        std::vector<std::thread> writers;
+        for (int i = 0; i < pipe_numb; i++) {
+            writers.emplace_back([&pipes, i] {
+                PipeState * ps = pipes[i].get();
+                for (int v = 0; v < message_numb; v++) {
+                    while (write(ps->fds[1], &v, sizeof(v)) != sizeof(v)) {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+        for (size_t i = 0; i < writers.size(); i++) {
+            writers[i].join();
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+        bool done = false;
+        while (!done && std::chrono::steady_clock::now() < deadline) {
+            done = true;
+            for (int i = 0; i < pipe_numb; i++) {
+                done = done && pond.getTasksRemain() == 0 && pipes[i]->expect == message_numb;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        printf("pipes: %d | messages per pipe: %d | callbacks: %llu | epoll rounds: %llu\n", pipe_numb, message_numb,
+               (unsigned long long)reactor.getDispatched(), (unsigned long long)reactor.getRounds());
+    }
+
+    bool ok = true;
+    for (int i = 0; i < pipe_numb; i++) {
+        PipeState * ps = pipes[i].get();
+        ok = ok && ps->in_order && !ps->overlapped && ps->expect == message_numb;
+        close(ps->fds[0]);
+        close(ps->fds[1]);
+    }
+    printf("all pipes complete, in order and never overlapped: %s\n", ok ? "yes" : "no");
+    return ok;
+}
+
+bool checkEcho()
+{
+    BalancedThreadPond pond(2);
+    Reactor<BalancedThreadPond> reactor(pond);
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+        return false;
+    }
+    setNonBlocking(sv[0]);
+    int server = sv[0];
+    reactor.add(server, EPOLLIN, [server] (uint32_t) {
+        char buffer[128];
+        ssize_t n;
+        while ((n = read(server, buffer, sizeof(buffer))) > 0) {
+            for (ssize_t i = 0; i < n; i++) {
+                buffer[i] = static_cast<char>(std::toupper(buffer[i]));
+            }
+            ssize_t w = write(server, buffer, static_cast<size_t>(n));
+            (void)w;
+        }
+    });
+
+    bool ok = true;
+    const char * requests[] = {"hello", "hipe", "reactor"};
+    for (int i = 0; i < 3; i++) {
+        std::string req(requests[i]);
+        ssize_t w = write(sv[1], req.data(), req.size());
+        (void)w;
+        std::string reply;
+        char buffer[128];
+        while (reply.size() < req.size()) {
+            ssize_t n = read(sv[1], buffer, sizeof(buffer));
+            if (n <= 0) {
+                break;
+            }
+            reply.append(buffer, static_cast<size_t>(n));
+        }
+        printf("echo: %s -> %s\n", req.c_str(), reply.c_str());
+        for (size_t k = 0; k < req.size(); k++) {
+            req[k] = static_cast<char>(std::toupper(req[k]));
+        }
+        ok = ok && reply == req;
+    }
+
+    // remove 之后写入的数据不会再被处理
+    reactor.remove(server);
+    uint64_t before = reactor.getDispatched();
+    ssize_t w = write(sv[1], "x", 1);
+    (void)w;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ok = ok && reactor.getDispatched() == before && reactor.size() == 0;
+    printf("no callbacks after remove: %s\n", (reactor.getDispatched() == before) ? "yes" : "no");
+
+    close(sv[0]);
+    close(sv[1]);
+    return ok;
+}
+
+// 有界的线程池会把回调放进溢出队列，reactor 不接受它
+bool checkBounded()
+{
+    SteadyThreadPond pond(2, 100);
+    bool rejected = false;
+    try {
+        Reactor<SteadyThreadPond> reactor(pond);
+    }
+    catch (const std::invalid_argument &) {
+        rejected = true;
+    }
+    printf("bounded pond rejected: %s\n", rejected ? "yes" : "no");
+    return rejected;
+}
+
+int main()
+{
+    util::print(util::title("Test reactor"));
+
+    bool ok = checkPipes();
+    ok = checkEcho() && ok;
+    ok = checkBounded() && ok;
+
+    util::print(ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+#else
+
+int main()
+{
+    util::print("the reactor is only available on Linux");
+    return 0;
+}
+
+#endif
@@ -0,0 +1,129 @@
+#include <functional>
+#include <mutex>
+#include <set>
+#include <thread>
+#include "../include/myHipe.h"
+
+using namespace myHipe;
+
+// ==================================================
+//   多个 SharedPond 共用同一组工作线程
+// ==================================================
+
+// 5 个线程池同时提交任务，执行任务的线程不超过 WorkerRegistry 的线程数量
+bool testBudget()
+{
+    WorkerRegistry registry(2);
+    std::mutex locker;
+    std::set<std::thread::id> ids;
+    std::atomic<long long> sum(0);
+    const int tasks = 20000;
+    {
+        std::vector<std::unique_ptr<SharedPond>> ponds;
+        for (int i = 0; i < 5; i++) {
+            ponds.emplace_back(new SharedPond(1, registry));
+        }
+        for (int i = 0; i < tasks; i++) {
+            ponds[i % 5]->submit([&, i] () {
+                sum.fetch_add(i);
+                if (i % 100 == 0) {
+                    std::lock_guard<std::mutex> lock(locker);
+                    ids.insert(std::this_thread::get_id());
+                }
+            });
+        }
+        for (int i = 0; i < 5; i++) {
+            ponds[i]->waitForTasks();
+        }
+        printf("ponds attached: %d | threads used: %zu | sum = %lld\n", registry.getPondNumb(), ids.size(), sum.load());
+    }
+    long long expect = static_cast<long long>(tasks) * (tasks - 1) / 2;
+    return sum == expect && ids.size() <= 2 && registry.getPondNumb() == 0;
+}
+
+// 只有一个工作线程时，积压的任务按照权重 3 : 1 执行
+bool testWeight()
+{
+    WorkerRegistry registry(1);
+    SharedPond gate(1, registry), heavy(3, registry), light(1, registry);
+    std::atomic<bool> open(false);
+    std::vector<int> order;
+    order.reserve(8000);
+
+    gate.submit([&open] () {
+        while (!open) {
+            std::this_thread::yield();
+        }
+    });
+    while (registry.stats().tasks_remain != 0) {       // 等待唯一的工作线程取走 gate 的任务
+        std::this_thread::yield();
+    }
+    for (int i = 0; i < 4000; i++) {
+        heavy.submit([&order] () { order.push_back(3); });
+        light.submit([&order] () { order.push_back(1); });
+    }
+    open = true;
+    heavy.waitForTasks();
+    light.waitForTasks();
+
+    int heavy_first = 0;
+    for (int i = 0; i < 2000; i++) {
+        heavy_first += (order[i] == 3);
+    }
+    printf("tasks of the heavy pond in the first 2000: %d\n", heavy_first);
+    return order.size() == 8000 && heavy_first >= 1400 && heavy_first <= 1600;
+}
+
+// TaskGroup 和在任务中等待
+bool testNested()
+{
+    WorkerRegistry registry(2);
+    SharedPond pond(1, registry);
+    std::atomic<int> count(0);
+    pond.submit([&] () {
+        TaskGroup<SharedPond> group(pond);
+        for (int i = 0; i < 100; i++) {
+            group.submit([&count] () { count += 1; });
+        }
+        group.wait();
+    });
+    auto answer = pond.submitForReturn([] () { return 42; });
+    pond.waitForTasks();
+    printf("nested tasks: %d | answer: %d\n", count.load(), answer.get());
+    return count == 100;
+}
+
+// 任务中等待自己的线程池：同一批中剩下的任务由等待的任务执行，也不会等待自己
+bool testSelfWait()
+{
+    WorkerRegistry registry(1);
+    SharedPond pond(1, registry);
+    std::atomic<int> count(0);
+    std::atomic<int> seen(-1);
+    std::vector<std::function<void()>> tasks;
+    tasks.emplace_back([&] () {
+        pond.waitForTasks();
+        seen = count.load();
+    });
+    for (int i = 0; i < 20; i++) {
+        tasks.emplace_back([&count] () { count += 1; });
+    }
+    pond.submitInBatch(tasks, tasks.size());
+    pond.waitForTasks();
+    printf("tasks done before the waiting task returned: %d\n", seen.load());
+    return seen == 20 && pond.getTasksRemain() == 0;
+}
+
+int main()
+{
+    util::print(util::title("Test shared ponds"));
+
+    bool ok = true;
+    ok = testBudget() && ok;
+    ok = testWeight() && ok;
+    ok = testNested() && ok;
+    ok = testSelfWait() && ok;
+
+    util::print(ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+#include "../include/myHipe.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+using namespace myHipe;
+
+template <typename Pond>
+void submitSomeTasks(Pond & pond)
+{
+    for (int i = 0; i < 200; i++) {
+        pond.submit([i] () {
+            util::sleep_for_microseconds((i % 10 == 0) ? 500 : 20);
+        });
+    }
+    pond.waitForTasks();
+}
+
+void printStats(const util::PondStats & stats)
+{
+    util::print(util::title("stats of " + stats.pond_type));
+    util::print("threads = ", stats.thread_numb, " | tasks remain = ", stats.tasks_remain,
+                " | overflow tasks = ", stats.overflow_tasks, " | tasks executed = ", stats.tasksExecuted());
+    for (size_t i = 0; i < stats.workers.size(); i++) {
+        const util::WorkerStats & w = stats.workers[i];
+        printf("worker %-2d | depth: %-4d | executed: %-5llu | steals: %llu/%llu | parks: %-4llu | idle: %.4f(s) | busy: %.4f(s)\n",
+               w.index, w.queue_depth, static_cast<unsigned long long>(w.tasks_executed),
+               static_cast<unsigned long long>(w.steals_succeeded), static_cast<unsigned long long>(w.steals_attempted),
+               static_cast<unsigned long long>(w.parks), w.idle_seconds, w.busy_seconds);
+    }
+}
+
+// 检查 line 在 text 中恰好出现 times 次
+bool expect(const std::string & text, const std::string & line, int times)
+{
+    int found = 0;
+    for (size_t pos = text.find(line); pos != std::string::npos; pos = text.find(line, pos + 1)) {
+        found += 1;
+    }
+    if (found != times) {
+        util::print("expected ", times, " time(s) but found ", found, ": ", line);
+    }
+    return found == times;
+}
+
+int main()
+{
+    SteadyThreadPond steady(4, 100);
+    steady.enableStealTasks(2);
+    steady.setRefuseCallBack([] () {});
+    submitSomeTasks(steady);
+    printStats(steady.stats());
+
+    BalancedThreadPond balanced(4);
+    balanced.enableStealTasks(2);
+    submitSomeTasks(balanced);
+    printStats(balanced.stats());
+
+    DynamicThreadPond dynamic(4);
+    submitSomeTasks(dynamic);
+    dynamic.adjustThreads(2);
+    dynamic.adjustThreads(3);
+    printStats(dynamic.stats());
+
+    HybridPond hybrid(2, 20, 4);
+    submitSomeTasks(hybrid);
+    printStats(hybrid.stats());
+
+    // 渲染成 Prometheus 的文本格式，多个线程池可以放在同一份输出中，标签的值需要转义
+    std::vector<std::pair<std::string, util::PondStats>> ponds;
+    ponds.push_back(std::make_pair("core", steady.stats()));
+    ponds.push_back(std::make_pair("ca\"che\\\n", dynamic.stats()));
+    std::string text = util::toPrometheus(ponds);
+    util::print("\n", text.substr(0, text.find("# HELP hipe_worker_tasks_executed_total")));
+
+    bool ok = true;
+    ok = expect(text, "# TYPE hipe_pond_threads gauge\n", 1) && ok;
+    ok = expect(text, "hipe_pond_threads{pond=\"core\",type=\"steady\"} 4\n", 1) && ok;
+    ok = expect(text, "hipe_pond_threads{pond=\"ca\\\"che\\\\\\n\",type=\"dynamic\"} 3\n", 1) && ok;
+    ok = expect(text, "hipe_worker_queue_depth{pond=\"core\",type=\"steady\",worker=\"3\"} 0\n", 1) && ok;
+    ok = expect(text, "# TYPE hipe_worker_tasks_executed_total counter\n", 1) && ok;
+
+    // 写入临时目录，读回的内容和渲染的相同
+    const char * dir = std::getenv("TMPDIR");
+    std::string path = std::string((dir != nullptr && *dir != '\0') ? dir : "/tmp") + "/hipe_stats.prom";
+    bool saved = util::dumpPrometheus(path, text);
+    std::ifstream file(path.c_str());
+    std::string saved_text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::remove(path.c_str());
+    util::print("prometheus file saved: ", saved, " | content matches: ", saved_text == text);
+    ok = saved && saved_text == text && ok;
+
+    util::print(ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
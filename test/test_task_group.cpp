@@ -0,0 +1,69 @@
+#include "../include/myHipe.h"
+
+using namespace myHipe;
+
+// 递归地把区间一分为二，在任务内部提交子任务并等待，测试工作线程中的 wait()
+template <typename Pond>
+long long parallelSum(Pond & pond, int left, int right)
+{
+    if (right - left <= 1000) {
+        long long sum = 0;
+        for (int i = left; i < right; i++) {
+            sum += i;
+        }
+        return sum;
+    }
+    int mid = left + (right - left) / 2;
+    long long left_sum = 0;
+    long long right_sum = 0;
+    TaskGroup<Pond> group(pond);
+    group.submit([&] () { left_sum = parallelSum(pond, left, mid); });
+    group.submit([&] () { right_sum = parallelSum(pond, mid, right); });
+    group.wait();
+    return left_sum + right_sum;
+}
+
+template <typename Pond>
+void test_task_group(Pond & pond, const std::string & name)
+{
+    util::print("\n", util::title("TaskGroup on " + name));
+
+    // 其他请求的长任务不会阻塞这个任务组的等待
+    for (int i = 0; i < 4; i++) {
+        pond.submit([] () { util::sleep_for_milliseconds(200); });
+    }
+
+    std::atomic<int> var(0);
+    TaskGroup<Pond> group(pond);
+    for (int i = 0; i < 50; i++) {
+        group.submit([&] () { var++; });
+    }
+    auto ret = group.submitForReturn([] () -> int { return 2023; });
+    group.wait();
+    util::print("group done = ", var.load(), " | return = ", ret.get(), " | pond tasks remain = ", pond.getTasksRemain());
+
+    // 在工作线程中等待子任务
+    auto sum = pond.submitForReturn([&] () -> long long { return parallelSum(pond, 0, 100000); });
+    util::print("nested sum = ", sum.get(), " (expect ", 100000LL * 99999 / 2, ")");
+
+    // 超时等待
+    TaskGroup<Pond> slow(pond);
+    slow.submit([] () { util::sleep_for_milliseconds(100); });
+    util::print("waitFor(1ms) = ", slow.waitFor(std::chrono::milliseconds(1)));
+    util::print("waitFor(1s) = ", slow.waitFor(std::chrono::seconds(1)));
+
+    pond.waitForTasks();
+}
+
+int main()
+{
+    SteadyThreadPond steady(2);
+    test_task_group(steady, "steady");
+
+    BalancedThreadPond balanced(2);
+    test_task_group(balanced, "balanced");
+
+    DynamicThreadPond dynamic(2);
+    test_task_group(dynamic, "dynamic");
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include "../include/myHipe.h"
+
+using namespace myHipe;
+
+// ==================================================
+//   检查 BalancedThreadPond 的租户：
+//   1. 两个租户都有积压时，执行的任务数量按照权重分配
+//   2. max_running 限制了一个租户同时执行的任务数量
+// ==================================================
+
+void printTenant(const util::TenantStats & ts)
+{
+    printf("tenant: %d | weight: %d | max-running: %d | submitted: %-5llu | completed: %-5llu | queued: %llu | running: %d | throttled: %llu\n",
+           ts.tenant, ts.weight, ts.max_running, (unsigned long long)ts.submitted, (unsigned long long)ts.completed,
+           (unsigned long long)ts.queued, ts.running, (unsigned long long)ts.throttled);
+}
+
+bool checkWeights()
+{
+    BalancedThreadPond pond(1);
+    int heavy = pond.addTenant(3);
+    int light = pond.addTenant(1);
+
+    // 先用一个任务挡住唯一的线程，让两个租户的任务都积压在队列中
+    std::atomic<bool> started{false};
+    std::atomic<bool> gate{false};
+    pond.submit([&started, &gate] {
+        started = true;
+        while (!gate.load()) {
+            std::this_thread::yield();
+        }
+    });
+    while (!started.load()) {
+        std::this_thread::yield();
+    }
+
+    std::vector<int> order;     // 只有一个线程，不需要加锁
+    order.reserve(400);
+    std::vector<util::SafeTask> tasks;
+    for (int i = 0; i < 300; i++) {
+        tasks.emplace_back([&order, heavy] { order.push_back(heavy); });
+    }
+    pond.submitInBatchAs(heavy, tasks, tasks.size());
+    for (int i = 0; i < 100; i++) {
+        pond.submitAs(light, [&order, light] { order.push_back(light); });
+    }
+    gate = true;
+    pond.waitForTasks();
+
+    // 两个租户都有积压时（前 400 个任务），每 4 个任务中 heavy 占 3 个
+    int heavy_numb = 0;
+    for (int i = 0; i < 200; i++) {
+        heavy_numb += (order[i] == heavy) ? 1 : 0;
+    }
+    printTenant(pond.tenantStats(heavy));
+    printTenant(pond.tenantStats(light));
+    printf("weights 3:1 | heavy tasks in the first 200: %d\n", heavy_numb);
+    return order.size() == 400 && heavy_numb >= 147 && heavy_numb <= 153;
+}
+
+bool checkMaxRunning()
+{
+    BalancedThreadPond pond(4);
+    pond.enableStealTasks(3);
+    int capped = pond.addTenant(1, 1);
+    int free = pond.addTenant(1);
+
+    std::atomic<int> running{0};
+    std::atomic<int> max_seen{0};
+    std::atomic<int> free_done{0};
+    for (int i = 0; i < 200; i++) {
+        pond.submitAs(capped, [&running, &max_seen] {
+            int now = running.fetch_add(1) + 1;
+            int seen = max_seen.load();
+            while (now > seen && !max_seen.compare_exchange_weak(seen, now)) {}
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            running.fetch_sub(1);
+        });
+        pond.submitAs(free, [&free_done] { free_done += 1; });
+    }
+    pond.waitForTasks();
+
+    util::TenantStats ts = pond.tenantStats(capped);
+    printTenant(ts);
+    printTenant(pond.tenantStats(free));
+    printf("max-running 1 | max concurrent tasks seen: %d\n", max_seen.load());
+    return max_seen.load() == 1 && free_done.load() == 200 && ts.completed == 200 && ts.queued == 0 && ts.running == 0;
+}
+
+int main()
+{
+    util::print(util::title("Test tenants of the balanced pond"));
+
+    bool ok = checkWeights();
+    ok = checkMaxRunning() && ok;
+
+    util::print(ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
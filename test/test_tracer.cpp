@@ -0,0 +1,112 @@
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <vector>
+#include "../include/myHipe.h"
+
+using namespace myHipe;
+
+// 提交一些长短不一的任务，并导出 Chrome trace JSON，可以在 ui.perfetto.dev 中打开
+template <typename Pond>
+void submitSomeTasks(Pond & pond)
+{
+    for (int i = 0; i < 200; i++) {
+        pond.submit([i] () {
+            util::sleep_for_microseconds((i % 10 == 0) ? 500 : 20);
+        });
+    }
+    pond.waitForTasks();
+}
+
+// 导出的文件放在临时目录中
+std::string tracePath(const std::string & name)
+{
+    const char * dir = std::getenv("TMPDIR");
+    return std::string((dir != nullptr && *dir != '\0') ? dir : "/tmp") + "/" + name;
+}
+
+// 取出一行事件中 key 对应的值
+std::string field(const std::string & line, const std::string & key)
+{
+    std::string pattern = "\"" + key + "\":";
+    size_t begin = line.find(pattern);
+    if (begin == std::string::npos) {
+        return std::string();
+    }
+    begin += pattern.size();
+    if (line[begin] == '"') {
+        begin += 1;
+        return line.substr(begin, line.find('"', begin) - begin);
+    }
+    return line.substr(begin, line.find_first_of(",}", begin) - begin);
+}
+
+// 每一行（tid）中的 B / E 事件必须正确嵌套，并且同一个线程不会同时处于两个 run 或两个 idle 中
+bool checkNesting(const std::string & json)
+{
+    std::map<std::string, std::vector<std::string>> stacks;
+    std::istringstream in(json);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::string ph = field(line, "ph");
+        if (ph != "B" && ph != "E") {
+            continue;
+        }
+        std::vector<std::string> & stack = stacks[field(line, "tid")];
+        std::string name = field(line, "name");
+        if (ph == "B") {
+            for (size_t i = 0; i < stack.size(); i++) {
+                if (stack[i] == name) {
+                    return false;
+                }
+            }
+            stack.push_back(name);
+        }
+        else if (!stack.empty()) {      // 开启追踪之前开始的区间没有 B
+            if (stack.back() != name) {
+                return false;
+            }
+            stack.pop_back();
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    bool ok = true;
+    {
+        SteadyThreadPond pond(4);
+        pond.enableStealTasks(2);
+        pond.enableTracing();
+        submitSomeTasks(pond);
+        pond.disableTracing();
+        ok = checkNesting(pond.traceToJson()) && ok;
+        util::print("steady trace saved: ", pond.dumpTrace(tracePath("steady_trace.json"), "Hipe-Steady"));
+    }
+    {
+        BalancedThreadPond pond(4);
+        pond.enableStealTasks(2);
+        pond.enableTracing();
+        submitSomeTasks(pond);
+        ok = checkNesting(pond.traceToJson()) && ok;
+        util::print("balanced trace saved: ", pond.dumpTrace(tracePath("balanced_trace.json"), "Hipe-Balanced"));
+    }
+    {
+        // 开启追踪之后增加线程，新的线程也有自己的一行
+        DynamicThreadPond pond(2);
+        pond.enableTracing(1 << 12);
+        submitSomeTasks(pond);
+        pond.adjustThreads(4);
+        submitSomeTasks(pond);
+        pond.adjustThreads(1);
+        std::string json = pond.traceToJson();
+        bool nested = checkNesting(json);
+        bool lanes = json.find("\"worker 3\"") != std::string::npos;
+        util::print("dynamic trace nested: ", nested, " | lane of worker 3: ", lanes);
+        ok = nested && lanes && ok;
+        util::print("dynamic trace saved: ", pond.dumpTrace(tracePath("dynamic_trace.json")));
+    }
+    util::print(ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
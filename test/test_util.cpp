@@ -1,4 +1,5 @@
 #include "../include/util.h"
+#include "../include/thread_pond/steady_pond.h"
 #include <algorithm>
 #include <functional>
 #include <future>
@@ -34,6 +35,24 @@ void addCount2()
     }
 }
 
+// 用两个线程对同一个计数器加锁累加
+template <typename Lock>
+int lockedCount(Lock & lock)
+{
+    int numb = 0;
+    auto add = [&] () {
+        for (size_t i = 0; i < 100000; i++) {
+            std::lock_guard<Lock> guard(lock);
+            numb++;
+        }
+    };
+    std::thread td1(add);
+    std::thread td2(add);
+    td1.join();
+    td2.join();
+    return numb;
+}
+
 int main(int argc, char * args[])
 {
     // 测试 sleep_for_seconds()
@@ -83,6 +102,34 @@ int main(int argc, char * args[])
     td4.join();
     std::cout << "test class SpinLock_guard -- count = " << count << std::endl;
 
+    // 测试 class TTASLock / TicketLock / McsLock
+    myHipe::util::TTASLock<myHipe::util::LockStats> ttasLock;
+    std::cout << "test class TTASLock -- count = " << lockedCount(ttasLock)
+              << " | acquisitions = " << ttasLock.getStats().getAcquisitions()
+              << " | contentions = " << ttasLock.getStats().getContentions() << std::endl;
+    myHipe::util::TicketLock<myHipe::util::LockStats> ticketLock;
+    std::cout << "test class TicketLock -- count = " << lockedCount(ticketLock)
+              << " | acquisitions = " << ticketLock.getStats().getAcquisitions()
+              << " | spins = " << ticketLock.getStats().getSpins() << std::endl;
+    myHipe::util::McsLock<myHipe::util::LockStats> mcsLock;
+    std::cout << "test class McsLock -- count = " << lockedCount(mcsLock)
+              << " | acquisitions = " << mcsLock.getStats().getAcquisitions()
+              << " | max wait(ns) = " << mcsLock.getStats().getMaxWaitNs() << std::endl;
+
+    // 测试 选择 SteadyThreadPond 的队列锁，并查看每条队列的竞争情况
+    {
+        myHipe::BasicSteadyThreadPond<myHipe::util::TicketLock<myHipe::util::LockStats>> pond(2);
+        for (int i = 0; i < 1000; i++) {
+            pond.submit([] () {});
+        }
+        pond.waitForTasks();
+        for (int i = 0; i < pond.getThreadNumb(); i++) {
+            const myHipe::util::LockStats & stats = pond.getQueueLockStats(i);
+            std::cout << "test queue lock stats -- thread " << i << " | acquisitions = " << stats.getAcquisitions()
+                      << " | contentions = " << stats.getContentions() << std::endl;
+        }
+    }
+
     // 测试 class SafeTask
     myHipe::util::SafeTask safeTask(std::bind(threadPrint, "SafeTask"));
     std::cout << safeTask.isSet() << std::endl;
@@ -102,5 +149,13 @@ int main(int argc, char * args[])
                         std::cout << "test QuickTask::reset" << std::endl;
                     });
     quickTask();
+
+    // 测试 cpu 拓扑
+    std::vector<int> cpus = myHipe::util::parseCpuList("0-3,8,10-11");
+    std::cout << "test parseCpuList -- " << cpus.size() << " cpus, last = " << cpus.back() << std::endl;
+    const myHipe::util::CpuTopology & topology = myHipe::util::CpuTopology::get();
+    int cpu = myHipe::util::currentCpu();
+    std::cout << "test CpuTopology -- known = " << topology.known() << " | cpu = " << cpu
+              << " | l3 = " << topology.l3Of(cpu) << " | node = " << topology.nodeOf(cpu) << std::endl;
     return 0;
 }